@@ -0,0 +1,87 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <cstdint>
+#include <string>
+#include <set>
+#include "Command.h"
+#include "PriorityClass.h"
+
+/**
+ * @brief Limits a core must satisfy before another job may be placed on it.
+ * A zero value disables that limit.
+ */
+struct AdmissionLimits {
+    int maxJobsPerCore = 0;  // Jobs placed by CCM (pending + running) per core
+    double maxLoadPct = 0.0; // Measured load of the core, all processes included
+
+    bool enabled() const { return maxJobsPerCore > 0 || maxLoadPct > 0.0; }
+};
+
+/**
+ * @brief Reads the optional "Admission" object ({ "MaxJobsPerCore": 2,
+ * "MaxLoadPct": 90 }) from a JSON config file such as mq.json.
+ * @return false if the file cannot be read or parsed; 'out' is left unchanged.
+ */
+bool load_admission_limits(const std::string& path, AdmissionLimits& out);
+
+/**
+ * @brief A StartJob waiting for capacity.
+ */
+struct PendingJob {
+    int priority = 0;       // Higher runs first
+    bool background = false; // Batch or idle class: behind other jobs of the same priority
+    uint64_t seq = 0;       // Arrival order among equal priorities
+    uint64_t enqueuedNs = 0; // CLOCK_MONOTONIC time the job was queued
+    Command cmd;
+};
+
+/**
+ * @brief Priority queue of jobs that were not admitted, highest priority first
+ * and FIFO within a priority, except that batch and idle jobs queue behind the
+ * other classes. They may wait for a core without realtime jobs, and that wait
+ * must not hold up latency-sensitive work. Not thread-safe: callers hold
+ * ProcessManager::admissionMutex.
+ */
+class PendingJobQueue {
+public:
+    void push(Command cmd, uint64_t nowNs);
+
+    bool empty() const { return jobs.empty(); }
+    size_t size() const { return jobs.size(); }
+
+    /**
+     * @brief The job that runs next. Only valid while the queue is not empty.
+     */
+    const PendingJob& front() const { return *jobs.begin(); }
+
+    /**
+     * @brief true if a queued job goes before 'cmd', which must then queue as well.
+     */
+    bool ahead(const Command& cmd) const;
+    PendingJob popFront();
+
+    /**
+     * @brief Drops a queued job by id. Returns false if it is not queued.
+     */
+    bool remove(const std::string& id);
+
+    /**
+     * @brief Wait time of the longest-queued job in nanoseconds, 0 if empty.
+     */
+    uint64_t oldestWaitNs(uint64_t nowNs) const;
+
+private:
+    struct Order {
+        bool operator()(const PendingJob& a, const PendingJob& b) const {
+            if (a.priority != b.priority) return a.priority > b.priority;
+            if (a.background != b.background) return b.background;
+            return a.seq < b.seq;
+        }
+    };
+
+    std::set<PendingJob, Order> jobs;
+    uint64_t nextSeq = 0;
+};
+
+#endif // ADMISSION_H
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>   
+#include <cstdint>
 /**
  * @brief Represents a command received by the system to manage a process.
  */
@@ -12,6 +13,17 @@ struct Command {
     std::string programPath; // e.g., "/bin/bash"
     std::vector<std::string> args;
     std::string processId; // ID of the tracked process (if action != start)
+    double cpuWeight = 1.0; // Declared CPU demand per core used for reservations (1.0 = one core)
+    int coreCount = 1; // Number of cores to assign to the job
+    std::vector<int> cpuList; // Explicit CPUs to pin to (overrides coreCount and placement)
+    std::string placement; // "spread" (default), "pack" or "numa"
+    int numaNode = -1; // NUMA node for "numa" placement (-1 = least loaded node)
+    int priority = 0; // Queue order when the job has to wait for admission (higher first)
+    std::string priorityClass; // "realtime", "latency", "normal" (default), "batch" or "idle"
+    double cpuMax = 0.0; // cgroup cpu.max quota in cores (0 = unlimited)
+    uint64_t memoryMax = 0; // cgroup memory.max in bytes (0 = unlimited)
+    std::string replyQueue; // Client queue (e.g. "/ccm_reply_1234") for the result, empty = no reply
+    std::string correlationId; // Echoed back in the reply so the client can match it
 };
 
 #endif // Command_H
\ No newline at end of file
@@ -0,0 +1,128 @@
+#ifndef COMMAND_CODEC_H
+#define COMMAND_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Command.h"
+#include "PriorityClass.h"
+
+/*
+ * Binary command wire format (version 2, little-endian).
+ * A message is one or more frames back to back; each frame is
+ *
+ *   offset  size  field
+ *   0       1     magic (0xCC; a JSON message never starts with it)
+ *   1       1     version
+ *   2       1     action (CommandAction)
+ *   3       1     placement (0 = spread, 1 = pack, 2 = numa)
+ *   4       4     frame length in bytes, header included
+ *   8       4     cpuWeight (IEEE float)
+ *   12      2     numaNode (int16, -1 = any)
+ *   14      2     coreCount
+ *   16      2     argCount
+ *   18      2     cpuCount
+ *   20      2     priority (int16, higher is admitted first)
+ *   22      1     priority class (PriorityClass, 0 = normal)
+ *   23      1     reserved (0)
+ *   24      4     cpuMax (IEEE float, cores, 0 = unlimited)
+ *   28      4     memoryMax in KiB (0 = unlimited)
+ *   32      ...   string table: u16 length + bytes for JobId, ProcessId,
+ *                 ProgramPath, ReplyQueue, CorrelationId, then argCount
+ *                 arguments
+ *   ...     2*n   cpuCount explicit CPU ids (u16)
+ *
+ * Version 1 frames have the same layout without bytes 24-31 and are still accepted.
+ */
+const uint8_t WIRE_MAGIC = 0xCC;
+const uint8_t WIRE_VERSION = 2;
+const size_t WIRE_HEADER_SIZE = 32;
+const size_t WIRE_HEADER_SIZE_V1 = 24;
+
+enum CommandAction : uint8_t {
+    ACTION_UNKNOWN = 0,
+    ACTION_START = 1,
+    ACTION_PAUSE = 2,
+    ACTION_RESUME = 3,
+    ACTION_TERMINATE = 4,
+    ACTION_STATUS = 5
+};
+
+/**
+ * @brief Read-only view of one decoded frame. Every string_view points into the
+ * received buffer, which must outlive the view; decoding never allocates.
+ */
+struct CommandView {
+    CommandAction action = ACTION_UNKNOWN;
+    uint8_t placement = 0;
+    float cpuWeight = 1.0f;
+    int numaNode = -1;
+    int coreCount = 1;
+    int priority = 0;
+    PriorityClass priorityClass = PRIO_NORMAL;
+    float cpuMax = 0.0f;
+    uint64_t memoryMax = 0; // Bytes
+    std::string_view id;
+    std::string_view processId;
+    std::string_view programPath;
+    std::string_view replyQueue;
+    std::string_view correlationId;
+    uint16_t argCount = 0;
+    uint16_t cpuCount = 0;
+
+    /**
+     * @brief Returns argument i (0-based). Walks the length-prefixed table, so
+     * iterate with forEachArg() when visiting all of them.
+     */
+    std::string_view arg(uint16_t index) const;
+
+    template <typename Fn>
+    void forEachArg(Fn fn) const {
+        const char* p = argTable;
+        for (uint16_t i = 0; i < argCount; ++i) {
+            uint16_t len = static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+            fn(std::string_view(p + 2, len));
+            p += 2 + len;
+        }
+    }
+
+    /**
+     * @brief Returns explicit CPU id i (0-based).
+     */
+    int cpu(uint16_t index) const;
+
+    const char* argTable = nullptr; // First entry of the argument table
+    const char* cpuTable = nullptr; // First explicit CPU id
+};
+
+/**
+ * @brief True if the message uses the binary format rather than JSON.
+ */
+inline bool is_binary_message(const char* buf, size_t len) {
+    return len > 0 && static_cast<uint8_t>(buf[0]) == WIRE_MAGIC;
+}
+
+/**
+ * @brief Decodes the frame at the start of 'buf' in place.
+ * @param consumed Set to the frame length so callers can step to the next frame.
+ * @return false on a truncated frame, bad magic or unsupported version.
+ */
+bool decode_command(const char* buf, size_t len, CommandView& out, size_t& consumed);
+
+/**
+ * @brief Copies a view into a Command. Assigning into a reused Command keeps
+ * its string and vector capacity, so steady-state dispatch does not allocate.
+ */
+void to_command(const CommandView& view, Command& out);
+
+/**
+ * @brief Appends one frame for 'cmd' to 'out' (used by clients and tools).
+ * @return false if a field does not fit the format (e.g. a string over 64 KiB).
+ */
+bool encode_command(const Command& cmd, std::string& out);
+
+const char* action_name(CommandAction action);
+CommandAction action_from_name(const std::string& name);
+
+#endif // COMMAND_CODEC_H
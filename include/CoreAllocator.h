@@ -0,0 +1,185 @@
+#ifndef CORE_ALLOCATOR_H
+#define CORE_ALLOCATOR_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include "CoreLoadSampler.h"
+#include "CpuTopology.h"
+#include "CpuMask.h"
+#include "Admission.h"
+#include "PriorityClass.h"
+
+/**
+ * @brief How a job is placed relative to the CPU topology.
+ */
+enum PlacementPolicy {
+    PLACE_SPREAD, // Prefer CPUs whose SMT siblings are idle (one job per physical core first)
+    PLACE_PACK,   // Fill the busiest L3 domain that still has headroom, keeping caches shared
+    PLACE_NUMA    // Stay on one NUMA node and bind the job's memory to it
+};
+
+/**
+ * @brief Maps a StartJob "Placement" value ("spread", "pack", "numa") to a policy.
+ * Unknown or empty names select PLACE_SPREAD.
+ */
+PlacementPolicy placement_policy_from_string(const std::string& name);
+
+/**
+ * @brief What a job asks of the allocator.
+ */
+struct PlacementRequest {
+    double weight = 1.0;        // Declared CPU demand per assigned core (1.0 = one full core)
+    PlacementPolicy policy = PLACE_SPREAD;
+    int numaNode = -1;          // Node to use with PLACE_NUMA; -1 picks the least loaded node
+    int coreCount = 1;          // Number of cores to assign
+    std::vector<int> cpuList;   // Explicit CPUs; overrides coreCount and policy when non-empty
+    PriorityClass priorityClass = PRIO_NORMAL; // Realtime and batch/idle jobs get separate cores
+};
+
+// Fraction of an SMT sibling's load added to a CPU's score under PLACE_SPREAD
+const double SMT_SIBLING_PENALTY = 0.5;
+// A CPU above this load (percent) is not considered free when packing
+const double PACK_MAX_CPU_LOAD = 50.0;
+
+/**
+ * @brief Per-core bookkeeping of the jobs CCM itself has placed.
+ */
+struct CoreReservation {
+    int pending = 0;        // Placed, spawn not yet confirmed
+    int active = 0;         // Spawned and not yet reaped
+    double committed = 0.0; // Sum of declared CPU weights (1.0 = one full core)
+    int realtime = 0;       // Realtime-class jobs among pending + active
+    int background = 0;     // Batch and idle-class jobs among pending + active
+};
+
+/**
+ * @brief Chooses a core for each new job by combining the measured load from
+ * CoreLoadSampler with a ledger of reservations made by earlier placements.
+ * Load only shows up in /proc/stat some time after a job starts, so without the
+ * ledger a burst of launches would all see the same idle core. Choosing and
+ * reserving happen under one lock, so concurrent placements never race.
+ */
+class CoreAllocator {
+public:
+    /**
+     * @param sampler Source of measured per-core load (may not be started yet).
+     * @param numCores Number of cores to manage; 0 uses the configured CPU count.
+     */
+    explicit CoreAllocator(const CoreLoadSampler& sampler, int numCores = 0);
+
+    /**
+     * @brief Picks the core(s) with the lowest combined load and reserves them as pending.
+     * Multi-core requests are kept inside one socket (L3 domain for PLACE_PACK, node for
+     * PLACE_NUMA) when possible, preferring the cheapest and then most contiguous set.
+     * Batch and idle jobs never get a core that holds a realtime job; realtime jobs
+     * avoid cores with batch or idle jobs unless no other core is left.
+     * @return The reserved cores, empty if none are available.
+     */
+    CpuMask reserve(const PlacementRequest& request);
+
+    /**
+     * @brief Like reserve(), but only considers cores within the admission limits.
+     * Choosing and reserving happen under one lock, so concurrent admissions
+     * cannot overshoot a limit.
+     * @return The reserved cores, empty if the job does not fit right now (nothing is reserved).
+     */
+    CpuMask admit(const PlacementRequest& request);
+
+    void setLimits(const AdmissionLimits& newLimits);
+    AdmissionLimits limits() const;
+
+    /**
+     * @brief Books an active reservation for a job that is already running on
+     * 'mask', e.g. one recovered from the journal after a restart.
+     */
+    void adopt(const CpuMask& mask, double weight, PriorityClass priorityClass);
+
+    /**
+     * @brief Moves pending reservations to active once the job has been spawned.
+     */
+    void activate(const CpuMask& mask);
+
+    /**
+     * @brief Drops reservations when the job is reaped or its launch failed.
+     * @param weight Weight that was reserved per core.
+     * @param wasActive true if activate() was called for this reservation.
+     */
+    void release(const CpuMask& mask, double weight, bool wasActive = true,
+                 PriorityClass priorityClass = PRIO_NORMAL);
+
+    /**
+     * @brief Moves an active single-job reservation to the best other core whose
+     * combined load is below 'maxScore'. The old cores are released and the new
+     * one is booked as active in the same step. Cores the job's class must avoid,
+     * and cores outside the admission limits, are not considered.
+     * @param numaNode Node the job is bound to (its memory lives there), -1 for any core.
+     * @return The new mask, empty if no core qualifies (the ledger is unchanged).
+     */
+    CpuMask migrate(const CpuMask& from, double weight, double maxScore,
+                    PriorityClass priorityClass = PRIO_NORMAL, int numaNode = -1);
+
+    /**
+     * @brief Moves an active reservation between two explicit masks (e.g. to undo
+     * a migration whose sched_setaffinity failed).
+     */
+    void transfer(const CpuMask& from, const CpuMask& to, double weight,
+                  PriorityClass priorityClass = PRIO_NORMAL);
+
+    /**
+     * @brief Returns a copy of the ledger (index = core id).
+     */
+    std::vector<CoreReservation> ledger() const;
+
+    /**
+     * @brief Whether an explicit CpuList names at least one CPU that exists.
+     */
+    bool anyUsable(const std::vector<int>& cpuList) const;
+
+    /**
+     * @brief Number of CPUs jobs can be placed on (the largest CoreCount a job may ask for).
+     */
+    int cpuCount() const { return static_cast<int>(allCpus.size()); }
+
+    /**
+     * @brief Topology used for placement decisions.
+     */
+    const CpuTopology& topology() const { return topo; }
+
+private:
+    // Fills 'score' with max(measured load, committed weight) per CPU. Caller holds ledgerMutex.
+    void computeScores();
+    bool usable(int core) const;
+    // Marks cores outside the admission limits, and optionally cores held by a class
+    // that must not share with 'priorityClass', as unusable. Caller holds ledgerMutex.
+    void applyLimits(bool enforceLimits, PriorityClass priorityClass, bool separateClasses);
+    bool conflicts(int core, PriorityClass priorityClass) const;
+    // Runs the placement policy over the usable cores
+    void pickCores(const PlacementRequest& request, std::vector<int>& chosen);
+    CpuMask reserveLocked(const PlacementRequest& request, bool enforceLimits);
+    // Adds 'delta' to the class counters of every core in 'mask'. Caller holds ledgerMutex.
+    void countClass(const CpuMask& mask, PriorityClass priorityClass, int delta);
+    // Lowest SMT-aware score among 'candidates' under the given (trial) scores
+    int pickSpread(const std::vector<int>& candidates, const std::vector<double>& scores) const;
+    int pickPack() const;
+    int pickNumaNode() const;
+    // Greedily takes 'count' CPUs from 'candidates'; returns the summed score or -1 if too few
+    double pickSet(const std::vector<int>& candidates, int count, double weight, bool penalizeSmt,
+                   std::vector<int>& chosen);
+    std::vector<int> pickMany(const PlacementRequest& request);
+    // Active reservation bookkeeping shared by migrate() and transfer(). Caller holds ledgerMutex.
+    void moveActive(const CpuMask& from, const CpuMask& to, double weight, PriorityClass priorityClass);
+
+    const CoreLoadSampler& sampler;
+    CpuTopology topo;
+    mutable std::mutex ledgerMutex;
+    std::vector<CoreReservation> cores;
+    std::vector<double> usage; // Scratch buffer for sampler snapshots
+    std::vector<double> score; // Scratch buffer for per-CPU scores
+    std::vector<double> trial; // Scores with tentative picks applied (multi-core placement)
+    std::vector<int> allCpus;  // Every usable CPU id
+    AdmissionLimits admission;
+    std::vector<char> blocked; // Cores excluded from the placement in progress
+};
+
+#endif // CORE_ALLOCATOR_H
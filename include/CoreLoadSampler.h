@@ -0,0 +1,177 @@
+#ifndef CORE_LOAD_SAMPLER_H
+#define CORE_LOAD_SAMPLER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Column order of a 'cpuN' line in /proc/stat
+enum CpuJiffyField {
+    CPU_USER, CPU_NICE, CPU_SYSTEM, CPU_IDLE, CPU_IOWAIT,
+    CPU_IRQ, CPU_SOFTIRQ, CPU_STEAL, CPU_GUEST, CPU_GUEST_NICE,
+    CPU_FIELD_COUNT
+};
+
+// Structure to hold all jiffy counters (time slices) for a single core
+struct CoreStats {
+    unsigned long long jiffies[CPU_FIELD_COUNT] = {};
+    bool online = false; // false if the core had no line in the last read
+
+    // Guest time is already accounted in user/nice, so it is not added again
+    unsigned long long total() const {
+        return jiffies[CPU_USER] + jiffies[CPU_NICE] + jiffies[CPU_SYSTEM] + jiffies[CPU_IDLE]
+             + jiffies[CPU_IOWAIT] + jiffies[CPU_IRQ] + jiffies[CPU_SOFTIRQ] + jiffies[CPU_STEAL];
+    }
+    // Steal time counts as busy: the core was not available to us
+    unsigned long long idle() const { return jiffies[CPU_IDLE] + jiffies[CPU_IOWAIT]; }
+};
+
+// Default time between /proc/stat samples in milliseconds
+const int SAMPLE_DELAY_MS = 200;
+// Default weight of the newest sample in the exponentially smoothed load (0..1]
+const double LOAD_SMOOTHING_FACTOR = 0.3;
+
+// Sampler settings from the "LoadSampler" section of mq.json
+struct LoadSamplerSettings {
+    int intervalMs = SAMPLE_DELAY_MS;        // "IntervalMs"
+    double smoothing = LOAD_SMOOTHING_FACTOR; // "Smoothing", weight of the newest sample
+};
+
+/**
+ * @brief Reads the "LoadSampler" section of the given config file.
+ * Out-of-range values fall back to the defaults; a missing section keeps 'settings'.
+ * @return false if the file cannot be read or parsed.
+ */
+bool load_sampler_settings(const std::string& path, LoadSamplerSettings& settings);
+
+/**
+ * @brief Allocation-free reader for the per-core lines of /proc/stat.
+ * Keeps the file descriptor open and reads the whole file with one pread()
+ * into a reusable buffer, then parses the counters by hand.
+ */
+class ProcStatReader {
+public:
+    explicit ProcStatReader(const char* path = "/proc/stat");
+    ~ProcStatReader();
+
+    ProcStatReader(const ProcStatReader&) = delete;
+    ProcStatReader& operator=(const ProcStatReader&) = delete;
+
+    /**
+     * @brief Fills 'stats' indexed by core id. The vector only grows when a
+     * higher core id appears, so steady-state reads do not allocate.
+     * @return true if at least one core line was parsed.
+     */
+    bool read(std::vector<CoreStats>& stats);
+
+private:
+    int fd = -1;
+    std::vector<char> buffer;
+};
+
+/**
+ * @brief Reads the jiffy counters for all 'cpuN' entries from /proc/stat.
+ * @param stats Output vector indexed by core id.
+ * @return true on success, false on failure.
+ */
+bool read_cpu_stats(std::vector<CoreStats>& stats);
+
+/**
+ * @brief Returns the least busy logical core from a shared background sampler.
+ * The first call starts the sampler and waits for its first interval; later calls
+ * do not block.
+ * @return The ID of the least busy core, or -1 on error.
+ */
+int find_least_busy_core();
+
+/**
+ * @brief Background thread that keeps an exponentially smoothed utilisation
+ * vector for every core.
+ * Each interval it diffs /proc/stat against the previous read and folds the
+ * result into the rolling average. Readers never take a lock: the least busy
+ * core is a single atomic, and the full vector is published under a seqlock.
+ */
+class CoreLoadSampler {
+public:
+    /**
+     * @param intervalMs Time between /proc/stat reads.
+     * @param smoothing Weight of the newest sample (1.0 disables smoothing).
+     */
+    explicit CoreLoadSampler(int intervalMs = SAMPLE_DELAY_MS, double smoothing = LOAD_SMOOTHING_FACTOR);
+    ~CoreLoadSampler();
+
+    CoreLoadSampler(const CoreLoadSampler&) = delete;
+    CoreLoadSampler& operator=(const CoreLoadSampler&) = delete;
+
+    /**
+     * @brief Replaces the interval and smoothing factor, with the same fallbacks as the constructor.
+     * @return false if the sampling thread is already running (nothing is changed).
+     */
+    bool configure(const LoadSamplerSettings& settings);
+
+    /**
+     * @brief Takes the baseline sample and starts the sampling thread.
+     * @return false if /proc/stat could not be read.
+     */
+    bool start();
+
+    /**
+     * @brief Stops and joins the sampling thread.
+     */
+    void stop();
+
+    /**
+     * @brief Blocks until the first utilisation snapshot has been published.
+     */
+    void waitForFirstSample();
+
+    /**
+     * @brief Returns the currently least busy core, or -1 before the first sample.
+     */
+    int leastBusyCore() const { return leastBusy.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Copies the smoothed per-core utilisation (0..100) into 'usage'.
+     * @return false if no snapshot has been published yet.
+     */
+    bool snapshot(std::vector<double>& usage) const;
+
+    /**
+     * @brief Number of cores covered by the snapshot.
+     */
+    int coreCount() const { return numCores.load(std::memory_order_acquire); }
+
+    int intervalMs() const { return interval; }
+    double smoothingFactor() const { return alpha; }
+
+private:
+    void run();
+    void publish(const std::vector<CoreStats>& previous, const std::vector<CoreStats>& current);
+
+    int interval;
+    double alpha;
+
+    // Seqlock-protected utilisation vector (odd sequence = write in progress)
+    std::atomic<unsigned> sequence{0};
+    std::unique_ptr<std::atomic<double>[]> usagePct;
+    std::atomic<int> numCores{0};
+    std::atomic<int> leastBusy{-1};
+
+    // Sampler-thread private state
+    ProcStatReader reader;
+    std::vector<CoreStats> lastStats;
+    std::vector<double> smoothed;
+    bool haveSample = false;
+
+    std::thread worker;
+    std::mutex stateMutex;
+    std::condition_variable stateCv;
+    bool stopping = false;
+    bool published = false;
+};
+
+#endif // CORE_LOAD_SAMPLER_H
@@ -0,0 +1,54 @@
+#ifndef CPU_MASK_H
+#define CPU_MASK_H
+
+#include <string>
+#include <vector>
+#include <sched.h>
+
+/**
+ * @brief Owning wrapper around a dynamically sized cpu_set_t (CPU_ALLOC).
+ * Unlike a plain cpu_set_t it is not limited to 1024 CPUs.
+ */
+class CpuMask {
+public:
+    /**
+     * @param numCpus Highest CPU id + 1 the mask must be able to hold.
+     */
+    explicit CpuMask(int numCpus = 0);
+    ~CpuMask();
+
+    CpuMask(const CpuMask& other);
+    CpuMask& operator=(const CpuMask& other);
+    CpuMask(CpuMask&& other) noexcept;
+    CpuMask& operator=(CpuMask&& other) noexcept;
+
+    /**
+     * @brief Adds a CPU, growing the mask if needed.
+     */
+    void set(int cpu);
+    bool isSet(int cpu) const;
+    int count() const;
+    bool empty() const { return count() == 0; }
+
+    /**
+     * @brief CPU ids in the mask, ascending.
+     */
+    std::vector<int> cpus() const;
+
+    /**
+     * @brief Kernel-style cpu list, e.g. "0-3,8".
+     */
+    std::string toString() const;
+
+    const cpu_set_t* data() const { return set_; }
+    cpu_set_t* data() { return set_; }
+    size_t byteSize() const { return CPU_ALLOC_SIZE(capacity); }
+
+private:
+    void reallocate(int numCpus);
+
+    cpu_set_t* set_ = nullptr;
+    int capacity = 0;
+};
+
+#endif // CPU_MASK_H
@@ -0,0 +1,69 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Position of one logical CPU in the machine.
+ */
+struct CpuInfo {
+    bool present = false;  // false for ids missing from sysfs (offline / not possible)
+    int package = 0;       // physical_package_id (socket)
+    int coreKey = -1;      // Index of the physical core this CPU is a hyperthread of
+    int l3Domain = 0;      // Index of the L3 cache domain
+    int numaNode = 0;      // NUMA node id
+    std::vector<int> smtSiblings; // Other hyperthreads of the same physical core
+};
+
+/**
+ * @brief Snapshot of the CPU topology from /sys/devices/system/cpu/cpuN/topology,
+ * cpuN/cache/index3 and /sys/devices/system/node.
+ * Missing files degrade gracefully: a machine without that information looks like
+ * one socket, one L3 domain and one NUMA node with no SMT.
+ */
+class CpuTopology {
+public:
+    /**
+     * @brief Reads the topology of the online CPUs (present and online) from sysfs.
+     * @param sysRoot Root of the sysfs tree (overridable for testing on captured trees).
+     */
+    bool load(const std::string& sysRoot = "/sys/devices/system");
+
+    int cpuCount() const { return static_cast<int>(cpus.size()); }
+    int l3DomainCount() const { return numL3Domains; }
+    int numaNodeCount() const { return static_cast<int>(nodeCpus.size()); }
+
+    const CpuInfo& cpu(int id) const { return cpus[id]; }
+    bool present(int id) const { return id >= 0 && id < cpuCount() && cpus[id].present; }
+    int nodeOf(int id) const { return present(id) ? cpus[id].numaNode : -1; }
+
+    /**
+     * @brief CPUs that belong to a NUMA node (empty if the node does not exist).
+     */
+    const std::vector<int>& cpusOfNode(int node) const;
+
+private:
+    std::vector<CpuInfo> cpus;
+    std::vector<std::vector<int>> nodeCpus; // Index = NUMA node id
+    int numL3Domains = 1;
+};
+
+// Highest CPU id + 1 a cpu list may name (the kernel's largest NR_CPUS)
+const int CPU_LIST_MAX_CPUS = 8192;
+
+/**
+ * @brief Parses a kernel cpu list such as "0-3,8,10-11" into 'out'. Ids at or
+ * above 'limit' are dropped and ranges are clamped to it, so a list such as
+ * "0-2000000000" costs at most 'limit' entries.
+ * @return false on an entry that is not a number or "first-last" range, or a
+ * reversed range; 'out' then holds the ids parsed before it.
+ */
+bool parse_cpu_list(const std::string& list, std::vector<int>& out, int limit = CPU_LIST_MAX_CPUS);
+
+/**
+ * @brief Lenient form for sysfs attributes: the ids up to the first malformed entry.
+ */
+std::vector<int> parse_cpu_list(const std::string& list);
+
+#endif // CPU_TOPOLOGY_H
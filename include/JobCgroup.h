@@ -0,0 +1,116 @@
+#ifndef JOB_CGROUP_H
+#define JOB_CGROUP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include "CpuMask.h"
+#include "PriorityClass.h"
+
+/**
+ * @brief Optional per-job resource limits. Zero leaves a limit unset.
+ */
+struct CgroupLimits {
+    double cpuMax = 0.0;     // cpu.max quota in cores (1.5 = 150ms per 100ms period)
+    uint64_t memoryMax = 0;  // memory.max in bytes
+};
+
+/**
+ * @brief Accounting of a whole job cgroup, grandchildren included.
+ */
+struct CgroupUsage {
+    uint64_t cpuUsageUsec = 0;  // cpu.stat usage_usec
+    uint64_t throttledUsec = 0; // cpu.stat throttled_usec (time held back by cpu.max)
+    uint64_t nrThrottled = 0;   // cpu.stat nr_throttled
+    uint64_t memoryCurrent = 0; // memory.current in bytes
+};
+
+/**
+ * @brief Handle of one job's cgroup. An empty path means the job is not in a
+ * cgroup and is controlled with signals.
+ */
+struct JobCgroup {
+    std::string path;    // Relative to the CCM root, e.g. "batch/job-7"
+    bool pinned = false; // cpuset.cpus holds the job's cores
+
+    bool empty() const { return path.empty(); }
+};
+
+// Period written with cpu.max quotas, in microseconds (the kernel default)
+const uint64_t CGROUP_CPU_PERIOD_US = 100000;
+
+/**
+ * @brief Reads "Cgroups": { "Root": "/sys/fs/cgroup/ccm" } from a JSON config
+ * file such as mq.json.
+ * @return false if the file cannot be read or parsed; 'root' is left unchanged.
+ */
+bool load_cgroup_root(const std::string& path, std::string& root);
+
+/**
+ * @brief The cgroup v2 sub-tree CCM owns: root/<class>/<job>.
+ * Each class group carries the class's cpu.weight, so contended CPU time is
+ * split between classes first and between the jobs of a class second. Each job
+ * group gets cpuset.cpus for its cores plus optional cpu.max and memory.max,
+ * and cgroup.freeze/cgroup.kill act on every process the job forked.
+ * All control files are opened relative to a directory fd, so a job whose
+ * group has already been removed simply fails with ENOENT.
+ * Thread-safe; the root must be a delegated (writable) cgroup v2 directory.
+ */
+class JobCgroups {
+public:
+    JobCgroups() = default;
+    ~JobCgroups();
+    JobCgroups(const JobCgroups&) = delete;
+    JobCgroups& operator=(const JobCgroups&) = delete;
+
+    /**
+     * @brief Creates (or reuses) the root and class groups and enables the
+     * cpu, cpuset and memory controllers for their children. Leftover job
+     * groups from an earlier run are removed if they are empty.
+     * @return false if the root is not usable; jobs then fall back to signals.
+     */
+    bool open(const std::string& root);
+
+    bool available() const { return rootFd != -1; }
+
+    /**
+     * @brief Creates root/<class>/<jobId> with the job's cores and limits.
+     * Limits that cannot be written are reported and skipped.
+     * @return false if no group could be created ('out' is left empty).
+     */
+    bool create(const std::string& jobId, PriorityClass cls, const CpuMask& cpus,
+                const CgroupLimits& limits, JobCgroup& out);
+
+    /**
+     * @brief Opens the group's cgroup.procs for LaunchRequest::cgroupProcsFd.
+     * @return The fd (the caller closes it) or -1.
+     */
+    int openProcs(const JobCgroup& group) const;
+
+    // Each returns 0 or the errno of the failed write
+    int freeze(const JobCgroup& group, bool frozen) const;
+    int kill(const JobCgroup& group) const; // cgroup.kill, Linux 5.14+
+    int setCpus(const JobCgroup& group, const CpuMask& cpus) const;
+
+    bool readUsage(const JobCgroup& group, CgroupUsage& out) const;
+
+    /**
+     * @brief Removes the group. A group that still has processes (e.g. right
+     * after cgroup.kill) is retried by retryRemovals().
+     */
+    void remove(const JobCgroup& group);
+    void retryRemovals();
+
+private:
+    int writeControl(const std::string& file, const std::string& value) const;
+    ssize_t readControl(const std::string& file, char* buf, size_t size) const;
+    void removeLeftovers(const std::string& classDir);
+
+    int rootFd = -1;
+    std::string rootPath;
+    std::mutex staleMutex;
+    std::vector<std::string> stale; // Groups whose rmdir failed with EBUSY
+};
+
+#endif // JOB_CGROUP_H
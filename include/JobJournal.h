@@ -0,0 +1,109 @@
+#ifndef JOB_JOURNAL_H
+#define JOB_JOURNAL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include "TrackedProcess.h"
+
+/**
+ * @brief Kinds of job state transitions. Every record sets state rather than
+ * changing it, so replaying a record twice gives the same result.
+ */
+enum JournalRecordType : uint8_t {
+    JOURNAL_START = 1,     // Full job state (pid, cores, class, cgroup, ...)
+    JOURNAL_PAUSE = 2,
+    JOURNAL_RESUME = 3,
+    JOURNAL_TERMINATE = 4, // SIGTERM sent, waiting for the exit
+    JOURNAL_MOVE = 5,      // New cores after a rebalancer migration
+    JOURNAL_EXIT = 6       // Reaped or dropped; the job is gone
+};
+
+// Initial size of the mapping; it doubles whenever a record does not fit
+const size_t JOURNAL_INITIAL_BYTES = 1 << 20;
+// Compaction starts once the journal is this many times larger than right after the last one...
+const size_t JOURNAL_COMPACT_RATIO = 4;
+// ...and at least this large
+const size_t JOURNAL_COMPACT_MIN_BYTES = 256 * 1024;
+
+/**
+ * @brief Reads "Journal": { "Path": "/var/lib/ccm/jobs.journal" } from a JSON
+ * config file such as mq.json. An empty path disables the journal.
+ * @return false if the file cannot be read or parsed; 'path' is left unchanged.
+ */
+bool load_journal_path(const std::string& configPath, std::string& path);
+
+/**
+ * @brief Append-only, memory-mapped journal of job state transitions.
+ * Records go to a MAP_SHARED file mapping, so a crash of the manager loses
+ * nothing that was appended (the page cache keeps it); the journal is not
+ * synced to disk for every record and does not cover a host crash.
+ * Each record carries a checksum; replay stops at the first torn or missing
+ * record. Compaction rewrites the file from a snapshot of the live jobs and
+ * renames it over the old one.
+ * Thread-safe. Callers append under the job's tracker shard lock so a
+ * snapshot (taken under the same locks) and the journal always agree.
+ */
+class JobJournal {
+public:
+    using JobList = std::vector<std::pair<std::string, TrackedProcess>>;
+
+    JobJournal() = default;
+    ~JobJournal();
+    JobJournal(const JobJournal&) = delete;
+    JobJournal& operator=(const JobJournal&) = delete;
+
+    /**
+     * @brief Opens or creates the journal and replays it.
+     * @param jobs Filled with the jobs that were live when the journal ended
+     * (pid, procStartTicks, status, cores, ...); their liveness is not checked.
+     * @return false if the file cannot be opened or mapped.
+     */
+    bool open(const std::string& path, JobList& jobs);
+    bool isOpen() const { return fd != -1; }
+
+    void recordStart(const std::string& id, const TrackedProcess& proc);
+    void recordMove(const std::string& id, const CpuMask& cpus);
+    // PAUSE, RESUME, TERMINATE or EXIT
+    void record(JournalRecordType type, const std::string& id);
+
+    /**
+     * @brief true once the journal has grown well past the live state.
+     */
+    bool wantsCompaction() const;
+
+    /**
+     * @brief Current end of the journal. Take it before the snapshot passed to compact().
+     */
+    size_t mark() const;
+
+    /**
+     * @brief Rewrites the journal as one START (plus PAUSE or TERMINATE) per live
+     * job, followed by the records appended since 'mark'. Those are replayed on
+     * top of the snapshot, so events that raced with it are never lost.
+     * @return false if the new file could not be written; the old one is kept.
+     */
+    bool compact(const JobList& live, size_t mark);
+
+    size_t bytesUsed() const;
+
+private:
+    // Appends one record. Caller holds mutex.
+    void appendLocked(JournalRecordType type, const std::string& body);
+    bool growLocked(size_t needed);
+    // Maps 'fd' with at least 'bytes' of capacity. Caller holds mutex.
+    bool mapLocked(size_t bytes);
+    void unmapLocked();
+
+    mutable std::mutex mutex;
+    std::string path;
+    int fd = -1;
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t end = 0;          // Offset of the next record
+    size_t compactedEnd = 0; // Size right after the last compaction (or open)
+};
+
+#endif // JOB_JOURNAL_H
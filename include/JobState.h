@@ -0,0 +1,39 @@
+#ifndef JOB_STATE_H
+#define JOB_STATE_H
+
+#include <cstdint>
+
+/**
+ * @brief Lifecycle state of a tracked job. The values are part of the shared
+ * job table layout (JobStatusTable.h): add new states at the end.
+ */
+enum JobState : uint8_t {
+    JOB_INITIALIZED = 0,
+    JOB_QUEUED = 1,      // Waiting in the admission queue
+    JOB_STARTING = 2,    // Cores reserved, spawn in flight
+    JOB_RUNNING = 3,
+    JOB_PAUSED = 4,
+    JOB_TERMINATING = 5, // SIGTERM sent, waiting for the exit
+    JOB_FINISHED = 6,    // Exited on its own
+    JOB_TERMINATED = 7   // Killed by a signal, or cancelled while queued
+};
+
+/**
+ * @brief Name used in status reports and replies ("queued", "running", ...).
+ */
+inline const char* job_state_name(JobState state)
+{
+    switch (state) {
+    case JOB_INITIALIZED: return "initialized";
+    case JOB_QUEUED:      return "queued";
+    case JOB_STARTING:    return "starting";
+    case JOB_RUNNING:     return "running";
+    case JOB_PAUSED:      return "paused";
+    case JOB_TERMINATING: return "terminating";
+    case JOB_FINISHED:    return "finished";
+    case JOB_TERMINATED:  return "terminated";
+    }
+    return "unknown";
+}
+
+#endif // JOB_STATE_H
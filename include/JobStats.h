@@ -0,0 +1,68 @@
+#ifndef JOB_STATS_H
+#define JOB_STATS_H
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <sys/types.h>
+#include "ProcScanner.h"
+#include "JobCgroup.h"
+
+/**
+ * @brief Resource usage of one job, refreshed by the manager's stats sampler.
+ * Counters are cumulative since the job started; the percentages cover the
+ * last sampling interval.
+ */
+struct JobStats {
+    uint64_t cpuTimeNs = 0;     // User + system time of all threads
+    uint64_t runDelayNs = 0;    // Time runnable but waiting for a CPU (schedstat), all threads
+    uint64_t rssBytes = 0;
+    uint64_t readBytes = 0;     // Storage I/O (/proc/[pid]/io read_bytes)
+    uint64_t writeBytes = 0;    // Storage I/O (/proc/[pid]/io write_bytes)
+    uint32_t voluntaryCtxSwitches = 0;
+    uint32_t involuntaryCtxSwitches = 0;
+    uint32_t numThreads = 0;
+    float cpuPercent = 0.0f;    // CPU used over the last interval (100 = one core)
+    float waitPercent = 0.0f;   // Run-queue wait over the last interval (100 = one thread always waiting)
+    uint64_t sampledAtNs = 0;   // CLOCK_MONOTONIC time of the last sample (0 = never sampled)
+    CgroupUsage cgroup;         // Whole job cgroup, grandchildren included (zero without a cgroup)
+};
+
+/**
+ * @brief Reads /proc/[pid]/stat, schedstat, status and io for a batch of pids.
+ * Buffers and the underlying ProcScanner are reused across batches.
+ */
+class JobStatsReader {
+public:
+    JobStatsReader();
+    ~JobStatsReader();
+
+    JobStatsReader(const JobStatsReader&) = delete;
+    JobStatsReader& operator=(const JobStatsReader&) = delete;
+
+    using Batch = std::vector<std::pair<pid_t, JobStats>>;
+
+    /**
+     * @brief Samples every pid in 'jobs' in one pass and folds the results
+     * into their stats (rates are computed against the previous contents).
+     * Entries whose process no longer exists are left unchanged.
+     */
+    void sample(Batch& jobs);
+
+private:
+    // Reads a small /proc file relative to procFd into buffer; returns its length or -1
+    ssize_t readFile(const char* path);
+    void fold(pid_t pid, const ProcStatFields& fields, uint64_t now, JobStats& stats);
+    // Sums run-queue wait (and CPU time) over /proc/[pid]/task/*/schedstat
+    bool readSchedstat(pid_t pid, bool allThreads, uint64_t& cpuNs, uint64_t& delayNs);
+
+    ProcScanner scanner;
+    ProcScanner::Result statResults;
+    std::vector<pid_t> pids;
+    int procFd = -1;
+    std::vector<char> buffer;
+    long ticksPerSecond;
+    long pageSize;
+};
+
+#endif // JOB_STATS_H
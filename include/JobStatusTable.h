@@ -0,0 +1,201 @@
+#ifndef JOB_STATUS_TABLE_H
+#define JOB_STATUS_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include "JobState.h"
+
+// Layout identification; readers refuse a segment with another magic or version
+const uint32_t JOB_TABLE_MAGIC = 0x54424a43; // "CJBT"
+const uint32_t JOB_TABLE_VERSION = 1;
+
+const char* const JOB_TABLE_DEFAULT_NAME = "/ccm-jobs";
+const uint32_t JOB_TABLE_DEFAULT_CAPACITY = 4096;
+
+// Released slots held back before reuse, as a fraction of the capacity, so a
+// job's final state outlives at least this many later job starts
+const uint32_t JOB_TABLE_RETAIN_DIVISOR = 8;
+
+const size_t JOB_TABLE_ID_SIZE = 64;   // Job id including the terminating NUL; longer ids are truncated
+const size_t JOB_TABLE_CPU_WORDS = 16; // Core mask covers CPUs 0..1023
+
+// JobTableEntry::flags
+const uint8_t JOB_ENTRY_IN_USE = 1 << 0;     // Clear once the job is gone; the rest is its last state
+const uint8_t JOB_ENTRY_CGROUP = 1 << 1;     // Job runs in its own cgroup
+const uint8_t JOB_ENTRY_MIGRATABLE = 1 << 2; // The rebalancer may move it
+
+/**
+ * @brief Published state of one job. Plain data: readers get a consistent
+ * copy through JobStatusReader::read().
+ */
+struct JobTableEntry {
+    char id[JOB_TABLE_ID_SIZE];
+    int32_t pid;                  // 0 while queued or starting
+    uint8_t state;                // JobState
+    uint8_t priorityClass;        // PriorityClass
+    uint8_t flags;                // JOB_ENTRY_*
+    int8_t numaNode;              // -1 if memory is not bound
+    int32_t exitCode;             // -1 unless the job exited normally
+    int32_t termSignal;           // 0 unless a signal ended the job
+    uint32_t migrations;          // Rebalancer moves
+    uint32_t numThreads;
+    int64_t startTime;            // Epoch seconds
+    uint64_t queuedAtNs;          // CLOCK_MONOTONIC time it entered the admission queue (0 = never)
+    uint64_t updatedAtNs;         // CLOCK_MONOTONIC time of this update
+    uint64_t cpus[JOB_TABLE_CPU_WORDS]; // Bit n of word n / 64 = CPU n
+    uint64_t cpuTimeNs;           // JobStats counters, see JobStats.h
+    uint64_t runDelayNs;
+    uint64_t rssBytes;
+    uint64_t readBytes;
+    uint64_t writeBytes;
+    uint64_t voluntaryCtxSwitches;
+    uint64_t involuntaryCtxSwitches;
+    uint64_t sampledAtNs;         // 0 until the stats thread has sampled the job
+    uint64_t cgroupCpuUsageUsec;  // Whole job cgroup (zero without one)
+    uint64_t cgroupThrottledUsec;
+    uint64_t cgroupMemoryBytes;
+    float cpuPercent;
+    float waitPercent;
+};
+
+/**
+ * @brief A table slot: the entry guarded by its own sequence counter. The
+ * manager makes it odd before writing and even again afterwards.
+ */
+struct alignas(64) JobTableSlot {
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+    JobTableEntry entry;
+};
+
+/**
+ * @brief Start of the segment, followed by 'capacity' slots at 'slotOffset'.
+ */
+struct alignas(64) JobTableHeader {
+    std::atomic<uint32_t> magic; // Stored last, once the rest of the segment is initialised
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slotSize;           // sizeof(JobTableSlot)
+    uint32_t slotOffset;         // sizeof(JobTableHeader)
+    int32_t managerPid;
+    std::atomic<uint32_t> highWater; // Slots at or above this index have never been used
+    std::atomic<uint32_t> liveJobs;  // Slots with JOB_ENTRY_IN_USE
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the job table needs lock-free 32-bit atomics");
+
+/**
+ * @brief Reads "StatusTable": { "Name": "/ccm-jobs", "Capacity": 4096 } from a
+ * JSON config file such as mq.json. An empty name disables the table.
+ * @return false if the file cannot be read or parsed; the outputs are left unchanged.
+ */
+bool load_status_table_settings(const std::string& path, std::string& name, uint32_t& capacity);
+
+/**
+ * @brief Manager side of the job table: a POSIX shared-memory segment
+ * holding one fixed-size slot per tracked job.
+ * Each slot is a seqlock with a single writer (the caller holding the job's
+ * tracker shard lock), so monitoring processes can map the segment read-only
+ * and copy any job's state without an IPC round trip or a lock on this side.
+ * Slot claims and releases are serialised internally. Released slots are
+ * reused oldest first and only once capacity / JOB_TABLE_RETAIN_DIVISOR of
+ * them have piled up (or the table is otherwise full), so the final state of
+ * a short-lived job stays readable to pollers for a while.
+ */
+class JobStatusTable {
+public:
+    JobStatusTable() = default;
+    ~JobStatusTable();
+    JobStatusTable(const JobStatusTable&) = delete;
+    JobStatusTable& operator=(const JobStatusTable&) = delete;
+
+    /**
+     * @brief Creates (or takes over and resets) the segment.
+     * @param name shm_open() name such as "/ccm-jobs".
+     * @return false if the segment could not be created or mapped.
+     */
+    bool create(const std::string& name, uint32_t capacity);
+    bool isOpen() const { return header != nullptr; }
+
+    /**
+     * @brief Reserves a slot for a new job.
+     * @return The slot index, or -1 if the table is closed or full.
+     */
+    int claim();
+
+    /**
+     * @brief Copies 'entry' into the slot under its seqlock.
+     */
+    void publish(int slot, const JobTableEntry& entry);
+
+    /**
+     * @brief Clears JOB_ENTRY_IN_USE and returns the slot to the free list.
+     */
+    void release(int slot);
+
+    /**
+     * @brief Unmaps and unlinks the segment; readers keep their mapping.
+     */
+    void close();
+
+private:
+    JobTableHeader* header = nullptr;
+    JobTableSlot* slots = nullptr;
+    size_t mappedBytes = 0;
+    std::string name;
+
+    std::mutex freeMutex;
+    std::deque<uint32_t> freeSlots; // Released slots, oldest first
+};
+
+/**
+ * @brief Client side: maps a manager's job table read-only. Never blocks the
+ * manager; a read that keeps racing with updates is retried a bounded number
+ * of times.
+ */
+class JobStatusReader {
+public:
+    JobStatusReader() = default;
+    ~JobStatusReader();
+    JobStatusReader(const JobStatusReader&) = delete;
+    JobStatusReader& operator=(const JobStatusReader&) = delete;
+
+    /**
+     * @return false if the segment does not exist or has an unknown layout.
+     */
+    bool open(const std::string& name = JOB_TABLE_DEFAULT_NAME);
+
+    /**
+     * @brief Copies one slot.
+     * @return false if the slot is free or could not be read consistently.
+     */
+    bool read(uint32_t slot, JobTableEntry& out) const;
+
+    /**
+     * @brief Copies one slot whether or not it is in use: a released slot still
+     * holds the final state (exit code, FINISHED/TERMINATED) of its last job.
+     * @return false if the slot could not be read consistently.
+     */
+    bool readAny(uint32_t slot, JobTableEntry& out) const;
+
+    /**
+     * @brief Copies every job that is currently in use.
+     */
+    void snapshot(std::vector<JobTableEntry>& out) const;
+
+    uint32_t capacity() const { return header ? header->capacity : 0; }
+    uint32_t liveJobs() const { return header ? header->liveJobs.load(std::memory_order_relaxed) : 0; }
+    // Slots at or above this index have never been used
+    uint32_t usedSlots() const { return header ? header->highWater.load(std::memory_order_acquire) : 0; }
+
+private:
+    const JobTableHeader* header = nullptr;
+    const JobTableSlot* slots = nullptr;
+    size_t mappedBytes = 0;
+};
+
+#endif // JOB_STATUS_TABLE_H
@@ -0,0 +1,59 @@
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include <sys/types.h>
+#include <sched.h>
+
+/**
+ * @brief Everything the child needs between clone and exec.
+ * All pointers must stay valid until launch_process() returns.
+ */
+struct LaunchRequest {
+    const char* path = nullptr;      // Program to exec
+    char* const* argv = nullptr;     // Null-terminated, argv[0] included
+    char* const* envp = nullptr;     // nullptr inherits the manager's environment
+    const cpu_set_t* cpuMask = nullptr; // Affinity applied in the child before exec
+    size_t cpuMaskSize = 0;          // Size in bytes of *cpuMask
+    int cgroupProcsFd = -1;          // Open cgroup.procs to join before exec (-1 = none)
+    int memPolicyMode = -1;          // set_mempolicy() mode for the child (-1 = inherit)
+    const unsigned long* nodeMask = nullptr; // NUMA node bitmask for memPolicyMode
+    unsigned long maxNode = 0;       // Bits in *nodeMask plus one, as set_mempolicy() expects
+    int schedPolicy = -1;            // sched_setscheduler() policy for the child (-1 = inherit)
+    int schedPriority = 0;           // sched_priority that goes with schedPolicy
+    int nice = 0;                    // Nice value for the child (0 = inherit)
+    bool reparent = false;           // CLONE_PARENT: the child becomes a child of the caller's parent
+};
+
+/**
+ * @brief Outcome of a launch. On failure pid is -1 and error holds the errno.
+ */
+struct LaunchResult {
+    pid_t pid = -1;
+    int pidfd = -1;        // pidfd from CLONE_PIDFD, -1 if the kernel lacks it
+    int error = 0;         // errno of clone or execve
+    int affinityError = 0; // errno of sched_setaffinity in the child (not fatal)
+    int cgroupError = 0;   // errno of the cgroup.procs write in the child (not fatal)
+    int memPolicyError = 0; // errno of set_mempolicy in the child (not fatal)
+    int schedError = 0;    // errno of sched_setscheduler or setpriority in the child (not fatal)
+    pid_t strayPid = -1;   // Reparented child whose exec failed; its new parent must reap it
+};
+
+/**
+ * @brief Starts a program with clone(CLONE_VM | CLONE_VFORK).
+ * The child shares the manager's memory instead of copying its page tables,
+ * applies the affinity mask, memory policy, cgroup and scheduling policy
+ * itself and then execs. The calling thread is suspended until the exec
+ * succeeds or fails, so exec errors are reported synchronously. Only the
+ * calling thread pauses; other manager threads keep running, and no locks are
+ * needed across the call. With req.reparent the child belongs to the
+ * caller's parent instead (see ZygotePool).
+ */
+LaunchResult launch_process(const LaunchRequest& req);
+
+/**
+ * @brief Re-pins a running process, including every thread in /proc/[pid]/task.
+ * @return 0 on success, otherwise the errno of the first thread that failed.
+ */
+int set_process_affinity(pid_t pid, const cpu_set_t* mask, size_t maskSize);
+
+#endif // LAUNCHER_H
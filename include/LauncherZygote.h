@@ -0,0 +1,91 @@
+#ifndef LAUNCHER_ZYGOTE_H
+#define LAUNCHER_ZYGOTE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <sys/types.h>
+#include "Launcher.h"
+#include "CpuMask.h"
+#include "CpuTopology.h"
+
+// Largest encoded spawn request (path, argv and masks); bigger ones are launched in-process
+const size_t ZYGOTE_MAX_REQUEST = 64 * 1024;
+const size_t ZYGOTE_MAX_ARGS = 4096;
+
+enum ZygoteMode {
+    ZYGOTE_OFF = 0,
+    ZYGOTE_PER_CORE = 1, // One zygote pinned to each logical CPU
+    ZYGOTE_PER_NODE = 2  // One zygote pinned to the CPUs of each NUMA node
+};
+
+/**
+ * @brief Reads "Launcher": { "Zygotes": "off" | "core" | "node" } from a JSON
+ * config file such as mq.json. Defaults to off.
+ * @return false if the file cannot be read or parsed; 'mode' is left unchanged.
+ */
+bool load_zygote_mode(const std::string& path, ZygoteMode& mode);
+
+/**
+ * @brief Pre-forked launcher helpers ("zygotes"), each pinned to one core or
+ * NUMA node. A zygote is a single-threaded process that waits on a
+ * SOCK_SEQPACKET socketpair for spawn requests and runs launch_process() with
+ * CLONE_PARENT, so the job is still the manager's child (reaped through its
+ * pidfd as before) but inherits the zygote's pinning and is cloned from a
+ * process with one thread and no locks. The pidfd and the job's cgroup.procs
+ * fd travel over the socket with SCM_RIGHTS.
+ *
+ * Each zygote serves one request at a time. A dead zygote is reaped and its
+ * requests fall back to launch_process() in the manager.
+ *
+ * Off by default: on an idle host the socket round trip makes a zygote launch
+ * slower than launch_process() in the manager. Zygotes win once the manager's
+ * own threads keep its CPUs busy, since the launching thread otherwise waits
+ * for its vfork child to be scheduled against them (tools/ccm_bench_spawn.cpp
+ * --threads shows both cases).
+ */
+class ZygotePool {
+public:
+    ZygotePool() = default;
+    ~ZygotePool();
+    ZygotePool(const ZygotePool&) = delete;
+    ZygotePool& operator=(const ZygotePool&) = delete;
+
+    /**
+     * @brief Forks the zygotes. Call from the main thread (a zygote dies with the
+     * thread that forked it) and before the manager starts its threads.
+     * @return false if no zygote could be started.
+     */
+    bool start(ZygoteMode mode, const CpuTopology& topology);
+
+    /**
+     * @brief Closes the sockets and reaps the zygotes. No launch may be in flight.
+     */
+    void stop();
+
+    size_t size() const { return zygotes.size(); }
+
+    /**
+     * @brief Launches through the zygote that covers the first CPU of 'cpus'.
+     * The affinity mask is dropped from the request when it equals the zygote's own.
+     * @return false if no live zygote could take the request (nothing was started).
+     */
+    bool launch(const LaunchRequest& req, const CpuMask& cpus, LaunchResult& result);
+
+private:
+    struct Zygote {
+        pid_t pid = -1;
+        int socket = -1;           // Manager end of the socketpair, -1 once the zygote is gone
+        std::vector<int> cpus;     // What the zygote is pinned to
+        std::mutex mutex;          // One request in flight per zygote
+        std::vector<char> buffer;  // Encoded request, reused under 'mutex'
+    };
+
+    void retire(Zygote& zygote, const char* reason);
+
+    std::vector<std::unique_ptr<Zygote>> zygotes;
+    std::vector<int> zygoteOfCpu; // Index into zygotes, -1 for CPUs without one
+};
+
+#endif // LAUNCHER_ZYGOTE_H
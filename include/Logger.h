@@ -0,0 +1,149 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Severity of a log record. Records below the configured level are
+ * skipped before any formatting happens.
+ */
+enum LogLevel : uint8_t {
+    LEVEL_DEBUG = 0, // Per-message traces ("-- Received Message --")
+    LEVEL_INFO = 1,
+    LEVEL_WARN = 2,  // Written to stderr from here on
+    LEVEL_ERROR = 3,
+    LEVEL_OFF = 4
+};
+
+const size_t LOG_RING_BYTES = 256 * 1024; // Per-thread ring; records that do not fit are dropped and counted
+const size_t LOG_LINE_MAX = 2048;         // Longer records are truncated
+const int LOG_FLUSH_INTERVAL_MS = 10;     // Writer thread drain period
+
+struct LogSettings {
+    LogLevel level = LEVEL_INFO;
+    bool timestamps = false; // Prefix each record with the wall-clock time it was logged
+};
+
+/**
+ * @brief Maps "debug", "info", "warn", "error" or "off" to a level; anything else gives LEVEL_INFO.
+ */
+LogLevel log_level_from_string(const std::string& name);
+
+/**
+ * @brief Reads "Logging": { "Level": "info", "Timestamps": false } from a JSON
+ * config file such as mq.json.
+ * @return false if the file cannot be read or parsed; 'settings' is left unchanged.
+ */
+bool load_log_settings(const std::string& path, LogSettings& settings);
+
+/**
+ * @brief Asynchronous log backend.
+ * Each thread appends finished records to its own single-producer ring, so
+ * logging costs a clock read and a memcpy: no lock, no allocation and no
+ * syscall on the caller's path. A background thread drains every ring each
+ * LOG_FLUSH_INTERVAL_MS, orders the records by time and writes them with one
+ * write() per stream. A full ring drops records instead of blocking; the drop
+ * count is reported by the writer.
+ * Not async-signal-safe: never log between clone/fork and exec (the launcher's
+ * child reports its errors through LaunchResult instead).
+ */
+class Logger {
+public:
+    static Logger& instance();
+
+    void configure(const LogSettings& settings);
+    bool enabled(LogLevel level) const { return level >= minLevel.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Appends one record to the calling thread's ring.
+     */
+    void append(LogLevel level, const char* text, size_t len);
+
+    /**
+     * @brief Writes out everything logged so far, from the calling thread.
+     * Called at shutdown and at exit.
+     */
+    void flush();
+
+private:
+    struct Ring;
+    struct Record {
+        uint64_t timeNs;
+        LogLevel level;
+        std::string text;
+    };
+
+    Logger();
+    Ring* registerThread();
+    void run();
+    // Drains all rings and writes the records. Caller holds drainMutex.
+    void drainLocked();
+
+    std::atomic<uint8_t> minLevel{LEVEL_INFO};
+    std::atomic<bool> timestamps{false};
+    int64_t realtimeOffsetNs; // CLOCK_REALTIME - CLOCK_MONOTONIC at startup
+
+    std::mutex ringsMutex; // Guards rings; taken once per thread and by the writer
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    std::mutex drainMutex; // One consumer at a time (writer thread or flush())
+    std::vector<Record> batch;
+    std::string out[2];    // stdout and stderr buffers
+    uint64_t reportedDrops = 0;
+    uint64_t retiredDrops = 0; // Drops of rings whose thread has exited
+
+    std::thread writer;
+};
+
+/**
+ * @brief One record, built on the stack and handed to the logger when the
+ * statement ends. Use through the CCM_* macros.
+ */
+class LogLine {
+public:
+    explicit LogLine(LogLevel level) : level(level) {}
+    ~LogLine() { Logger::instance().append(level, buf, len); }
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(const char* s);
+    LogLine& operator<<(const std::string& s) { return write(s.data(), s.size()); }
+    LogLine& operator<<(char c) { return write(&c, 1); }
+    LogLine& operator<<(bool b) { return *this << (b ? "1" : "0"); }
+    LogLine& operator<<(int v) { return *this << static_cast<long long>(v); }
+    LogLine& operator<<(long v) { return *this << static_cast<long long>(v); }
+    LogLine& operator<<(long long v);
+    LogLine& operator<<(unsigned v) { return *this << static_cast<unsigned long long>(v); }
+    LogLine& operator<<(unsigned long v) { return *this << static_cast<unsigned long long>(v); }
+    LogLine& operator<<(unsigned long long v);
+    LogLine& operator<<(float v) { return *this << static_cast<double>(v); }
+    LogLine& operator<<(double v);
+
+    LogLine& write(const char* s, size_t n);
+
+private:
+    LogLevel level;
+    size_t len = 0;
+    char buf[LOG_LINE_MAX];
+};
+
+// Lets the macros below expand to a single expression (safe inside if/else)
+struct LogVoidify {
+    void operator&(const LogLine&) {}
+};
+
+#define CCM_LOG(level) \
+    !Logger::instance().enabled(level) ? (void)0 : LogVoidify() & LogLine(level)
+#define CCM_DEBUG CCM_LOG(LEVEL_DEBUG)
+#define CCM_INFO CCM_LOG(LEVEL_INFO)
+#define CCM_WARN CCM_LOG(LEVEL_WARN)
+#define CCM_ERROR CCM_LOG(LEVEL_ERROR)
+
+#endif // LOGGER_H
@@ -0,0 +1,225 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+/*
+ * Histogram layout (HDR-style, log-linear): values below 2^HISTOGRAM_SUB_BITS
+ * get a bucket each; every power of two above is split into
+ * 2^HISTOGRAM_SUB_BITS equal buckets, so any recorded value is known to within
+ * 1/16 (6.25%). Values are nanoseconds; anything from 2^HISTOGRAM_MAX_BITS
+ * (about 18 minutes) up lands in the last bucket.
+ */
+const int HISTOGRAM_SUB_BITS = 4;
+const int HISTOGRAM_MAX_BITS = 40;
+const size_t HISTOGRAM_BUCKETS = static_cast<size_t>(HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS;
+
+// Exported Prometheus buckets: le = 2^k ns for k in this range (about 1us to 69s)
+const int METRICS_EXPORT_MIN_BIT = 10;
+const int METRICS_EXPORT_MAX_BIT = 36;
+
+const int METRICS_DEFAULT_INTERVAL_MS = 1000; // File rewrite period
+
+/**
+ * @brief Instrumented stages of the manager. Each one has a latency histogram.
+ */
+enum MetricStage : uint8_t {
+    STAGE_DECODE = 0,         // Decoding and routing one queue message
+    STAGE_DISPATCH_WAIT = 1,  // Command queued for its worker until the worker picks it up
+    STAGE_LOCK_WAIT = 2,      // Acquiring a tracker shard mutex (0 when uncontended)
+    STAGE_PLACEMENT = 3,      // Core allocator decision for one job
+    STAGE_SPAWN = 4,          // launch_process(): clone, setup and exec
+    STAGE_REAP = 5,           // Monitor wakeup until the exit is handled
+    STAGE_ADMISSION_WAIT = 6, // Time a job spent in the admission queue
+    STAGE_LOAD_SAMPLE = 7,    // One /proc/stat pass of the core load sampler
+    STAGE_COUNT = 8
+};
+
+/**
+ * @brief Monotonic event counters.
+ */
+enum MetricCounter : uint8_t {
+    COUNTER_MESSAGES = 0,        // Queue messages received
+    COUNTER_COMMANDS = 1,        // Commands dispatched to a handler
+    COUNTER_JOBS_STARTED = 2,
+    COUNTER_START_FAILURES = 3,  // StartJobs that failed to launch
+    COUNTER_JOBS_QUEUED = 4,     // StartJobs that had to wait for admission
+    COUNTER_JOBS_EXITED = 5,     // Exits handled by the monitor
+    COUNTER_KILLS_ESCALATED = 6, // Terminations that needed SIGKILL
+    COUNTER_MIGRATIONS = 7,      // Jobs moved by the rebalancer
+    COUNTER_REPLIES_DROPPED = 8, // Replies that could not be delivered
+    COUNTER_COUNT = 9
+};
+
+const char* metric_stage_name(MetricStage stage);
+
+/**
+ * @brief CLOCK_MONOTONIC in nanoseconds (vDSO, no syscall).
+ */
+uint64_t metrics_now_ns();
+
+/**
+ * @brief Point-in-time copy of a LatencyHistogram.
+ */
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts; // One per bucket
+    uint64_t count = 0;
+    uint64_t sum = 0;             // Nanoseconds
+
+    /**
+     * @brief Value at quantile q (0..1): the midpoint of the bucket that holds it.
+     */
+    uint64_t valueAt(double q) const;
+
+    /**
+     * @brief Number of values below 'bound' (bound itself excluded), exact when
+     * bound is a power of two.
+     */
+    uint64_t countBelow(uint64_t bound) const;
+};
+
+/**
+ * @brief Lock-free latency histogram. record() is a few relaxed atomic
+ * increments; threads recording at the same time never wait for each other
+ * or for an exporter taking a snapshot.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t ns);
+    void snapshot(HistogramSnapshot& out) const;
+
+    static size_t bucketOf(uint64_t ns);
+    static uint64_t bucketLowerBound(size_t bucket);
+    static uint64_t bucketUpperBound(size_t bucket); // Exclusive
+
+private:
+    std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> sum{0};
+};
+
+/**
+ * @brief Process-wide stage histograms and counters. Always on: recording
+ * costs one or two clock reads plus relaxed atomic increments.
+ */
+class Metrics {
+public:
+    static Metrics& instance();
+
+    LatencyHistogram& stage(MetricStage s) { return stages[s]; }
+    void record(MetricStage s, uint64_t ns) { stages[s].record(ns); }
+    void count(MetricCounter c, uint64_t n = 1) { counters[c].fetch_add(n, std::memory_order_relaxed); }
+    uint64_t counter(MetricCounter c) const { return counters[c].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Appends every histogram and counter in Prometheus text format.
+     */
+    void writePrometheus(std::string& out) const;
+
+private:
+    Metrics() = default;
+
+    LatencyHistogram stages[STAGE_COUNT];
+    std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+};
+
+/**
+ * @brief Records the time from construction to destruction into a stage.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(MetricStage s) : stage(s), start(metrics_now_ns()) {}
+    ~StageTimer() { Metrics::instance().record(stage, metrics_now_ns() - start); }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    MetricStage stage;
+    uint64_t start;
+};
+
+/**
+ * @brief std::lock_guard that records the wait into STAGE_LOCK_WAIT. The
+ * uncontended path (try_lock succeeds) records 0 without reading the clock.
+ */
+class TimedLockGuard {
+public:
+    explicit TimedLockGuard(std::mutex& m) : mutex(m)
+    {
+        if (m.try_lock()) {
+            Metrics::instance().record(STAGE_LOCK_WAIT, 0);
+            return;
+        }
+        uint64_t start = metrics_now_ns();
+        m.lock();
+        Metrics::instance().record(STAGE_LOCK_WAIT, metrics_now_ns() - start);
+    }
+    ~TimedLockGuard() { mutex.unlock(); }
+    TimedLockGuard(const TimedLockGuard&) = delete;
+    TimedLockGuard& operator=(const TimedLockGuard&) = delete;
+
+private:
+    std::mutex& mutex;
+};
+
+struct MetricsSettings {
+    std::string file;   // Rewritten every intervalMs (written to file + ".tmp", then renamed)
+    std::string socket; // Unix stream socket; each connection receives one scrape
+    int intervalMs = METRICS_DEFAULT_INTERVAL_MS;
+
+    bool enabled() const { return !file.empty() || !socket.empty(); }
+};
+
+/**
+ * @brief Reads "Metrics": { "File": "ccm.prom", "Socket": "/run/ccm/metrics.sock",
+ * "IntervalMs": 1000 } from a JSON config file such as mq.json. Both paths
+ * default to empty (no export).
+ * @return false if the file cannot be read or parsed; 'settings' is left unchanged.
+ */
+bool load_metrics_settings(const std::string& path, MetricsSettings& settings);
+
+/**
+ * @brief Serves Prometheus text from a background thread: rewrites a file
+ * periodically and/or answers connections on a Unix socket with a fresh
+ * rendering (e.g. curl --unix-socket PATH http://x/ or socat - UNIX:PATH).
+ */
+class MetricsExporter {
+public:
+    using Renderer = std::function<void(std::string&)>;
+
+    MetricsExporter() = default;
+    ~MetricsExporter();
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    /**
+     * @brief Binds the socket (replacing a stale one) and starts the thread.
+     * @return false if nothing could be exported.
+     */
+    bool start(const MetricsSettings& settings, Renderer render);
+    void stop();
+
+private:
+    void run();
+    void writeFile(const std::string& text);
+    void serveClient(int fd, const std::string& text);
+
+    MetricsSettings settings;
+    Renderer render;
+    int listenFd = -1;
+    std::thread thread;
+    std::mutex stopMutex;
+    std::condition_variable stopCv;
+    bool stopping = false;
+};
+
+#endif // METRICS_H
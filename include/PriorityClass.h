@@ -0,0 +1,45 @@
+#ifndef PRIORITY_CLASS_H
+#define PRIORITY_CLASS_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Scheduling class of a job. PRIO_NORMAL is 0 so commands that do not
+ * name a class (and binary frames with the byte left at 0) keep the old behaviour.
+ */
+enum PriorityClass : uint8_t {
+    PRIO_NORMAL = 0,   // SCHED_OTHER, nice 0
+    PRIO_REALTIME = 1, // SCHED_FIFO; never shares a core with batch or idle jobs
+    PRIO_LATENCY = 2,  // SCHED_OTHER with a negative nice value
+    PRIO_BATCH = 3,    // SCHED_BATCH with a positive nice value
+    PRIO_IDLE = 4      // SCHED_IDLE, only runs when nothing else wants the core
+};
+
+const int PRIORITY_CLASS_COUNT = 5;
+
+/**
+ * @brief Maps a StartJob "PriorityClass" value ("realtime", "latency", "normal",
+ * "batch", "idle") to a class. Unknown or empty names select PRIO_NORMAL.
+ */
+PriorityClass priority_class_from_string(const std::string& name);
+const char* priority_class_name(PriorityClass cls);
+
+/**
+ * @brief true for the classes kept off cores that run realtime jobs.
+ */
+inline bool is_background_class(PriorityClass cls) { return cls == PRIO_BATCH || cls == PRIO_IDLE; }
+
+/**
+ * @brief How the launcher applies a class to the child before exec.
+ */
+struct SchedulingParams {
+    int policy = -1;      // sched_setscheduler() policy, -1 leaves SCHED_OTHER untouched
+    int rtPriority = 0;   // sched_priority for SCHED_FIFO
+    int nice = 0;         // setpriority() value, applied when non-zero
+    int cgroupWeight = 0; // cgroup v2 cpu.weight of the class group (0 = leave the default)
+};
+
+SchedulingParams scheduling_params_for(PriorityClass cls);
+
+#endif // PRIORITY_CLASS_H
@@ -0,0 +1,100 @@
+#ifndef PROC_SCANNER_H
+#define PROC_SCANNER_H
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <sys/types.h>
+
+/**
+ * @brief Selected fields of /proc/[pid]/stat (see proc(5) for numbering).
+ */
+struct ProcStatFields {
+    char state = '?';                     // (3)
+    unsigned long long minorFaults = 0;   // (10)
+    unsigned long long majorFaults = 0;   // (12)
+    unsigned long long utime = 0;         // (14) clock ticks
+    unsigned long long stime = 0;         // (15) clock ticks
+    long numThreads = 0;                  // (20)
+    unsigned long long startTime = 0;     // (22) clock ticks since boot
+    unsigned long long vsize = 0;         // (23) bytes
+    long long rssPages = 0;               // (24)
+    int processor = -1;                   // (39) CPU last run on
+};
+
+/**
+ * @brief Parses one /proc/[pid]/stat line.
+ * The command name (field 2) may contain spaces and parentheses, so parsing
+ * starts after the last ')' in the line.
+ * @return false if the line is truncated or malformed.
+ */
+bool parse_proc_stat(const char* buf, size_t len, ProcStatFields& out);
+
+/**
+ * @brief One-off read of /proc/[pid]/stat without a scanner (open, read, close).
+ * @return false if the process does not exist.
+ */
+bool read_proc_stat(pid_t pid, ProcStatFields& out);
+
+/**
+ * @brief Scanner for /proc/[pid]/stat that avoids per-call allocations.
+ * Directory entries are read with getdents64 into a reusable buffer, and the
+ * stat files of known pids stay open so a refresh is a single pread() each.
+ * It can scan every pid on the host or only a given set.
+ * Not thread-safe; use one scanner per thread.
+ */
+class ProcScanner {
+public:
+    using Result = std::vector<std::pair<pid_t, ProcStatFields>>;
+
+    /**
+     * @param procRoot Mount point of procfs.
+     * @param maxCachedFds Upper bound on stat files kept open between scans.
+     */
+    explicit ProcScanner(const char* procRoot = "/proc", size_t maxCachedFds = 4096);
+    ~ProcScanner();
+
+    ProcScanner(const ProcScanner&) = delete;
+    ProcScanner& operator=(const ProcScanner&) = delete;
+
+    /**
+     * @brief Lists /proc and refreshes every pid. Cached fds of pids that
+     * disappeared are closed.
+     * @param out Cleared and filled; its capacity is reused between calls.
+     */
+    bool scanAll(Result& out);
+
+    /**
+     * @brief Refreshes only the given pids (e.g. the jobs CCM tracks).
+     * Pids that no longer exist are left out of 'out', which keeps the input
+     * order. Cached fds of pids that are not in the list are closed.
+     */
+    bool scanPids(const std::vector<pid_t>& pids, Result& out);
+
+    /**
+     * @brief Reads a single pid. Returns false if it no longer exists.
+     */
+    bool read(pid_t pid, ProcStatFields& fields);
+
+private:
+    struct CachedStat {
+        int fd = -1;
+        unsigned generation = 0; // Last scan that saw this pid
+    };
+
+    bool readStat(pid_t pid, CachedStat& entry, ProcStatFields& fields);
+    void dropEntry(pid_t pid);
+    // Closes every cached entry not seen in the current generation
+    void dropStale();
+
+    int procFd = -1;
+    size_t maxFds;
+    size_t openFds = 0;
+    unsigned generation = 0;
+    std::vector<char> dirBuffer;
+    std::vector<char> statBuffer;
+    std::unordered_map<pid_t, CachedStat> cache;
+    std::vector<pid_t> stale; // Scratch list of pids to drop after a scan
+};
+
+#endif // PROC_SCANNER_H
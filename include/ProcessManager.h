@@ -8,6 +8,9 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <memory>
 
 // Unix/Linux Specific Headers for Process Control Data Types
 // Required for pid_t and signal constants
@@ -15,7 +18,20 @@
 #include <signal.h> 
 #include "MessageQueue.h"
 #include "TrackedProcess.h"
+#include "ProcessTracker.h"
+#include "CoreLoadSampler.h"
+#include "CoreAllocator.h"
+#include "JobStats.h"
 #include "Command.h"
+#include "CommandCodec.h"
+#include "ReplyChannel.h"
+#include "Admission.h"
+#include "PriorityClass.h"
+#include "JobCgroup.h"
+#include "JobJournal.h"
+#include "JobStatusTable.h"
+#include "Metrics.h"
+#include "LauncherZygote.h"
 
 // --- Configuration ---
 // Signals for controlling processes
@@ -24,6 +40,77 @@ const int SIG_PAUSE = SIGSTOP;
 const int SIG_RESUME = SIGCONT;
 const int SIG_TERMINATE = SIGTERM;
 
+// Size of the NUMA node mask handed to set_mempolicy() for "numa" placement
+const int NUMA_BITS_PER_WORD = 8 * sizeof(unsigned long);
+const int NUMA_NODEMASK_WORDS = 1024 / NUMA_BITS_PER_WORD;
+
+// Interval between per-job resource samples
+const int JOB_STATS_INTERVAL_MS = 1000;
+
+// Rebalancer: how often it runs, when a core counts as hot, how much cooler the
+// target must be (hysteresis), how many jobs one pass may move and how long a
+// moved job stays put so its caches can warm up again
+const int REBALANCE_INTERVAL_MS = 5000;
+const double REBALANCE_HOT_LOAD_PCT = 85.0;
+const double REBALANCE_MIN_WAIT_PCT = 10.0;
+const double REBALANCE_HYSTERESIS_PCT = 30.0;
+const int REBALANCE_MAX_MIGRATIONS = 2;
+const int REBALANCE_COOLDOWN_MS = 30000;
+
+// Size of the command worker pool (clamped hardware concurrency)
+const size_t COMMAND_WORKERS_MIN = 2;
+const size_t COMMAND_WORKERS_MAX = 8;
+// Finished command tasks kept for the binary decoder to fill again
+const size_t SPARE_TASKS_MAX = 64;
+
+// Time a terminated job gets to exit after SIGTERM before it is sent SIGKILL
+const int TERMINATE_GRACE_MS = 5000;
+// Poll interval while reaping a child dropped before it was tracked
+const int UNTRACKED_REAP_POLL_MS = 10;
+
+// Maximum number of epoll events handled per monitor wakeup
+const int MONITOR_MAX_EVENTS = 64;
+// Sweep interval for tracked processes without a pidfd (e.g. pidfd_open() unsupported)
+const int MONITOR_FALLBACK_SWEEP_MS = 50;
+
+// Posted to the command queue by stop() to release the receiver from receive()
+const char* const RECEIVER_WAKE_MESSAGE = "{\"command\":\"wake\",\"parameters\":{}}";
+
+
+/**
+ * @brief Results of the commands of one message. Every command owns one slot;
+ * the worker that finishes the last command sends the combined reply.
+ */
+struct ReplyGroup {
+    std::string replyQueue;
+    std::string correlationId;
+    std::vector<std::vector<CommandResult>> slots; // In message order
+    std::atomic<size_t> remaining{0};
+};
+
+/**
+ * @brief One decoded command waiting for a worker.
+ */
+struct CommandTask {
+    Command cmd;
+    std::string error; // Set when decoding failed; the worker only reports it
+    std::shared_ptr<ReplyGroup> group; // Null when no reply was requested
+    bool admitted = false; // StartJob released from the admission queue
+    CpuMask reservation;   // Cores reserved for it by the admission controller
+    size_t slot = 0;
+    uint64_t enqueuedNs = 0; // Handed to its worker (metrics_now_ns())
+};
+
+/**
+ * @brief A command worker and its queue. Commands are sharded by job id, so
+ * all commands for one job run on the same worker in the order received.
+ */
+struct CommandWorker {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<CommandTask> tasks;
+};
 
 /**
  * @brief Manages the lifecycle of external processes using fork, exec, and signals.
@@ -32,11 +119,43 @@ const int SIG_TERMINATE = SIGTERM;
 class ProcessManager {
 public:
     MessageQueue* queue;
-    std::map<std::string, TrackedProcess> runningProcesses;
-    std::mutex trackerMutex;
+    ShardedProcessTracker runningProcesses; // Lock-striped, indexed by job id and by OS pid
+    CoreLoadSampler loadSampler;
+    CoreAllocator coreAllocator{loadSampler}; // Must follow loadSampler
+    JobCgroups cgroups; // Per-job cgroup v2 groups, unused unless opened
+    JobJournal journal; // State transitions of running jobs, replayed after a restart
+    JobStatusTable statusTable; // Shared-memory job table for monitoring clients, unused unless created
+    ZygotePool zygotes; // Pre-forked per-core launchers, unused unless started
     std::thread commandProcessorThread;
+    std::thread receiverThread;
     std::thread monitorThread;
-    bool running = false;
+    std::thread statsThread;
+    JobStatsReader statsReader;       // Only used by statsThread
+    JobStatsReader::Batch statsBatch; // Reused between passes
+    std::vector<size_t> statsShardEnds; // End of each shard's range in statsBatch
+    std::vector<JobCgroup> statsCgroups; // Cgroup of each statsBatch entry
+    std::vector<std::unique_ptr<CommandWorker>> workers;
+    std::vector<std::pair<size_t, CommandTask>> routedTasks; // Worker index + task, command processor only
+    std::mutex spareTasksMutex;
+    std::vector<CommandTask> spareTasks; // Finished tasks whose Command capacity the binary decoder reuses
+    ReplyChannel replies;
+    std::atomic<uint64_t> nextJobId{1};   // Suffix for generated job ids
+    std::mutex admissionMutex;  // Guards pendingJobs and each admit-or-queue decision
+    PendingJobQueue pendingJobs; // StartJobs waiting for capacity
+    std::atomic<bool> capacityFreed{false}; // Set when a job is removed, cleared by the monitor
+    std::mutex killMutex;
+    std::multimap<uint64_t, std::pair<std::string, pid_t>> killDeadlines; // SIGKILL due time -> job
+    std::mutex stopMutex;             // Lets periodic threads sleep interruptibly
+    std::condition_variable stopCv;
+    std::deque<std::string> pendingMessages; // Raw messages received but not yet dispatched
+    std::mutex pendingMutex;
+    std::condition_variable pendingCv;
+    std::atomic<bool> running{false};
+    int epollFd = -1; // epoll set watching one pidfd per tracked process
+    int wakeFd = -1;  // eventfd used to wake the monitor on shutdown
+    std::atomic<bool> pidfdSupported{true}; // Cleared when pidfd_open() or waitid(P_PIDFD) is missing
+    std::atomic<int> unwatchedProcesses{0}; // Tracked processes without a pidfd
+    MetricsExporter metricsExporter; // Last member: its thread renders from the ones above
     
     /**
      * @brief Helper to convert std::vector<std::string> to char* const* for execv.
@@ -49,30 +168,212 @@ public:
     void freeArgv(char** argv);
 
     /**
-     * @brief Logic to start an external program via fork and execv.
+     * @brief Logic to start an external program via launch_process(), through a
+     * launcher zygote when they are enabled.
+     * The tracker lock is only held to claim the id and to record the result,
+     * never across the spawn itself.
+     * A job that does not fit the admission limits is queued instead ("queued").
+     * @param reservation Cores already reserved by admitPending(), or nullptr.
+     * @return The assigned pid, cores and status, or the reason the launch failed.
+     */
+    CommandResult startProgram(const Command& cmd, CpuMask* reservation = nullptr);
+
+    /**
+     * @brief Starts queued jobs, highest priority first, for as long as the
+     * admission controller finds room. A job that does not fit blocks the ones
+     * behind it, so lower priorities cannot starve it.
+     */
+    void admitPending();
+
+    /**
+     * @brief Removes a job that is still waiting for admission.
+     * @return false if the job is not queued.
+     */
+    bool cancelQueued(const std::string& id, CommandResult& result);
+
+    /**
+     * @brief Index of the worker that runs every command for 'jobId'.
+     */
+    size_t workerFor(const std::string& jobId) const;
+
+    /**
+     * @brief Hands a task to a command worker.
      */
-    void startProgram(const Command& cmd);
+    void enqueueTask(size_t workerIndex, CommandTask&& task);
 
     /**
      * @brief Sends a specified signal to a tracked process and updates its status.
+     * Termination never waits for the child: the job becomes "terminating",
+     * the reaper removes it on exit and SIGKILL follows after TERMINATE_GRACE_MS.
+     * @return The job's status after the signal, or the reason it was not sent.
      */
-    void controlProcess(const std::string& processId, int signalVal, const std::string& newStatus);
+    CommandResult controlProcess(const std::string& processId, int signalVal, JobState newState);
     
     /**
      * @brief Prints the status of all or a specific tracked process.
      */
     void printStatus(const std::string& commandId = "");
 
+    using JobSnapshot = std::vector<std::pair<std::string, TrackedProcess>>;
+
+    /**
+     * @brief Copies one job (or all jobs if commandId is empty) out of the tracker,
+     * locking one shard at a time.
+     */
+    void snapshotJobs(const std::string& commandId, JobSnapshot& out);
+
+    /**
+     * @brief Appends one status result per matching job (all jobs if commandId is empty).
+     */
+    void reportStatus(const std::string& commandId, std::vector<CommandResult>& results);
+
+    /**
+     * @brief Blocks on the message queue and hands raw messages to the command processor
+     * (runs in its own thread).
+     */
+    void receiveMessages();
+
     /**
      * @brief The main loop for processing commands from the queue (runs in its own thread).
+     * Each wakeup drains every pending message, decodes it and routes its commands
+     * to the worker pool.
      */
     void processCommands();
+
+    /**
+     * @brief Decodes one raw message and dispatches the command(s) it carries.
+     * A "StartJobs" message expands into one StartJob per entry of its "Jobs" array.
+     * Messages starting with WIRE_MAGIC take the binary path instead of JSON.
+     */
+    void handleMessage(const std::string& raw);
+
+    /**
+     * @brief Decodes every binary frame in 'raw' in place and dispatches each one.
+     */
+    void handleBinaryMessage(const std::string& raw);
+
+    /**
+     * @brief Routes a single decoded command to its handler and appends its result(s).
+     */
+    void dispatchCommand(CommandTask& task, std::vector<CommandResult>& results);
+
+    /**
+     * @brief Assigns a generated id to an id-less StartJob and queues the task
+     * in routedTasks under the worker that owns its job id.
+     */
+    void routeTask(CommandTask&& task);
+
+    /**
+     * @brief Hands every task in routedTasks to its worker as one reply group.
+     * No reply is sent when replyQueue is empty.
+     */
+    void submitRouted(const std::string& replyQueue, const std::string& correlationId);
+
+    /**
+     * @brief Takes a finished task from spareTasks, or returns a fresh one.
+     */
+    CommandTask takeSpareTask();
+
+    /**
+     * @brief Resets a finished task and keeps it in spareTasks (up to SPARE_TASKS_MAX).
+     */
+    void recycleTask(CommandTask&& task);
+
+    /**
+     * @brief Runs the commands routed to worker 'index' (runs in its own thread).
+     */
+    void runCommandWorker(size_t index);
+
+    /**
+     * @brief Arms the SIGKILL escalation for a job that was sent SIGTERM.
+     */
+    void scheduleKill(const std::string& id, pid_t pid);
+
+    /**
+     * @brief Milliseconds until the next SIGKILL escalation is due, -1 if none.
+     */
+    int nextKillTimeoutMs();
+
+    /**
+     * @brief Sends SIGKILL to every terminating job whose grace period is over.
+     */
+    void escalateTerminations();
+
+    /**
+     * @brief Interrupts the monitor's epoll_wait.
+     */
+    void wakeMonitor();
     
     /**
      * @brief The loop for monitoring exited children (runs in its own thread).
+     * Blocks in epoll_wait on the pidfds of all tracked processes and reaps
+     * every exited child as soon as its pidfd becomes readable.
      */
     void monitorProcesses();
 
+    /**
+     * @brief Adds the pidfd of a newly started process to the epoll set, opening
+     * one with pidfd_open() if the launcher did not provide it.
+     * Must be called with the mutex of the job's shard held.
+     */
+    void watchProcess(TrackedProcess& proc);
+
+    /**
+     * @brief Closes the pidfd, releases the core reservation and drops the entry.
+     * Must be called with shard.mutex held.
+     */
+    void removeProcess(ShardedProcessTracker::Shard& shard, const std::string& id);
+
+    /**
+     * @brief Reaps one tracked process through its pidfd if it has exited.
+     */
+    void reapProcess(pid_t pid);
+
+    /**
+     * @brief Polls tracked processes that have no pidfd (old kernels, fd exhaustion).
+     */
+    void reapUnwatched();
+
+    /**
+     * @brief Copies the job into its slot of the shared status table, claiming
+     * one on first use. Called after every change to the job's state, cores or
+     * stats. Must be called with the job's shard.mutex held.
+     */
+    void publishJob(const std::string& id, TrackedProcess& proc);
+
+    /**
+     * @brief Records the exit status of a reaped child and removes it from the tracker.
+     * Must be called with shard.mutex held, where shard holds the pid.
+     */
+    void handleExit(ShardedProcessTracker::Shard& shard, pid_t pid, int status);
+
+    /**
+     * @brief Periodically samples CPU time, run-queue wait, RSS, I/O and context
+     * switches of every tracked job (runs in its own thread).
+     */
+    void collectJobStats();
+
+    /**
+     * @brief One sampling pass: copies pids and previous stats shard by shard,
+     * reads /proc for all of them without any lock, then stores the results.
+     */
+    void sampleJobStats();
+
+    /**
+     * @brief Moves starving single-core jobs off hot cores (called from the stats thread).
+     * A job qualifies when its core is above REBALANCE_HOT_LOAD_PCT and it spent at
+     * least REBALANCE_MIN_WAIT_PCT of the last interval waiting for a CPU. Targets
+     * must be REBALANCE_HYSTERESIS_PCT cooler, at most REBALANCE_MAX_MIGRATIONS jobs
+     * move per pass, and a moved job is left alone for REBALANCE_COOLDOWN_MS.
+     */
+    void rebalanceJobs();
+
+    /**
+     * @brief Rewrites the journal from a snapshot of the live jobs (called from
+     * the stats thread once the journal has grown past JOURNAL_COMPACT_RATIO).
+     */
+    void compactJournal();
+
     /**
      * @brief Gracefully terminates all remaining tracked processes on shutdown.
      */
@@ -84,6 +385,17 @@ public:
      * @param mq Reference to the thread-safe message queue.
      */
     ProcessManager(MessageQueue* mq);
+
+    /**
+     * @brief Opens the job journal and re-adopts the jobs a previous instance was
+     * running. A job is adopted only if its pid is alive and still has the
+     * recorded /proc start time, so a recycled pid is never mistaken for it.
+     * Adopted jobs get their core reservations back and are watched through a
+     * pidfd; they are no longer our children, so their exit status is unknown.
+     * Call before start().
+     * @return false if the journal could not be opened (jobs are then not journaled).
+     */
+    bool openJournal(const std::string& path);
     
     /**
      * @brief Starts the command processor and monitor worker threads.
@@ -94,6 +406,18 @@ public:
      * @brief Initiates a graceful shutdown of the manager and its threads.
      */
     void stop();
+
+    /**
+     * @brief Appends the stage histograms and counters plus current gauges (tracked
+     * jobs, per-core reservations and load, queue depths) in Prometheus text format.
+     */
+    void writeMetrics(std::string& out);
+
+    /**
+     * @brief Exports writeMetrics() to the configured file and/or socket. Call after start().
+     * @return false if neither could be set up.
+     */
+    bool startMetrics(const MetricsSettings& settings);
 };
 
 #endif // PROCESS_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef PROCESS_TRACKER_H
+#define PROCESS_TRACKER_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <sys/types.h>
+#include "TrackedProcess.h"
+
+/**
+ * @brief Indexed store of tracked processes.
+ * Entries are kept in a node-based hash map keyed by job id, so references stay
+ * valid across inserts and nothing is copied on rehash. A second index maps the
+ * OS pid back to its entry so the reaper can find a job in O(1).
+ * Not thread-safe: callers hold the mutex of the ShardedProcessTracker shard
+ * that owns it.
+ */
+class ProcessTracker {
+public:
+    using Map = std::unordered_map<std::string, TrackedProcess>;
+    using Entry = Map::value_type; // pair<const job id, TrackedProcess>
+
+    /**
+     * @brief Adds a new entry and indexes it by pid. Replaces any entry with the same id.
+     * @return Reference to the stored process, valid until it is erased.
+     */
+    TrackedProcess& insert(const std::string& id, TrackedProcess proc);
+
+    /**
+     * @brief Sets the pid of an entry inserted before its process existed and indexes it.
+     * @return false if the id is not tracked.
+     */
+    bool assignPid(const std::string& id, pid_t pid);
+
+    /**
+     * @brief Looks up a job by id. Returns nullptr if it is not tracked.
+     */
+    TrackedProcess* find(const std::string& id);
+
+    /**
+     * @brief Looks up a job by OS pid. Returns nullptr if the pid is not tracked.
+     */
+    Entry* findByPid(pid_t pid);
+
+    /**
+     * @brief Removes a job and its pid index entry. Returns false if it was not tracked.
+     */
+    bool erase(const std::string& id);
+
+    bool contains(const std::string& id) const { return byId.count(id) != 0; }
+    size_t size() const { return byId.size(); }
+    bool empty() const { return byId.empty(); }
+    void clear();
+
+    Map::iterator begin() { return byId.begin(); }
+    Map::iterator end() { return byId.end(); }
+    Map::const_iterator begin() const { return byId.begin(); }
+    Map::const_iterator end() const { return byId.end(); }
+
+private:
+    Map byId;
+    std::unordered_map<pid_t, Entry*> byPid;
+};
+
+// Number of lock stripes for tracked jobs (and for the pid index).
+// -DCCM_TRACKER_SHARDS=1 builds a single-lock tracker for comparison (tools/ccm_stress.cpp).
+#ifndef CCM_TRACKER_SHARDS
+#define CCM_TRACKER_SHARDS 16
+#endif
+const size_t TRACKER_SHARDS = CCM_TRACKER_SHARDS;
+
+/**
+ * @brief Lock-striped set of ProcessTrackers.
+ * A job lives in the shard picked by the hash of its id, so operations on
+ * different jobs rarely contend. A separate pid index, striped by pid, maps an
+ * OS pid to its shard for the reaper.
+ * Lock order: a shard mutex may be held while the pid index is updated, never
+ * the other way round, and at most one shard mutex is held at a time.
+ */
+class ShardedProcessTracker {
+public:
+    struct Shard {
+        std::mutex mutex;
+        ProcessTracker jobs;
+        size_t index = 0; // Position in the shard array
+    };
+
+    ShardedProcessTracker();
+
+    Shard& shardOf(const std::string& id);
+    Shard& shard(size_t index) { return *shards[index]; }
+    size_t shardCount() const { return TRACKER_SHARDS; }
+
+    /**
+     * @brief Returns the shard that currently holds 'pid', or nullptr.
+     * The answer may be stale by the time the shard is locked, so callers look
+     * the pid up again in shard.jobs under its mutex.
+     */
+    Shard* shardOfPid(pid_t pid);
+
+    // The mutations below must be called with shard.mutex held. They keep the
+    // pid index and the total count in step with the shard.
+    TrackedProcess& insert(Shard& shard, const std::string& id, TrackedProcess proc);
+    bool assignPid(Shard& shard, const std::string& id, pid_t pid);
+    bool erase(Shard& shard, const std::string& id);
+
+    /**
+     * @brief Number of tracked jobs (exact only while no shard is being modified).
+     */
+    size_t size() const { return total.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+
+private:
+    struct PidStripe {
+        std::mutex mutex;
+        std::unordered_map<pid_t, size_t> shardOf;
+    };
+
+    void indexPid(pid_t pid, size_t shardIndex);
+    void unindexPid(pid_t pid, size_t shardIndex);
+
+    std::unique_ptr<Shard> shards[TRACKER_SHARDS];
+    std::unique_ptr<PidStripe> pidStripes[TRACKER_SHARDS];
+    std::atomic<size_t> total{0};
+};
+
+#endif // PROCESS_TRACKER_H
@@ -0,0 +1,78 @@
+#ifndef REPLY_CHANNEL_H
+#define REPLY_CHANNEL_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <mqueue.h>
+#include <sys/types.h>
+
+// Upper bound on reply queues kept open at once; all are closed when it is hit
+const size_t REPLY_MAX_OPEN_QUEUES = 256;
+
+/**
+ * @brief Outcome of one command, sent back to the client that asked for it.
+ */
+struct CommandResult {
+    std::string jobId;
+    std::string action;
+    bool ok = true;
+    pid_t pid = -1;
+    std::string cores;  // e.g. "0-3,8"
+    std::string status; // Tracker status after the command
+    std::string error;  // Set when ok is false
+    long long waitMs = -1; // Time spent in the admission queue so far (queued jobs only)
+
+    void fail(const std::string& message) {
+        ok = false;
+        error = message;
+    }
+};
+
+/**
+ * @brief Sends command results to client-owned POSIX message queues.
+ * A reply is a JSON MQMessage with command "Reply" and parameters
+ * { "CorrelationId": ..., "Results": [...], "More": bool }. Results that do not
+ * fit one queue message are split across several, all but the last carrying
+ * "More": true. Sends never block: a full or missing client queue drops the reply.
+ * Thread-safe; every command worker sends through the same channel.
+ */
+class ReplyChannel {
+public:
+    ReplyChannel() = default;
+    ~ReplyChannel();
+
+    ReplyChannel(const ReplyChannel&) = delete;
+    ReplyChannel& operator=(const ReplyChannel&) = delete;
+
+    /**
+     * @brief Sends 'results' to 'queueName' (which must start with '/').
+     * @return false if any part of the reply could not be delivered.
+     */
+    bool send(const std::string& queueName, const std::string& correlationId,
+              const std::vector<CommandResult>& results);
+
+    void closeAll();
+
+private:
+    struct OpenQueue {
+        mqd_t mqd;
+        size_t maxMsgSize;
+    };
+
+    void closeLocked();
+    // Returns the cached descriptor for 'name', opening it on first use
+    OpenQueue* open(const std::string& name);
+    // Appends results[first, last) to 'parts' as one or more messages of at most maxMsgSize bytes
+    bool serializePart(const std::string& name, size_t maxMsgSize, const std::string& correlationId,
+                       const std::vector<CommandResult>& results, size_t first, size_t last, bool more,
+                       std::vector<std::string>& parts);
+
+    std::unordered_map<std::string, OpenQueue> queues;
+    // Guards queues; held across the non-blocking mq_send() calls (not the serialization)
+    // so a descriptor is never closed mid-send
+    std::mutex queuesMutex;
+};
+
+#endif // REPLY_CHANNEL_H
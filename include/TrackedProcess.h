@@ -2,14 +2,34 @@
 #define TrackedProcess_H
 
 #include <string>
+#include "CpuMask.h"
+#include "JobStats.h"
+#include "PriorityClass.h"
+#include "JobCgroup.h"
+#include "JobState.h"
 /**
  * @brief Stores runtime information about a tracked external process.
  */
 struct TrackedProcess {
     pid_t pid = 0;
-    std::string status = "initialized"; // "running", "paused", "finished", "terminated"
+    JobState state = JOB_INITIALIZED;
     std::string path;
     long long startTime = 0; // Epoch time in seconds
+    uint64_t procStartTicks = 0; // Field 22 of /proc/[pid]/stat; tells a recovered job from a recycled pid
+    int pidfd = -1; // pidfd watched by the monitor's epoll set (-1 if unavailable)
+    int exitCode = -1; // Exit code once reaped (-1 if not exited normally)
+    int termSignal = 0; // Terminating signal once reaped (0 if none)
+    CpuMask cpuMask; // Cores reserved in CoreAllocator and applied as the affinity mask
+    double cpuWeight = 1.0; // Weight held per core in the core reservation ledger
+    int numaNode = -1; // NUMA node the memory is bound to (-1 if not bound)
+    PriorityClass priorityClass = PRIO_NORMAL; // Scheduling class the job was launched with
+    JobCgroup cgroup; // Per-job cgroup; empty when the job is controlled with signals
+    bool migratable = true; // false when the job asked for an explicit CpuList
+    uint64_t lastMigratedNs = 0; // CLOCK_MONOTONIC time of the last rebalancer move
+    uint64_t queuedAtNs = 0; // CLOCK_MONOTONIC time the job entered the admission queue (0 = never queued)
+    uint32_t migrations = 0; // Number of rebalancer moves
+    JobStats stats; // Resource usage, refreshed by ProcessManager::sampleJobStats()
+    int tableSlot = -1; // Slot in the shared job status table (-1 if not published)
 };
 
 #endif // TrackedProcess_H
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "Admission.h"
+#include "Logger.h"
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+bool load_admission_limits(const std::string& path, AdmissionLimits& out)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("Admission");
+        if (section == config.end() || !section->is_object()) return true; // Nothing configured
+
+        AdmissionLimits limits;
+        limits.maxJobsPerCore = section->value("MaxJobsPerCore", 0);
+        limits.maxLoadPct = section->value("MaxLoadPct", 0.0);
+        out = limits;
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid admission settings in " << path << ": " << e.what();
+        return false;
+    }
+    return true;
+}
+
+void PendingJobQueue::push(Command cmd, uint64_t nowNs)
+{
+    PendingJob job;
+    job.priority = cmd.priority;
+    job.background = is_background_class(priority_class_from_string(cmd.priorityClass));
+    job.seq = nextSeq++;
+    job.enqueuedNs = nowNs;
+    job.cmd = std::move(cmd);
+    jobs.insert(std::move(job));
+}
+
+bool PendingJobQueue::ahead(const Command& cmd) const
+{
+    if (jobs.empty()) return false;
+    const PendingJob& head = front();
+    if (head.priority != cmd.priority) return head.priority > cmd.priority;
+    return !head.background || is_background_class(priority_class_from_string(cmd.priorityClass));
+}
+
+PendingJob PendingJobQueue::popFront()
+{
+    auto node = jobs.extract(jobs.begin());
+    return std::move(node.value());
+}
+
+bool PendingJobQueue::remove(const std::string& id)
+{
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        if (it->cmd.id == id) {
+            jobs.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t PendingJobQueue::oldestWaitNs(uint64_t nowNs) const
+{
+    uint64_t oldest = 0;
+    for (const auto& job : jobs) {
+        if (nowNs > job.enqueuedNs) oldest = std::max(oldest, nowNs - job.enqueuedNs);
+    }
+    return oldest;
+}
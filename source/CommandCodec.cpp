@@ -0,0 +1,213 @@
+#include "CommandCodec.h"
+#include <cstring> // For memcpy()
+
+namespace {
+
+const char* const PLACEMENT_NAMES[] = {"spread", "pack", "numa"};
+
+uint16_t read_u16(const char* p)
+{
+    return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+}
+
+uint32_t read_u32(const char* p)
+{
+    return static_cast<uint32_t>(read_u16(p)) | (static_cast<uint32_t>(read_u16(p + 2)) << 16);
+}
+
+void write_u16(std::string& out, uint16_t v)
+{
+    out.push_back(static_cast<char>(v & 0xff));
+    out.push_back(static_cast<char>(v >> 8));
+}
+
+void write_u32(std::string& out, uint32_t v)
+{
+    write_u16(out, static_cast<uint16_t>(v & 0xffff));
+    write_u16(out, static_cast<uint16_t>(v >> 16));
+}
+
+// IEEE floats travel as their bit pattern in a little-endian u32, whatever the host order
+float read_f32(const char* p)
+{
+    uint32_t bits = read_u32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+void write_f32(std::string& out, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    write_u32(out, bits);
+}
+
+// Reads one length-prefixed string, advancing 'p'; false if it overruns 'end'
+bool read_string(const char*& p, const char* end, std::string_view& out)
+{
+    if (end - p < 2) return false;
+    uint16_t len = read_u16(p);
+    if (end - p - 2 < len) return false;
+    out = std::string_view(p + 2, len);
+    p += 2 + len;
+    return true;
+}
+
+bool write_string(std::string& out, const std::string& s)
+{
+    if (s.size() > 0xffff) return false;
+    write_u16(out, static_cast<uint16_t>(s.size()));
+    out.append(s);
+    return true;
+}
+
+} // namespace
+
+const char* action_name(CommandAction action)
+{
+    switch (action) {
+    case ACTION_START:     return "StartJob";
+    case ACTION_PAUSE:     return "pause";
+    case ACTION_RESUME:    return "resume";
+    case ACTION_TERMINATE: return "terminate";
+    case ACTION_STATUS:    return "status";
+    default:               return "";
+    }
+}
+
+CommandAction action_from_name(const std::string& name)
+{
+    for (uint8_t a = ACTION_START; a <= ACTION_STATUS; ++a) {
+        if (name == action_name(static_cast<CommandAction>(a))) return static_cast<CommandAction>(a);
+    }
+    return ACTION_UNKNOWN;
+}
+
+std::string_view CommandView::arg(uint16_t index) const
+{
+    const char* p = argTable;
+    for (uint16_t i = 0; i < index; ++i) p += 2 + read_u16(p);
+    return std::string_view(p + 2, read_u16(p));
+}
+
+int CommandView::cpu(uint16_t index) const
+{
+    return read_u16(cpuTable + 2 * index);
+}
+
+bool decode_command(const char* buf, size_t len, CommandView& out, size_t& consumed)
+{
+    if (len < WIRE_HEADER_SIZE_V1 || static_cast<uint8_t>(buf[0]) != WIRE_MAGIC) return false;
+    uint8_t version = static_cast<uint8_t>(buf[1]);
+    if (version != 1 && version != WIRE_VERSION) return false;
+    size_t headerSize = version == 1 ? WIRE_HEADER_SIZE_V1 : WIRE_HEADER_SIZE;
+
+    uint32_t frameLen = read_u32(buf + 4);
+    if (frameLen < headerSize || frameLen > len) return false;
+
+    out.action = static_cast<CommandAction>(buf[2]);
+    out.placement = static_cast<uint8_t>(buf[3]);
+    out.cpuWeight = read_f32(buf + 8);
+    out.numaNode = static_cast<int16_t>(read_u16(buf + 12));
+    out.coreCount = read_u16(buf + 14);
+    out.argCount = read_u16(buf + 16);
+    out.cpuCount = read_u16(buf + 18);
+    out.priority = static_cast<int16_t>(read_u16(buf + 20));
+    uint8_t cls = static_cast<uint8_t>(buf[22]);
+    out.priorityClass = cls < PRIORITY_CLASS_COUNT ? static_cast<PriorityClass>(cls) : PRIO_NORMAL;
+    out.cpuMax = 0.0f;
+    out.memoryMax = 0;
+    if (version >= 2) {
+        out.cpuMax = read_f32(buf + 24);
+        out.memoryMax = static_cast<uint64_t>(read_u32(buf + 28)) * 1024;
+    }
+
+    // Validate the whole table once so the accessors can skip bounds checks
+    const char* p = buf + headerSize;
+    const char* end = buf + frameLen;
+    if (!read_string(p, end, out.id) || !read_string(p, end, out.processId) ||
+        !read_string(p, end, out.programPath) || !read_string(p, end, out.replyQueue) ||
+        !read_string(p, end, out.correlationId)) {
+        return false;
+    }
+    out.argTable = p;
+    std::string_view unused;
+    for (uint16_t i = 0; i < out.argCount; ++i) {
+        if (!read_string(p, end, unused)) return false;
+    }
+    if (end - p < 2 * static_cast<ptrdiff_t>(out.cpuCount)) return false;
+    out.cpuTable = p;
+
+    consumed = frameLen;
+    return true;
+}
+
+void to_command(const CommandView& view, Command& out)
+{
+    out.action = action_name(view.action);
+    out.id.assign(view.id.data(), view.id.size());
+    out.processId.assign(view.processId.data(), view.processId.size());
+    out.programPath.assign(view.programPath.data(), view.programPath.size());
+    out.replyQueue.assign(view.replyQueue.data(), view.replyQueue.size());
+    out.correlationId.assign(view.correlationId.data(), view.correlationId.size());
+
+    out.args.resize(view.argCount);
+    size_t i = 0;
+    view.forEachArg([&](std::string_view a) { out.args[i++].assign(a.data(), a.size()); });
+
+    out.cpuWeight = view.cpuWeight;
+    out.placement = view.placement < 3 ? PLACEMENT_NAMES[view.placement] : "";
+    out.numaNode = view.numaNode;
+    out.coreCount = view.coreCount;
+    out.priority = view.priority;
+    out.priorityClass = priority_class_name(view.priorityClass);
+    out.cpuMax = view.cpuMax;
+    out.memoryMax = view.memoryMax;
+
+    out.cpuList.resize(view.cpuCount);
+    for (uint16_t c = 0; c < view.cpuCount; ++c) out.cpuList[c] = view.cpu(c);
+}
+
+bool encode_command(const Command& cmd, std::string& out)
+{
+    if (cmd.args.size() > 0xffff || cmd.cpuList.size() > 0xffff) return false;
+
+    size_t start = out.size();
+    out.push_back(static_cast<char>(WIRE_MAGIC));
+    out.push_back(static_cast<char>(WIRE_VERSION));
+    out.push_back(static_cast<char>(action_from_name(cmd.action)));
+
+    uint8_t placement = 0;
+    for (uint8_t i = 0; i < 3; ++i) {
+        if (cmd.placement == PLACEMENT_NAMES[i]) placement = i;
+    }
+    out.push_back(static_cast<char>(placement));
+    write_u32(out, 0); // Frame length, patched below
+
+    write_f32(out, static_cast<float>(cmd.cpuWeight));
+    write_u16(out, static_cast<uint16_t>(static_cast<int16_t>(cmd.numaNode)));
+    write_u16(out, static_cast<uint16_t>(cmd.coreCount));
+    write_u16(out, static_cast<uint16_t>(cmd.args.size()));
+    write_u16(out, static_cast<uint16_t>(cmd.cpuList.size()));
+    write_u16(out, static_cast<uint16_t>(static_cast<int16_t>(cmd.priority)));
+    out.push_back(static_cast<char>(priority_class_from_string(cmd.priorityClass)));
+    out.push_back(0);
+    write_f32(out, static_cast<float>(cmd.cpuMax));
+    // Rounded up so a limit is never loosened
+    uint64_t memoryKiB = (cmd.memoryMax + 1023) / 1024;
+    write_u32(out, memoryKiB > 0xffffffffull ? 0xffffffffu : static_cast<uint32_t>(memoryKiB));
+
+    bool ok = write_string(out, cmd.id) && write_string(out, cmd.processId) && write_string(out, cmd.programPath) &&
+              write_string(out, cmd.replyQueue) && write_string(out, cmd.correlationId);
+    for (const auto& a : cmd.args) ok = ok && write_string(out, a);
+    for (int c : cmd.cpuList) write_u16(out, static_cast<uint16_t>(c));
+    if (!ok) {
+        out.resize(start);
+        return false;
+    }
+
+    uint32_t frameLen = static_cast<uint32_t>(out.size() - start);
+    for (int i = 0; i < 4; ++i) out[start + 4 + i] = static_cast<char>((frameLen >> (8 * i)) & 0xff);
+    return true;
+}
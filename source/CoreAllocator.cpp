@@ -0,0 +1,437 @@
+#include "CoreAllocator.h"
+#include <algorithm>
+#include <map>
+#include <unistd.h> // For sysconf()
+
+PlacementPolicy placement_policy_from_string(const std::string& name)
+{
+    if (name == "pack") return PLACE_PACK;
+    if (name == "numa") return PLACE_NUMA;
+    return PLACE_SPREAD;
+}
+
+CoreAllocator::CoreAllocator(const CoreLoadSampler& loadSampler, int numCores)
+    : sampler(loadSampler)
+{
+    if (topo.load() && numCores <= 0) {
+        numCores = topo.cpuCount();
+    }
+    if (numCores <= 0) {
+        long configured = sysconf(_SC_NPROCESSORS_CONF);
+        numCores = configured > 0 ? static_cast<int>(configured) : 1;
+    }
+    cores.resize(numCores);
+    score.resize(numCores);
+    blocked.assign(numCores, 0);
+
+    for (int core = 0; core < numCores; ++core) {
+        if (usable(core)) allCpus.push_back(core);
+    }
+}
+
+bool CoreAllocator::usable(int core) const
+{
+    if (core < 0 || core >= static_cast<int>(cores.size())) return false;
+    if (blocked[core]) return false;
+    return topo.cpuCount() == 0 || topo.present(core);
+}
+
+bool CoreAllocator::anyUsable(const std::vector<int>& cpuList) const
+{
+    // 'blocked' is only set while a placement holds ledgerMutex
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    return std::any_of(cpuList.begin(), cpuList.end(), [this](int core) { return usable(core); });
+}
+
+void CoreAllocator::computeScores()
+{
+    bool measured = sampler.snapshot(usage);
+
+    for (int core = 0; core < static_cast<int>(cores.size()); ++core) {
+        double load = (measured && core < static_cast<int>(usage.size())) ? usage[core] : 0.0;
+
+        // Measured load already contains jobs that are running, while fresh
+        // reservations are not visible yet. Taking the max of the two avoids
+        // counting a running job twice but still covers jobs that just launched.
+        score[core] = std::max(load, 100.0 * cores[core].committed);
+    }
+}
+
+int CoreAllocator::pickSpread(const std::vector<int>& candidates, const std::vector<double>& scores) const
+{
+    int best = -1;
+    double bestScore = 0.0;
+    int bestJobs = 0;
+
+    for (int core : candidates) {
+        if (!usable(core)) continue;
+
+        // A busy hyperthread sibling shares the core's execution units
+        double effective = scores[core];
+        if (topo.present(core)) {
+            for (int sibling : topo.cpu(core).smtSiblings) {
+                if (sibling < static_cast<int>(scores.size())) effective += SMT_SIBLING_PENALTY * scores[sibling];
+            }
+        }
+        int jobs = cores[core].pending + cores[core].active;
+
+        if (best == -1 || effective < bestScore || (effective == bestScore && jobs < bestJobs)) {
+            best = core;
+            bestScore = effective;
+            bestJobs = jobs;
+        }
+    }
+    return best;
+}
+
+int CoreAllocator::pickPack() const
+{
+    if (topo.cpuCount() == 0) return pickSpread(allCpus, score);
+
+    // Committed weight per L3 domain: the fullest domain with a free CPU wins
+    std::vector<double> domainLoad(topo.l3DomainCount(), 0.0);
+    for (int core : allCpus) {
+        domainLoad[topo.cpu(core).l3Domain] += cores[core].committed;
+    }
+
+    int best = -1;
+    for (int core : allCpus) {
+        if (!usable(core) || score[core] >= PACK_MAX_CPU_LOAD) continue;
+        if (best == -1) { best = core; continue; }
+
+        double load = domainLoad[topo.cpu(core).l3Domain];
+        double bestLoad = domainLoad[topo.cpu(best).l3Domain];
+        if (load > bestLoad || (load == bestLoad && score[core] < score[best])) {
+            best = core;
+        }
+    }
+
+    // Everything is above the packing threshold: fall back to the least loaded CPU
+    return best != -1 ? best : pickSpread(allCpus, score);
+}
+
+int CoreAllocator::pickNumaNode() const
+{
+    int bestNode = -1;
+    double bestAverage = 0.0;
+    for (int node = 0; node < topo.numaNodeCount(); ++node) {
+        const std::vector<int>& cpus = topo.cpusOfNode(node);
+        if (cpus.empty()) continue; // Memory-only node
+
+        double total = 0.0;
+        for (int cpu : cpus) {
+            if (cpu < static_cast<int>(score.size())) total += score[cpu];
+        }
+        double average = total / cpus.size();
+        if (bestNode == -1 || average < bestAverage) {
+            bestNode = node;
+            bestAverage = average;
+        }
+    }
+    return bestNode;
+}
+
+double CoreAllocator::pickSet(const std::vector<int>& candidates, int count, double weight, bool penalizeSmt,
+                              std::vector<int>& chosen)
+{
+    chosen.clear();
+    trial = score;
+
+    std::vector<int> remaining;
+    for (int core : candidates) {
+        if (usable(core)) remaining.push_back(core);
+    }
+    if (static_cast<int>(remaining.size()) < count) return -1.0;
+
+    double cost = 0.0;
+    while (static_cast<int>(chosen.size()) < count) {
+        int best = -1;
+        if (penalizeSmt) {
+            best = pickSpread(remaining, trial);
+        } else {
+            for (int core : remaining) {
+                if (best == -1 || trial[core] < trial[best]) best = core;
+            }
+        }
+
+        chosen.push_back(best);
+        cost += score[best];
+        remaining.erase(std::find(remaining.begin(), remaining.end(), best));
+        // Later picks see this one as busy, so its SMT sibling is penalised
+        trial[best] += 100.0 * weight;
+    }
+
+    std::sort(chosen.begin(), chosen.end());
+    return cost;
+}
+
+std::vector<int> CoreAllocator::pickMany(const PlacementRequest& request)
+{
+    int available = static_cast<int>(std::count_if(allCpus.begin(), allCpus.end(),
+                                                    [this](int core) { return usable(core); }));
+    int count = std::min(request.coreCount, available);
+    if (count <= 0) return {};
+    bool penalizeSmt = request.policy != PLACE_PACK;
+
+    // Candidate groups: one socket, one L3 domain (pack) or one NUMA node (numa)
+    std::map<int, std::vector<int>> groups;
+    if (request.policy == PLACE_NUMA && !topo.cpusOfNode(request.numaNode).empty()) {
+        groups[request.numaNode] = topo.cpusOfNode(request.numaNode);
+    } else {
+        for (int core : allCpus) {
+            int key = 0;
+            if (topo.present(core)) {
+                switch (request.policy) {
+                case PLACE_PACK: key = topo.cpu(core).l3Domain; break;
+                case PLACE_NUMA: key = topo.cpu(core).numaNode; break;
+                default:         key = topo.cpu(core).package; break;
+                }
+            }
+            groups[key].push_back(core);
+        }
+    }
+
+    std::vector<int> best, chosen;
+    double bestCost = 0.0;
+    int bestSpan = 0;
+    for (const auto& group : groups) {
+        double cost = pickSet(group.second, count, request.weight, penalizeSmt, chosen);
+        if (cost < 0.0) continue;
+
+        // Among equally loaded sets prefer the most contiguous one
+        int span = chosen.back() - chosen.front();
+        if (best.empty() || cost < bestCost || (cost == bestCost && span < bestSpan)) {
+            best = chosen;
+            bestCost = cost;
+            bestSpan = span;
+        }
+    }
+
+    if (best.empty()) {
+        const std::vector<int>& node = topo.cpusOfNode(request.numaNode);
+        if (request.policy == PLACE_NUMA && !node.empty()) {
+            // A job bound to a node never leaves it: take what the node has free
+            int free = static_cast<int>(std::count_if(node.begin(), node.end(), [this](int core) { return usable(core); }));
+            if (free > 0) pickSet(node, std::min(count, free), request.weight, penalizeSmt, best);
+        } else {
+            // No single group is big enough: take the cheapest CPUs machine-wide
+            pickSet(allCpus, count, request.weight, penalizeSmt, best);
+        }
+    }
+    return best;
+}
+
+CpuMask CoreAllocator::reserve(const PlacementRequest& request)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    return reserveLocked(request, false);
+}
+
+CpuMask CoreAllocator::admit(const PlacementRequest& request)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    return reserveLocked(request, admission.enabled());
+}
+
+void CoreAllocator::setLimits(const AdmissionLimits& newLimits)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    admission = newLimits;
+}
+
+AdmissionLimits CoreAllocator::limits() const
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    return admission;
+}
+
+bool CoreAllocator::conflicts(int core, PriorityClass priorityClass) const
+{
+    if (is_background_class(priorityClass)) return cores[core].realtime > 0;
+    if (priorityClass == PRIO_REALTIME) return cores[core].background > 0;
+    return false;
+}
+
+void CoreAllocator::applyLimits(bool enforceLimits, PriorityClass priorityClass, bool separateClasses)
+{
+    for (int core = 0; core < static_cast<int>(cores.size()); ++core) {
+        const CoreReservation& r = cores[core];
+        bool full = enforceLimits && admission.maxJobsPerCore > 0 && r.pending + r.active >= admission.maxJobsPerCore;
+        bool hot = enforceLimits && admission.maxLoadPct > 0.0 && core < static_cast<int>(usage.size()) &&
+                   usage[core] >= admission.maxLoadPct;
+        bool shared = separateClasses && conflicts(core, priorityClass);
+        blocked[core] = full || hot || shared;
+    }
+}
+
+void CoreAllocator::pickCores(const PlacementRequest& request, std::vector<int>& chosen)
+{
+    chosen.clear();
+    if (!request.cpuList.empty()) {
+        for (int core : request.cpuList) {
+            if (usable(core)) chosen.push_back(core);
+        }
+    } else if (request.coreCount > 1) {
+        chosen = pickMany(request);
+    } else {
+        int best = -1;
+        switch (request.policy) {
+        case PLACE_PACK:
+            best = pickPack();
+            break;
+        case PLACE_NUMA: {
+            int node = request.numaNode;
+            if (topo.cpusOfNode(node).empty()) node = pickNumaNode();
+            best = node == -1 ? pickSpread(allCpus, score) : pickSpread(topo.cpusOfNode(node), score);
+            break;
+        }
+        case PLACE_SPREAD:
+        default:
+            best = pickSpread(allCpus, score);
+            break;
+        }
+        if (best != -1) chosen.push_back(best);
+    }
+}
+
+CpuMask CoreAllocator::reserveLocked(const PlacementRequest& request, bool enforceLimits)
+{
+    computeScores();
+    size_t wanted = std::min<size_t>(std::max(request.coreCount, 1), allCpus.size());
+
+    // An explicit CpuList is taken as given; otherwise realtime and batch/idle jobs get separate cores
+    bool separate = request.cpuList.empty() &&
+                    (request.priorityClass == PRIO_REALTIME || is_background_class(request.priorityClass));
+    std::vector<int> chosen;
+    applyLimits(enforceLimits, request.priorityClass, separate);
+    pickCores(request, chosen);
+    if (separate && request.priorityClass == PRIO_REALTIME && chosen.size() < wanted) {
+        // Better to share with batch work than not to run: FIFO preempts it anyway
+        applyLimits(enforceLimits, request.priorityClass, false);
+        pickCores(request, chosen);
+    }
+
+    if (enforceLimits) {
+        // All or nothing: a job is never started on fewer cores than it asked for
+        bool fits;
+        if (request.cpuList.empty()) {
+            fits = chosen.size() >= wanted;
+        } else {
+            fits = !chosen.empty() && std::none_of(request.cpuList.begin(), request.cpuList.end(), [this](int core) {
+                return core >= 0 && core < static_cast<int>(blocked.size()) && blocked[core];
+            });
+        }
+        if (!fits) chosen.clear();
+    }
+    std::fill(blocked.begin(), blocked.end(), 0);
+
+    CpuMask mask(static_cast<int>(cores.size()));
+    for (int core : chosen) {
+        if (mask.isSet(core)) continue;
+        mask.set(core);
+        cores[core].pending++;
+        cores[core].committed += request.weight;
+    }
+    countClass(mask, request.priorityClass, 1);
+    return mask;
+}
+
+void CoreAllocator::countClass(const CpuMask& mask, PriorityClass priorityClass, int delta)
+{
+    if (priorityClass != PRIO_REALTIME && !is_background_class(priorityClass)) return;
+
+    for (int core : mask.cpus()) {
+        if (core >= static_cast<int>(cores.size())) continue;
+        int& count = priorityClass == PRIO_REALTIME ? cores[core].realtime : cores[core].background;
+        count = std::max(0, count + delta);
+    }
+}
+
+CpuMask CoreAllocator::migrate(const CpuMask& from, double weight, double maxScore,
+                               PriorityClass priorityClass, int numaNode)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    computeScores();
+
+    // A move is a new placement on the target core, so it honours the admission limits too
+    applyLimits(admission.enabled(), priorityClass, true);
+    std::vector<int> candidates;
+    for (int core : numaNode == -1 ? allCpus : topo.cpusOfNode(numaNode)) {
+        if (!from.isSet(core) && score[core] < maxScore && !blocked[core]) candidates.push_back(core);
+    }
+    std::fill(blocked.begin(), blocked.end(), 0);
+
+    CpuMask mask(static_cast<int>(cores.size()));
+    int best = pickSpread(candidates, score);
+    if (best == -1) return mask;
+
+    mask.set(best);
+    moveActive(from, mask, weight, priorityClass);
+    return mask;
+}
+
+void CoreAllocator::transfer(const CpuMask& from, const CpuMask& to, double weight, PriorityClass priorityClass)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    moveActive(from, to, weight, priorityClass);
+}
+
+void CoreAllocator::moveActive(const CpuMask& from, const CpuMask& to, double weight, PriorityClass priorityClass)
+{
+    countClass(from, priorityClass, -1);
+    countClass(to, priorityClass, 1);
+    for (int core : from.cpus()) {
+        if (core >= static_cast<int>(cores.size())) continue;
+        CoreReservation& r = cores[core];
+        if (r.active > 0) r.active--;
+        r.committed = std::max(0.0, r.committed - weight);
+    }
+    for (int core : to.cpus()) {
+        if (core >= static_cast<int>(cores.size())) continue;
+        cores[core].active++;
+        cores[core].committed += weight;
+    }
+}
+
+void CoreAllocator::adopt(const CpuMask& mask, double weight, PriorityClass priorityClass)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    for (int core : mask.cpus()) {
+        if (core >= static_cast<int>(cores.size())) continue;
+        cores[core].active++;
+        cores[core].committed += weight;
+    }
+    countClass(mask, priorityClass, 1);
+}
+
+void CoreAllocator::activate(const CpuMask& mask)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    for (int core : mask.cpus()) {
+        if (core >= static_cast<int>(cores.size())) continue;
+
+        CoreReservation& r = cores[core];
+        if (r.pending > 0) r.pending--;
+        r.active++;
+    }
+}
+
+void CoreAllocator::release(const CpuMask& mask, double weight, bool wasActive, PriorityClass priorityClass)
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    countClass(mask, priorityClass, -1);
+    for (int core : mask.cpus()) {
+        if (core >= static_cast<int>(cores.size())) continue;
+
+        CoreReservation& r = cores[core];
+        int& count = wasActive ? r.active : r.pending;
+        if (count > 0) count--;
+        r.committed = std::max(0.0, r.committed - weight);
+    }
+}
+
+std::vector<CoreReservation> CoreAllocator::ledger() const
+{
+    std::lock_guard<std::mutex> lock(ledgerMutex);
+    return cores;
+}
@@ -0,0 +1,97 @@
+#include "CpuMask.h"
+#include <cstring>  // For memcpy()
+#include <utility>
+
+CpuMask::CpuMask(int numCpus)
+{
+    reallocate(numCpus > 0 ? numCpus : CPU_SETSIZE);
+}
+
+CpuMask::~CpuMask()
+{
+    if (set_) CPU_FREE(set_);
+}
+
+CpuMask::CpuMask(const CpuMask& other)
+{
+    reallocate(other.capacity);
+    memcpy(set_, other.set_, CPU_ALLOC_SIZE(capacity));
+}
+
+CpuMask& CpuMask::operator=(const CpuMask& other)
+{
+    if (this != &other) {
+        CpuMask copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+CpuMask::CpuMask(CpuMask&& other) noexcept
+    : set_(other.set_), capacity(other.capacity)
+{
+    other.set_ = nullptr;
+    other.capacity = 0;
+}
+
+CpuMask& CpuMask::operator=(CpuMask&& other) noexcept
+{
+    std::swap(set_, other.set_);
+    std::swap(capacity, other.capacity);
+    return *this;
+}
+
+void CpuMask::reallocate(int numCpus)
+{
+    cpu_set_t* grown = CPU_ALLOC(numCpus);
+    CPU_ZERO_S(CPU_ALLOC_SIZE(numCpus), grown);
+    if (set_) {
+        memcpy(grown, set_, CPU_ALLOC_SIZE(capacity));
+        CPU_FREE(set_);
+    }
+    set_ = grown;
+    capacity = numCpus;
+}
+
+void CpuMask::set(int cpu)
+{
+    if (cpu < 0) return;
+    if (cpu >= capacity) reallocate(cpu + 1);
+    CPU_SET_S(cpu, CPU_ALLOC_SIZE(capacity), set_);
+}
+
+bool CpuMask::isSet(int cpu) const
+{
+    if (!set_ || cpu < 0 || cpu >= capacity) return false;
+    return CPU_ISSET_S(cpu, CPU_ALLOC_SIZE(capacity), set_);
+}
+
+int CpuMask::count() const
+{
+    return set_ ? CPU_COUNT_S(CPU_ALLOC_SIZE(capacity), set_) : 0;
+}
+
+std::vector<int> CpuMask::cpus() const
+{
+    std::vector<int> result;
+    for (int cpu = 0; cpu < capacity; ++cpu) {
+        if (CPU_ISSET_S(cpu, CPU_ALLOC_SIZE(capacity), set_)) result.push_back(cpu);
+    }
+    return result;
+}
+
+std::string CpuMask::toString() const
+{
+    std::string result;
+    std::vector<int> list = cpus();
+    for (size_t i = 0; i < list.size(); ) {
+        size_t j = i;
+        while (j + 1 < list.size() && list[j + 1] == list[j] + 1) ++j;
+
+        if (!result.empty()) result += ',';
+        result += std::to_string(list[i]);
+        if (j > i) result += '-' + std::to_string(list[j]);
+        i = j + 1;
+    }
+    return result;
+}
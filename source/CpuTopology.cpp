@@ -0,0 +1,150 @@
+#include "CpuTopology.h"
+
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cstdlib>
+#include <cctype>
+#include <dirent.h>
+
+namespace {
+
+// Reads the first line of a sysfs attribute; empty if it does not exist
+std::string read_sysfs_line(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (file.is_open()) std::getline(file, line);
+    return line;
+}
+
+int read_sysfs_int(const std::string& path, int fallback)
+{
+    std::string line = read_sysfs_line(path);
+    if (line.empty()) return fallback;
+    return std::atoi(line.c_str());
+}
+
+// Reads a decimal id at list[pos], saturating at 'cap' instead of overflowing
+bool read_cpu_id(const std::string& list, size_t& pos, long cap, long& value)
+{
+    size_t start = pos;
+    value = 0;
+    while (pos < list.size() && std::isdigit(static_cast<unsigned char>(list[pos]))) {
+        value = std::min(cap, value * 10 + (list[pos] - '0'));
+        ++pos;
+    }
+    return pos > start;
+}
+
+} // namespace
+
+bool parse_cpu_list(const std::string& list, std::vector<int>& out, int limit)
+{
+    out.clear();
+    const long cap = static_cast<long>(limit) + 1; // Anything above the limit is as good as "too big"
+    size_t pos = 0;
+    while (pos < list.size()) {
+        while (pos < list.size() && std::isspace(static_cast<unsigned char>(list[pos]))) ++pos;
+        if (pos == list.size()) break;
+        if (list[pos] == ',') { ++pos; continue; }
+
+        long first, last;
+        if (!read_cpu_id(list, pos, cap, first)) return false;
+        last = first;
+        if (pos < list.size() && list[pos] == '-') {
+            ++pos;
+            if (!read_cpu_id(list, pos, cap, last) || last < first) return false;
+        }
+        while (pos < list.size() && std::isspace(static_cast<unsigned char>(list[pos]))) ++pos;
+        if (pos < list.size() && list[pos] != ',') return false;
+
+        for (long cpu = first; cpu <= last && cpu < limit; ++cpu) out.push_back(static_cast<int>(cpu));
+    }
+    return true;
+}
+
+std::vector<int> parse_cpu_list(const std::string& list)
+{
+    std::vector<int> result;
+    parse_cpu_list(list, result);
+    return result;
+}
+
+bool CpuTopology::load(const std::string& sysRoot)
+{
+    cpus.clear();
+    nodeCpus.clear();
+
+    // Only online CPUs can run jobs; "online" is missing from some captured trees
+    std::vector<int> ids = parse_cpu_list(read_sysfs_line(sysRoot + "/cpu/present"));
+    std::vector<int> online = parse_cpu_list(read_sysfs_line(sysRoot + "/cpu/online"));
+    if (!online.empty()) {
+        std::vector<int> usable;
+        std::set_intersection(ids.begin(), ids.end(), online.begin(), online.end(), std::back_inserter(usable));
+        ids.swap(usable);
+    }
+    if (ids.empty()) return false;
+    cpus.resize(ids.back() + 1);
+
+    std::map<std::pair<int, int>, int> coreKeys; // (package, core_id) -> core key
+    std::map<std::string, int> l3Keys;           // shared_cpu_list -> L3 domain
+
+    for (int id : ids) {
+        std::string base = sysRoot + "/cpu/cpu" + std::to_string(id);
+        CpuInfo& info = cpus[id];
+        info.present = true;
+        info.package = read_sysfs_int(base + "/topology/physical_package_id", 0);
+
+        int coreId = read_sysfs_int(base + "/topology/core_id", id);
+        auto core = coreKeys.emplace(std::make_pair(info.package, coreId), static_cast<int>(coreKeys.size()));
+        info.coreKey = core.first->second;
+
+        for (int sibling : parse_cpu_list(read_sysfs_line(base + "/topology/thread_siblings_list"))) {
+            if (sibling != id) info.smtSiblings.push_back(sibling);
+        }
+
+        // index3 is the L3 on x86 and most arm64 parts; fall back to the socket
+        std::string l3 = read_sysfs_line(base + "/cache/index3/shared_cpu_list");
+        if (l3.empty()) l3 = "pkg" + std::to_string(info.package);
+        auto domain = l3Keys.emplace(l3, static_cast<int>(l3Keys.size()));
+        info.l3Domain = domain.first->second;
+    }
+    numL3Domains = static_cast<int>(l3Keys.size());
+
+    // NUMA nodes: /sys/devices/system/node/nodeN/cpulist
+    if (DIR* dir = opendir((sysRoot + "/node").c_str())) {
+        struct dirent* ent;
+        while ((ent = readdir(dir)) != nullptr) {
+            std::string name = ent->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 || !std::isdigit(static_cast<unsigned char>(name[4]))) continue;
+
+            int node = std::atoi(name.c_str() + 4);
+            if (node >= static_cast<int>(nodeCpus.size())) nodeCpus.resize(node + 1);
+            // cpulist still names offline CPUs on some kernels; present() only holds the loaded ones
+            for (int cpu : parse_cpu_list(read_sysfs_line(sysRoot + "/node/" + name + "/cpulist"))) {
+                if (present(cpu)) {
+                    cpus[cpu].numaNode = node;
+                    nodeCpus[node].push_back(cpu);
+                }
+            }
+        }
+        closedir(dir);
+    }
+    if (nodeCpus.empty()) {
+        // Kernel without NUMA support: everything is node 0
+        nodeCpus.resize(1);
+        for (int id : ids) nodeCpus[0].push_back(id);
+    }
+
+    return true;
+}
+
+const std::vector<int>& CpuTopology::cpusOfNode(int node) const
+{
+    static const std::vector<int> none;
+    if (node < 0 || node >= static_cast<int>(nodeCpus.size())) return none;
+    return nodeCpus[node];
+}
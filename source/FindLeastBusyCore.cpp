@@ -1,135 +1,286 @@
-#include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
-#include <map>
 #include <vector>
 #include <thread>
 #include <chrono>
 #include <algorithm>
-#include <iomanip>
+#include <fstream>
 
-int find_least_busy_core();
-// Structure to hold the total and idle jiffies (time slices) for a single core
-struct CoreStats {
-    long long total = 0;
-    long long idle = 0;
-    // We only need total and idle for the usage calculation
-};
+#include <fcntl.h>     // For open()
+#include <unistd.h>    // For pread(), close()
+#include <errno.h>
+#include <cstring>     // For strerror()
 
-// Global constant for the time delay between samples in milliseconds
-const int SAMPLE_DELAY_MS = 200; 
+#include "CoreLoadSampler.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include <nlohmann/json.hpp>
 
-// Function Prototypes
-bool read_cpu_stats(std::map<int, CoreStats>& stats_map);
-int find_least_busy_core();
+// Initial read buffer; grows if /proc/stat does not fit (many cores / interrupts)
+static const size_t PROC_STAT_INITIAL_BUFFER = 16 * 1024;
 
+ProcStatReader::ProcStatReader(const char* path)
+    : fd(open(path, O_RDONLY | O_CLOEXEC)), buffer(PROC_STAT_INITIAL_BUFFER)
+{
+    if (fd == -1) {
+        CCM_ERROR << "Error: Could not open " << path << ": " << strerror(errno);
+    }
+}
 
-/**
- * @brief Reads the total and idle jiffies for all 'cpuN' entries from /proc/stat.
- * @param stats_map Output map to store CoreStats (Core ID -> CoreStats).
- * @return true on success, false on failure.
- */
-bool read_cpu_stats(std::map<int, CoreStats>& stats_map) 
+ProcStatReader::~ProcStatReader()
 {
-    stats_map.clear();
-    std::ifstream stat_file("/proc/stat");
+    if (fd != -1) close(fd);
+}
 
-    if (!stat_file.is_open()) 
-    {
-        std::cerr << "Error: Could not open /proc/stat" << std::endl;
+bool ProcStatReader::read(std::vector<CoreStats>& stats)
+{
+    if (fd == -1) return false;
+
+    // Read the whole file at offset 0; retry with a bigger buffer if it was truncated
+    ssize_t len;
+    while (true) {
+        len = pread(fd, buffer.data(), buffer.size(), 0);
+        if (len == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (static_cast<size_t>(len) < buffer.size()) break;
+        buffer.resize(buffer.size() * 2);
+    }
+
+    for (auto& core : stats) core.online = false;
+
+    const char* p = buffer.data();
+    const char* end = p + len;
+    bool found = false;
+
+    // The per-core lines directly follow the aggregate "cpu " line
+    while (p + 3 < end && p[0] == 'c' && p[1] == 'p' && p[2] == 'u') {
+        p += 3;
+        if (*p >= '0' && *p <= '9') {
+            size_t core_id = 0;
+            while (p < end && *p >= '0' && *p <= '9') core_id = core_id * 10 + (*p++ - '0');
+
+            if (core_id >= stats.size()) stats.resize(core_id + 1);
+            CoreStats& core = stats[core_id];
+
+            int field = 0;
+            while (p < end && *p != '\n' && field < CPU_FIELD_COUNT) {
+                while (p < end && *p == ' ') ++p;
+                unsigned long long value = 0;
+                while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+                core.jiffies[field++] = value;
+            }
+            // Older kernels print fewer columns
+            for (; field < CPU_FIELD_COUNT; ++field) core.jiffies[field] = 0;
+
+            core.online = true;
+            found = true;
+        }
+        while (p < end && *p != '\n') ++p;
+        ++p;
+    }
+
+    return found;
+}
+
+bool read_cpu_stats(std::vector<CoreStats>& stats)
+{
+    thread_local ProcStatReader reader;
+    return reader.read(stats);
+}
+
+CoreLoadSampler::CoreLoadSampler(int intervalMs, double smoothing)
+    : interval(intervalMs > 0 ? intervalMs : SAMPLE_DELAY_MS),
+      alpha(smoothing > 0.0 && smoothing <= 1.0 ? smoothing : LOAD_SMOOTHING_FACTOR)
+{}
+
+bool CoreLoadSampler::configure(const LoadSamplerSettings& settings)
+{
+    if (worker.joinable()) return false;
+    interval = settings.intervalMs > 0 ? settings.intervalMs : SAMPLE_DELAY_MS;
+    alpha = settings.smoothing > 0.0 && settings.smoothing <= 1.0 ? settings.smoothing : LOAD_SMOOTHING_FACTOR;
+    return true;
+}
+
+CoreLoadSampler::~CoreLoadSampler()
+{
+    stop();
+}
+
+bool CoreLoadSampler::start()
+{
+    if (worker.joinable()) return true;
+
+    // Baseline sample: the first utilisation figures are published one interval later
+    if (!reader.read(lastStats)) {
         return false;
     }
 
-    std::string line;
-    int core_id = 0;
-    
-    // Skip the first "cpu" line which aggregates all cores
-    std::getline(stat_file, line); 
+    int cores = static_cast<int>(lastStats.size());
+    usagePct.reset(new std::atomic<double>[cores]);
+    for (int i = 0; i < cores; ++i) usagePct[i].store(0.0, std::memory_order_relaxed);
+    smoothed.assign(cores, 0.0);
+    haveSample = false;
 
-    // Read lines starting with "cpu" followed by a digit (cpu0, cpu1, etc.)
-    while (std::getline(stat_file, line) && line.substr(0, 3) == "cpu") 
     {
-        if (line.length() > 3 && std::isdigit(line[3])) {
-            std::stringstream ss(line.substr(4)); // Start parsing after "cpuN "
-            
-            long long user, nice, system, idle;
-            
-            // Read the first four critical fields
-            if (ss >> user >> nice >> system >> idle) {
-                CoreStats stats;
-                
-                // Total Jiffies = sum of all time spent in all modes
-                stats.total = user + nice + system + idle; // Simplified sum of main modes
-                stats.idle = idle;
-                
-                stats_map[core_id] = stats;
-                core_id++;
-            } else {
-                // Handle parsing error for a core line
-                std::cerr << "Warning: Failed to parse a cpu line in /proc/stat." << std::endl;
-            }
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = false;
+    }
+    worker = std::thread(&CoreLoadSampler::run, this);
+    return true;
+}
+
+void CoreLoadSampler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    stateCv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void CoreLoadSampler::waitForFirstSample()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+    stateCv.wait(lock, [this] { return published || stopping || !worker.joinable(); });
+}
+
+bool CoreLoadSampler::snapshot(std::vector<double>& usage) const
+{
+    int cores = numCores.load(std::memory_order_acquire);
+    if (cores == 0) return false;
+
+    usage.resize(cores);
+    unsigned before, after = 0;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        if (before & 1u) continue; // Writer in progress
+        for (int i = 0; i < cores; ++i) {
+            usage[i] = usagePct[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1u) || before != after);
+
+    return true;
+}
+
+void CoreLoadSampler::publish(const std::vector<CoreStats>& previous, const std::vector<CoreStats>& current)
+{
+    int cores = static_cast<int>(smoothed.size());
+    int least_busy_core = -1;
+    double min_usage = 101.0;
+
+    int limit = std::min<int>(cores, std::min(previous.size(), current.size()));
+    for (int core_id = 0; core_id < limit; ++core_id) {
+        // Cores beyond the initial layout (hot-plug) are ignored
+        const CoreStats& prev = previous[core_id];
+        const CoreStats& cur = current[core_id];
+        if (!prev.online || !cur.online) continue;
+
+        long long delta_total = static_cast<long long>(cur.total() - prev.total());
+        long long delta_idle = static_cast<long long>(cur.idle() - prev.idle());
+        if (delta_total <= 0) continue;
+
+        // Usage = (Delta_Total - Delta_Idle) / Delta_Total
+        double usage_percent = 100.0 * (delta_total - delta_idle) / delta_total;
+        smoothed[core_id] = haveSample
+            ? alpha * usage_percent + (1.0 - alpha) * smoothed[core_id]
+            : usage_percent;
+
+        if (smoothed[core_id] < min_usage) {
+            min_usage = smoothed[core_id];
+            least_busy_core = core_id;
         }
     }
+    haveSample = true;
+
+    sequence.fetch_add(1, std::memory_order_acq_rel); // Odd: readers retry
+    for (int i = 0; i < cores; ++i) {
+        usagePct[i].store(smoothed[i], std::memory_order_relaxed);
+    }
+    sequence.fetch_add(1, std::memory_order_release);
 
-    return !stats_map.empty();
+    numCores.store(cores, std::memory_order_release);
+    if (least_busy_core != -1) {
+        leastBusy.store(least_busy_core, std::memory_order_release);
+    }
 }
 
+void CoreLoadSampler::run()
+{
+    std::vector<CoreStats> current;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            if (stateCv.wait_for(lock, std::chrono::milliseconds(interval), [this] { return stopping; })) {
+                break;
+            }
+        }
+
+        {
+            StageTimer timer(STAGE_LOAD_SAMPLE);
+            if (!reader.read(current)) continue;
+            publish(lastStats, current);
+        }
+        lastStats.swap(current);
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            published = true;
+        }
+        stateCv.notify_all();
+    }
+}
 
 /**
- * @brief Determines the least busy logical core based on usage percentage.
+ * @brief Determines the least busy logical core based on smoothed usage percentage.
  * @return The ID of the least busy core, or -1 on error.
  */
 int find_least_busy_core() {
-    std::map<int, CoreStats> stats1, stats2;
-    
-    // --- 1. First Sample (T1) ---
-    if (!read_cpu_stats(stats1)) {
+    static CoreLoadSampler sampler;
+    static bool started = sampler.start();
+
+    if (!started) {
         return -1;
     }
 
-    // --- 2. Wait ---
-    // Sleep for the defined interval (e.g., 200ms)
-    std::this_thread::sleep_for(std::chrono::milliseconds(SAMPLE_DELAY_MS));
-
-    // --- 3. Second Sample (T2) ---
-    if (!read_cpu_stats(stats2)) {
-        return -1;
+    int core = sampler.leastBusyCore();
+    if (core == -1) {
+        sampler.waitForFirstSample();
+        core = sampler.leastBusyCore();
     }
-    
-    int least_busy_core = -1;
-    double min_usage = 100.0; // Initialize with max possible usage
-
-    // --- 4. Calculate Usage and Compare ---
-    for (const auto& pair1 : stats1) {
-        int core_id = pair1.first;
-        const CoreStats& s1 = pair1.second;
-
-        // Check if the core exists in the second sample
-        if (stats2.count(core_id)) {
-            const CoreStats& s2 = stats2.at(core_id);
-            
-            // Calculate differences (Delta)
-            long long delta_total = s2.total - s1.total;
-            long long delta_idle = s2.idle - s1.idle;
-            
-            if (delta_total > 0) {
-                // Usage = (Delta_Total - Delta_Idle) / Delta_Total
-                double usage_percent = 100.0 * (delta_total - delta_idle) / delta_total;
-                
-                // Debugging output (Optional)
-                std::cout << std::fixed << std::setprecision(2) 
-                          << "Core " << core_id << " Usage: " 
-                          << usage_percent << "%" << std::endl;
-
-                // Find the core with the minimum usage
-                if (usage_percent < min_usage) {
-                    min_usage = usage_percent;
-                    least_busy_core = core_id;
-                }
-            }
+    return core;
+}
+
+bool load_sampler_settings(const std::string& path, LoadSamplerSettings& settings)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("LoadSampler");
+        if (section == config.end() || !section->is_object()) return true; // Keep the defaults
+        settings.intervalMs = section->value("IntervalMs", settings.intervalMs);
+        settings.smoothing = section->value("Smoothing", settings.smoothing);
+        if (settings.intervalMs <= 0) {
+            CCM_WARN << "[WARN] LoadSampler IntervalMs " << settings.intervalMs << " is not positive, using "
+                     << SAMPLE_DELAY_MS << " ms.";
+            settings.intervalMs = SAMPLE_DELAY_MS;
+        }
+        if (!(settings.smoothing > 0.0 && settings.smoothing <= 1.0)) {
+            CCM_WARN << "[WARN] LoadSampler Smoothing " << settings.smoothing << " is not in (0, 1], using "
+                     << LOAD_SMOOTHING_FACTOR << ".";
+            settings.smoothing = LOAD_SMOOTHING_FACTOR;
         }
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid load sampler settings in " << path << ": " << e.what();
+        return false;
     }
-    
-    return least_busy_core;
-}
\ No newline at end of file
+    return true;
+}
@@ -0,0 +1,247 @@
+#include "JobCgroup.h"
+#include "Logger.h"
+#include <fstream>
+#include <cstdlib>       // For strtoull()
+#include <cstring>       // For strerror(), strcmp(), strncmp(), strchr()
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>       // For open(), openat()
+#include <unistd.h>      // For close(), read(), write(), unlinkat()
+#include <dirent.h>      // For opendir(), readdir()
+#include <sys/stat.h>    // For mkdir(), mkdirat()
+#include <sys/vfs.h>     // For statfs()
+#include <linux/magic.h> // For CGROUP2_SUPER_MAGIC
+#include <nlohmann/json.hpp>
+
+// Controllers the class and job groups need, enabled one at a time so a missing one does not block the others
+static const char* const CGROUP_CONTROLLERS[] = {"+cpu", "+cpuset", "+memory"};
+
+bool load_cgroup_root(const std::string& path, std::string& root)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("Cgroups");
+        if (section == config.end() || !section->is_object()) return true; // Nothing configured
+        root = section->value("Root", "");
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid cgroup settings in " << path << ": " << e.what();
+        return false;
+    }
+    return true;
+}
+
+// A job id becomes a directory name, so it must be a single path component
+static bool valid_group_name(const std::string& name)
+{
+    return !name.empty() && name.size() < 256 && name[0] != '.' && name.find('/') == std::string::npos &&
+           name.find('\n') == std::string::npos;
+}
+
+JobCgroups::~JobCgroups()
+{
+    if (rootFd != -1) close(rootFd);
+}
+
+int JobCgroups::writeControl(const std::string& file, const std::string& value) const
+{
+    int fd = openat(rootFd, file.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1) return errno;
+    int error = write(fd, value.data(), value.size()) == -1 ? errno : 0;
+    close(fd);
+    return error;
+}
+
+ssize_t JobCgroups::readControl(const std::string& file, char* buf, size_t size) const
+{
+    int fd = openat(rootFd, file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n >= 0) buf[n] = '\0';
+    return n;
+}
+
+bool JobCgroups::open(const std::string& root)
+{
+    // Refuse anything but a cgroup v2 mount, otherwise mkdir() would create plain directories
+    std::string parent = root.substr(0, root.find_last_of('/'));
+    if (parent.empty()) parent = "/";
+    struct statfs fs;
+    if (statfs(parent.c_str(), &fs) == -1 || fs.f_type != CGROUP2_SUPER_MAGIC) {
+        CCM_WARN << "[WARN] " << parent << " is not a cgroup v2 hierarchy, jobs are controlled with signals.";
+        return false;
+    }
+    if (mkdir(root.c_str(), 0755) == -1 && errno != EEXIST) {
+        CCM_WARN << "[WARN] Cannot create cgroup " << root << ": " << strerror(errno);
+        return false;
+    }
+    int fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        CCM_WARN << "[WARN] Cannot open cgroup " << root << ": " << strerror(errno);
+        return false;
+    }
+    if (rootFd != -1) close(rootFd);
+    rootFd = fd;
+    rootPath = root;
+
+    for (const char* controller : CGROUP_CONTROLLERS) {
+        int error = writeControl("cgroup.subtree_control", controller);
+        if (error != 0) {
+            CCM_WARN << "[WARN] Cannot enable " << controller + 1 << " in " << root << ": " << strerror(error);
+        }
+    }
+
+    for (int i = 0; i < PRIORITY_CLASS_COUNT; ++i) {
+        PriorityClass cls = static_cast<PriorityClass>(i);
+        std::string group = priority_class_name(cls);
+        if (mkdirat(rootFd, group.c_str(), 0755) == -1 && errno != EEXIST) {
+            CCM_WARN << "[WARN] Cannot create cgroup " << root << "/" << group << ": " << strerror(errno);
+            continue;
+        }
+        removeLeftovers(group);
+
+        // Only the job groups below hold processes, so the class group may delegate controllers.
+        // Realtime jobs get no cpu controller of their own: cpu.max means nothing to SCHED_FIFO.
+        for (const char* controller : CGROUP_CONTROLLERS) {
+            if (cls == PRIO_REALTIME && strcmp(controller, "+cpu") == 0) continue;
+            writeControl(group + "/cgroup.subtree_control", controller);
+        }
+        int weight = scheduling_params_for(cls).cgroupWeight;
+        if (weight != 0) {
+            int error = writeControl(group + "/cpu.weight", std::to_string(weight));
+            if (error != 0) {
+                CCM_WARN << "[WARN] Cannot set cpu.weight of " << root << "/" << group << ": " << strerror(error);
+            }
+        }
+    }
+    return true;
+}
+
+void JobCgroups::removeLeftovers(const std::string& classDir)
+{
+    DIR* dir = opendir((rootPath + "/" + classDir).c_str());
+    if (!dir) return;
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != nullptr) {
+        if (ent->d_type != DT_DIR || ent->d_name[0] == '.') continue;
+        std::string group = classDir + "/" + ent->d_name;
+        // Fails with EBUSY if processes from the previous run are still inside; those stay
+        if (unlinkat(rootFd, group.c_str(), AT_REMOVEDIR) == 0) {
+            CCM_INFO << "[CGROUP] Removed leftover group " << group << ".";
+        }
+    }
+    closedir(dir);
+}
+
+bool JobCgroups::create(const std::string& jobId, PriorityClass cls, const CpuMask& cpus,
+                        const CgroupLimits& limits, JobCgroup& out)
+{
+    out = JobCgroup();
+    if (rootFd == -1 || !valid_group_name(jobId)) return false;
+
+    std::string path = std::string(priority_class_name(cls)) + "/" + jobId;
+    if (mkdirat(rootFd, path.c_str(), 0755) == -1) {
+        // A leftover from a job with the same id: reuse the name once it is empty
+        if (errno != EEXIST || unlinkat(rootFd, path.c_str(), AT_REMOVEDIR) == -1 ||
+            mkdirat(rootFd, path.c_str(), 0755) == -1) {
+            CCM_WARN << "[WARN] Cannot create cgroup " << rootPath << "/" << path << ": " << strerror(errno);
+            return false;
+        }
+    }
+    out.path = path;
+    {
+        // A retry must not remove the new group before the job has joined it
+        std::lock_guard<std::mutex> lock(staleMutex);
+        stale.erase(std::remove(stale.begin(), stale.end(), path), stale.end());
+    }
+
+    if (!cpus.empty()) {
+        out.pinned = setCpus(out, cpus) == 0;
+    }
+    if (limits.cpuMax > 0.0) {
+        uint64_t quota = static_cast<uint64_t>(limits.cpuMax * CGROUP_CPU_PERIOD_US);
+        if (quota < 1000) quota = 1000; // Kernel minimum is 1ms
+        int error = writeControl(path + "/cpu.max", std::to_string(quota) + " " + std::to_string(CGROUP_CPU_PERIOD_US));
+        if (error != 0) {
+            CCM_WARN << "[WARN] Cannot set cpu.max for job " << jobId << ": " << strerror(error);
+        }
+    }
+    if (limits.memoryMax > 0) {
+        int error = writeControl(path + "/memory.max", std::to_string(limits.memoryMax));
+        if (error != 0) {
+            CCM_WARN << "[WARN] Cannot set memory.max for job " << jobId << ": " << strerror(error);
+        }
+    }
+    return true;
+}
+
+int JobCgroups::openProcs(const JobCgroup& group) const
+{
+    if (rootFd == -1 || group.empty()) return -1;
+    return openat(rootFd, (group.path + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+}
+
+int JobCgroups::freeze(const JobCgroup& group, bool frozen) const
+{
+    return writeControl(group.path + "/cgroup.freeze", frozen ? "1" : "0");
+}
+
+int JobCgroups::kill(const JobCgroup& group) const
+{
+    return writeControl(group.path + "/cgroup.kill", "1");
+}
+
+int JobCgroups::setCpus(const JobCgroup& group, const CpuMask& cpus) const
+{
+    // The kernel resets the affinity of every task in the group to the new set
+    return writeControl(group.path + "/cpuset.cpus", cpus.toString());
+}
+
+bool JobCgroups::readUsage(const JobCgroup& group, CgroupUsage& out) const
+{
+    char buf[1024];
+    if (group.empty() || readControl(group.path + "/cpu.stat", buf, sizeof(buf)) <= 0) return false;
+
+    for (char* line = buf; line && *line; ) {
+        char* next = strchr(line, '\n');
+        if (strncmp(line, "usage_usec ", 11) == 0) out.cpuUsageUsec = strtoull(line + 11, nullptr, 10);
+        else if (strncmp(line, "nr_throttled ", 13) == 0) out.nrThrottled = strtoull(line + 13, nullptr, 10);
+        else if (strncmp(line, "throttled_usec ", 15) == 0) out.throttledUsec = strtoull(line + 15, nullptr, 10);
+        line = next ? next + 1 : nullptr;
+    }
+    // Absent without the memory controller
+    if (readControl(group.path + "/memory.current", buf, sizeof(buf)) > 0) {
+        out.memoryCurrent = strtoull(buf, nullptr, 10);
+    }
+    return true;
+}
+
+void JobCgroups::remove(const JobCgroup& group)
+{
+    if (rootFd == -1 || group.empty()) return;
+    if (unlinkat(rootFd, group.path.c_str(), AT_REMOVEDIR) == 0 || errno == ENOENT) return;
+
+    if (errno == EBUSY) {
+        std::lock_guard<std::mutex> lock(staleMutex);
+        stale.push_back(group.path);
+    } else {
+        CCM_WARN << "[WARN] Cannot remove cgroup " << rootPath << "/" << group.path << ": " << strerror(errno);
+    }
+}
+
+void JobCgroups::retryRemovals()
+{
+    std::lock_guard<std::mutex> lock(staleMutex);
+    for (size_t i = 0; i < stale.size(); ) {
+        if (unlinkat(rootFd, stale[i].c_str(), AT_REMOVEDIR) == 0 || errno == ENOENT) {
+            stale[i] = std::move(stale.back());
+            stale.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
@@ -0,0 +1,447 @@
+#include "JobJournal.h"
+#include "Logger.h"
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>     // For memcpy(), memset(), strerror()
+#include <errno.h>
+#include <fcntl.h>     // For open()
+#include <unistd.h>    // For close(), ftruncate(), pwrite(), fdatasync()
+#include <sys/mman.h>  // For mmap(), munmap()
+#include <sys/stat.h>  // For fstat()
+#include <nlohmann/json.hpp>
+#include "CpuTopology.h" // For parse_cpu_list()
+
+/*
+ * File layout (little-endian):
+ *   0   8  magic "CCMJRNL\0"
+ *   8   4  format version (1)
+ *   12  4  reserved
+ *   16  ... records, each 8-byte aligned:
+ *           0  4  record length (header included, before padding; 0 = end)
+ *           4  4  FNV-1a checksum of the length, type and body
+ *           8  1  JournalRecordType
+ *           9  3  reserved
+ *           12 .. body
+ */
+namespace {
+
+const char JOURNAL_MAGIC[8] = {'C', 'C', 'M', 'J', 'R', 'N', 'L', '\0'};
+const uint32_t JOURNAL_VERSION = 1;
+const size_t JOURNAL_HEADER_SIZE = 16;
+const size_t RECORD_HEADER_SIZE = 12;
+
+// START flags
+const uint8_t FLAG_MIGRATABLE = 1;
+const uint8_t FLAG_CGROUP_PINNED = 2;
+
+size_t align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+uint32_t checksum(uint32_t length, uint8_t type, const char* body, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint8_t byte) { hash = (hash ^ byte) * 16777619u; };
+    for (int i = 0; i < 4; ++i) mix(static_cast<uint8_t>(length >> (8 * i)));
+    mix(type);
+    for (size_t i = 0; i < len; ++i) mix(static_cast<uint8_t>(body[i]));
+    return hash;
+}
+
+template <typename T>
+void put(std::string& out, T value)
+{
+    char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+void put_string(std::string& out, const std::string& s)
+{
+    uint16_t len = static_cast<uint16_t>(std::min<size_t>(s.size(), 0xffff));
+    put(out, len);
+    out.append(s.data(), len);
+}
+
+// Bounds-checked reader over one record body
+struct Reader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (end - p < static_cast<ptrdiff_t>(sizeof(T))) { ok = false; return value; }
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+    std::string getString() {
+        uint16_t len = get<uint16_t>();
+        if (!ok || end - p < len) { ok = false; return std::string(); }
+        std::string s(p, len);
+        p += len;
+        return s;
+    }
+};
+
+CpuMask mask_from_list(const std::string& list)
+{
+    CpuMask mask;
+    for (int cpu : parse_cpu_list(list)) mask.set(cpu);
+    return mask;
+}
+
+std::string start_body(const std::string& id, const TrackedProcess& proc)
+{
+    std::string body;
+    put_string(body, id);
+    put<int32_t>(body, proc.pid);
+    put<uint64_t>(body, proc.procStartTicks);
+    put<int64_t>(body, proc.startTime);
+    put<double>(body, proc.cpuWeight);
+    put<int16_t>(body, static_cast<int16_t>(proc.numaNode));
+    put<uint8_t>(body, proc.priorityClass);
+    put<uint8_t>(body, (proc.migratable ? FLAG_MIGRATABLE : 0) | (proc.cgroup.pinned ? FLAG_CGROUP_PINNED : 0));
+    put_string(body, proc.path);
+    put_string(body, proc.cpuMask.toString());
+    put_string(body, proc.cgroup.path);
+    return body;
+}
+
+// Applies one record to the replayed state; false if the body is malformed
+bool apply_record(uint8_t type, Reader& in, std::unordered_map<std::string, TrackedProcess>& jobs)
+{
+    std::string id = in.getString();
+    if (!in.ok) return false;
+
+    switch (type) {
+    case JOURNAL_START: {
+        TrackedProcess proc;
+        proc.pid = in.get<int32_t>();
+        proc.procStartTicks = in.get<uint64_t>();
+        proc.startTime = in.get<int64_t>();
+        proc.cpuWeight = in.get<double>();
+        proc.numaNode = in.get<int16_t>();
+        uint8_t cls = in.get<uint8_t>();
+        uint8_t flags = in.get<uint8_t>();
+        proc.path = in.getString();
+        std::string cpus = in.getString();
+        proc.cgroup.path = in.getString();
+        if (!in.ok) return false;
+
+        proc.priorityClass = cls < PRIORITY_CLASS_COUNT ? static_cast<PriorityClass>(cls) : PRIO_NORMAL;
+        proc.migratable = (flags & FLAG_MIGRATABLE) != 0;
+        proc.cgroup.pinned = (flags & FLAG_CGROUP_PINNED) != 0;
+        proc.cpuMask = mask_from_list(cpus);
+        proc.state = JOB_RUNNING;
+        jobs[id] = std::move(proc);
+        return true;
+    }
+    case JOURNAL_MOVE: {
+        std::string cpus = in.getString();
+        if (!in.ok) return false;
+        auto it = jobs.find(id);
+        if (it != jobs.end()) it->second.cpuMask = mask_from_list(cpus);
+        return true;
+    }
+    case JOURNAL_EXIT:
+        jobs.erase(id);
+        return true;
+    default: {
+        auto it = jobs.find(id);
+        if (it == jobs.end()) return true;
+        if (type == JOURNAL_PAUSE) it->second.state = JOB_PAUSED;
+        else if (type == JOURNAL_RESUME) it->second.state = JOB_RUNNING;
+        else if (type == JOURNAL_TERMINATE) it->second.state = JOB_TERMINATING;
+        return true;
+    }
+    }
+}
+
+// Appends a complete record (header and padding) to 'out'
+void encode_record(std::string& out, JournalRecordType type, const std::string& body)
+{
+    uint32_t length = static_cast<uint32_t>(RECORD_HEADER_SIZE + body.size());
+    put<uint32_t>(out, length);
+    put<uint32_t>(out, checksum(length, type, body.data(), body.size()));
+    put<uint8_t>(out, type);
+    out.append(3, '\0');
+    out.append(body);
+    out.append(align8(length) - length, '\0');
+}
+
+} // namespace
+
+bool load_journal_path(const std::string& configPath, std::string& path)
+{
+    std::ifstream file(configPath);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("Journal");
+        if (section == config.end() || !section->is_object()) return true; // Keep the default
+        path = section->value("Path", "");
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid journal settings in " << configPath << ": " << e.what();
+        return false;
+    }
+    return true;
+}
+
+JobJournal::~JobJournal()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    unmapLocked();
+    if (fd != -1) close(fd);
+}
+
+bool JobJournal::mapLocked(size_t bytes)
+{
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) return false;
+    base = static_cast<char*>(mapped);
+    capacity = bytes;
+    return true;
+}
+
+void JobJournal::unmapLocked()
+{
+    if (base) munmap(base, capacity);
+    base = nullptr;
+    capacity = 0;
+}
+
+bool JobJournal::open(const std::string& journalPath, JobList& jobs)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.clear();
+
+    int newFd = ::open(journalPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (newFd == -1) {
+        CCM_ERROR << "[ERROR] Cannot open journal " << journalPath << ": " << strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(newFd, &st) == -1) {
+        close(newFd);
+        return false;
+    }
+
+    unmapLocked();
+    if (fd != -1) close(fd);
+    fd = newFd;
+    path = journalPath;
+
+    size_t size = static_cast<size_t>(st.st_size);
+    bool fresh = size < JOURNAL_HEADER_SIZE;
+    if (fresh) {
+        size = JOURNAL_INITIAL_BYTES;
+        if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+            CCM_ERROR << "[ERROR] Cannot size journal " << path << ": " << strerror(errno);
+            close(fd);
+            fd = -1;
+            return false;
+        }
+    }
+    if (!mapLocked(size)) {
+        CCM_ERROR << "[ERROR] Cannot map journal " << path << ": " << strerror(errno);
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    uint32_t version = 0;
+    memcpy(&version, base + 8, sizeof(version));
+    if (!fresh && (memcmp(base, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || version != JOURNAL_VERSION)) {
+        CCM_WARN << "[WARN] " << path << " is not a CCM journal (version " << JOURNAL_VERSION << "), starting empty.";
+        fresh = true;
+    }
+    if (fresh) {
+        memset(base, 0, JOURNAL_HEADER_SIZE);
+        memcpy(base, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        memcpy(base + 8, &JOURNAL_VERSION, sizeof(JOURNAL_VERSION));
+    }
+
+    // Replay until the first record that is missing, torn or corrupt
+    std::unordered_map<std::string, TrackedProcess> live;
+    size_t offset = JOURNAL_HEADER_SIZE;
+    while (!fresh && offset + RECORD_HEADER_SIZE <= capacity) {
+        uint32_t length, sum;
+        memcpy(&length, base + offset, sizeof(length));
+        memcpy(&sum, base + offset + 4, sizeof(sum));
+        uint8_t type = static_cast<uint8_t>(base[offset + 8]);
+        if (length < RECORD_HEADER_SIZE || length > capacity - offset) break;
+
+        const char* body = base + offset + RECORD_HEADER_SIZE;
+        size_t bodyLen = length - RECORD_HEADER_SIZE;
+        if (checksum(length, type, body, bodyLen) != sum) break;
+
+        Reader in{body, body + bodyLen};
+        if (!apply_record(type, in, live)) break;
+        offset += align8(length);
+    }
+    end = std::min(offset, capacity);
+    compactedEnd = end;
+    // Clear a torn tail so a shorter record written over it cannot be followed by stale bytes
+    memset(base + end, 0, capacity - end);
+
+    jobs.reserve(live.size());
+    for (auto& pair : live) jobs.emplace_back(pair.first, std::move(pair.second));
+    return true;
+}
+
+bool JobJournal::growLocked(size_t needed)
+{
+    size_t bytes = capacity;
+    while (bytes < needed) bytes *= 2;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == -1) return false;
+
+    unmapLocked();
+    if (!mapLocked(bytes)) {
+        CCM_ERROR << "[ERROR] Cannot remap journal " << path << ": " << strerror(errno);
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void JobJournal::appendLocked(JournalRecordType type, const std::string& body)
+{
+    if (fd == -1) return;
+
+    uint32_t length = static_cast<uint32_t>(RECORD_HEADER_SIZE + body.size());
+    if (end + align8(length) > capacity && !growLocked(end + align8(length))) {
+        CCM_ERROR << "[ERROR] Journal " << path << " is full, dropping a record.";
+        return;
+    }
+
+    // Body first: a crash before the header is written leaves a zero length, which ends replay
+    char* record = base + end;
+    memcpy(record + RECORD_HEADER_SIZE, body.data(), body.size());
+    record[8] = static_cast<char>(type);
+    uint32_t sum = checksum(length, type, body.data(), body.size());
+    memcpy(record + 4, &sum, sizeof(sum));
+    memcpy(record, &length, sizeof(length));
+    end += align8(length);
+}
+
+void JobJournal::recordStart(const std::string& id, const TrackedProcess& proc)
+{
+    std::string body = start_body(id, proc);
+    std::lock_guard<std::mutex> lock(mutex);
+    appendLocked(JOURNAL_START, body);
+}
+
+void JobJournal::recordMove(const std::string& id, const CpuMask& cpus)
+{
+    std::string body;
+    put_string(body, id);
+    put_string(body, cpus.toString());
+    std::lock_guard<std::mutex> lock(mutex);
+    appendLocked(JOURNAL_MOVE, body);
+}
+
+void JobJournal::record(JournalRecordType type, const std::string& id)
+{
+    std::string body;
+    put_string(body, id);
+    std::lock_guard<std::mutex> lock(mutex);
+    appendLocked(type, body);
+}
+
+bool JobJournal::wantsCompaction() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return fd != -1 && end >= JOURNAL_COMPACT_MIN_BYTES && end >= JOURNAL_COMPACT_RATIO * compactedEnd;
+}
+
+size_t JobJournal::mark() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return end;
+}
+
+size_t JobJournal::bytesUsed() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return end;
+}
+
+bool JobJournal::compact(const JobList& live, size_t mark)
+{
+    std::string image(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    put<uint32_t>(image, JOURNAL_VERSION);
+    put<uint32_t>(image, 0);
+    std::string body;
+    for (const auto& job : live) {
+        encode_record(image, JOURNAL_START, start_body(job.first, job.second));
+        JournalRecordType status = job.second.state == JOB_PAUSED      ? JOURNAL_PAUSE
+                                 : job.second.state == JOB_TERMINATING ? JOURNAL_TERMINATE
+                                                                      : JOURNAL_START;
+        if (status != JOURNAL_START) {
+            body.clear();
+            put_string(body, job.first);
+            encode_record(image, status, body);
+        }
+    }
+
+    std::string journalPath;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fd == -1 || mark < JOURNAL_HEADER_SIZE || mark > end) return false;
+        journalPath = path;
+    }
+
+    // The snapshot is written and synced without the lock: appends (made under the
+    // tracker shard locks) keep going to the old mapping meanwhile
+    size_t bytes = JOURNAL_INITIAL_BYTES;
+    while (bytes < 2 * image.size()) bytes *= 2;
+    std::string tmpPath = journalPath + ".tmp";
+    int newFd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (newFd == -1) {
+        CCM_ERROR << "[ERROR] Cannot create " << tmpPath << ": " << strerror(errno);
+        return false;
+    }
+    bool written = ftruncate(newFd, static_cast<off_t>(bytes)) == 0 &&
+                   pwrite(newFd, image.data(), image.size(), 0) == static_cast<ssize_t>(image.size()) &&
+                   fdatasync(newFd) == 0;
+    void* mapped = written ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, newFd, 0) : MAP_FAILED;
+    if (mapped == MAP_FAILED) {
+        CCM_ERROR << "[ERROR] Journal compaction failed: " << strerror(errno);
+        close(newFd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Records appended since 'mark' go on top of the snapshot; replaying them again is harmless.
+    // They are copied like any append (into the shared mapping, unsynced), and the rename stays
+    // under the lock so no record can land in the old file once the new one is in place.
+    size_t tail = fd == -1 || mark > end ? 0 : end - mark;
+    bool fits = fd != -1 && mark <= end && image.size() + tail <= bytes;
+    if (fits) memcpy(static_cast<char*>(mapped) + image.size(), base + mark, tail);
+    if (!fits) {
+        CCM_WARN << "[WARN] Journal " << journalPath << " changed during compaction, keeping it as is.";
+    } else if (rename(tmpPath.c_str(), journalPath.c_str()) != 0) {
+        CCM_ERROR << "[ERROR] Journal compaction failed: " << strerror(errno);
+        fits = false;
+    }
+    if (!fits) {
+        munmap(mapped, bytes);
+        close(newFd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    unmapLocked();
+    close(fd);
+    fd = newFd;
+    base = static_cast<char*>(mapped);
+    capacity = bytes;
+    end = image.size() + tail;
+    compactedEnd = end;
+    return true;
+}
@@ -0,0 +1,157 @@
+#include "JobStats.h"
+
+#include <fcntl.h>       // For open(), openat()
+#include <unistd.h>      // For pread(), sysconf(), close()
+#include <dirent.h>      // For fdopendir()
+#include <time.h>        // For clock_gettime()
+#include <cstring>
+#include <cstdio>        // For snprintf()
+#include <cstdlib>       // For strtoull()
+
+namespace {
+
+const size_t JOB_STATS_BUFFER = 8192;
+
+uint64_t monotonic_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// Value of "key<sep>value" in a /proc key/value file, 0 if missing
+uint64_t find_value(const char* buf, const char* key)
+{
+    const char* p = strstr(buf, key);
+    if (!p) return 0;
+    p += strlen(key);
+    while (*p == ' ' || *p == '\t' || *p == ':') ++p;
+    return strtoull(p, nullptr, 10);
+}
+
+} // namespace
+
+JobStatsReader::JobStatsReader()
+    : procFd(open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      buffer(JOB_STATS_BUFFER),
+      ticksPerSecond(sysconf(_SC_CLK_TCK)),
+      pageSize(sysconf(_SC_PAGESIZE))
+{}
+
+JobStatsReader::~JobStatsReader()
+{
+    if (procFd != -1) close(procFd);
+}
+
+ssize_t JobStatsReader::readFile(const char* path)
+{
+    int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    ssize_t len = pread(fd, buffer.data(), buffer.size() - 1, 0);
+    close(fd);
+    if (len < 0) return -1;
+    buffer[len] = '\0';
+    return len;
+}
+
+bool JobStatsReader::readSchedstat(pid_t pid, bool allThreads, uint64_t& cpuNs, uint64_t& delayNs)
+{
+    char path[64];
+    cpuNs = delayNs = 0;
+
+    if (!allThreads) {
+        snprintf(path, sizeof(path), "%d/schedstat", pid);
+        if (readFile(path) <= 0) return false;
+        unsigned long long cpu = 0, delay = 0;
+        if (sscanf(buffer.data(), "%llu %llu", &cpu, &delay) != 2) return false;
+        cpuNs = cpu;
+        delayNs = delay;
+        return true;
+    }
+
+    // Multi-threaded job: the pid's own schedstat only covers the main thread
+    snprintf(path, sizeof(path), "%d/task", pid);
+    int taskFd = openat(procFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (taskFd == -1) return false;
+    DIR* dir = fdopendir(taskFd);
+    if (!dir) {
+        close(taskFd);
+        return false;
+    }
+
+    bool found = false;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != nullptr) {
+        if (ent->d_name[0] < '0' || ent->d_name[0] > '9') continue;
+        snprintf(path, sizeof(path), "%d/task/%s/schedstat", pid, ent->d_name);
+        if (readFile(path) <= 0) continue;
+
+        unsigned long long cpu = 0, delay = 0;
+        if (sscanf(buffer.data(), "%llu %llu", &cpu, &delay) == 2) {
+            cpuNs += cpu;
+            delayNs += delay;
+            found = true;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+void JobStatsReader::sample(Batch& jobs)
+{
+    if (procFd == -1) return;
+
+    pids.clear();
+    for (const auto& job : jobs) pids.push_back(job.first);
+
+    // One pass over all stat files; results keep the input order minus exited pids
+    scanner.scanPids(pids, statResults);
+
+    uint64_t now = monotonic_ns();
+    size_t next = 0;
+    for (auto& job : jobs) {
+        if (next == statResults.size()) break;
+        if (statResults[next].first != job.first) continue; // Exited
+        fold(job.first, statResults[next].second, now, job.second);
+        next++;
+    }
+}
+
+void JobStatsReader::fold(pid_t pid, const ProcStatFields& fields, uint64_t now, JobStats& stats)
+{
+    uint64_t cpuNs = (fields.utime + fields.stime) * (1000000000ull / ticksPerSecond);
+    uint64_t delayNs = stats.runDelayNs;
+
+    // schedstat gives nanosecond CPU time and the run-queue wait; stat is the fallback
+    uint64_t schedCpu, schedDelay;
+    if (readSchedstat(pid, fields.numThreads > 1, schedCpu, schedDelay)) {
+        if (schedCpu > 0) cpuNs = schedCpu;
+        delayNs = schedDelay;
+    }
+
+    if (stats.sampledAtNs != 0 && now > stats.sampledAtNs) {
+        double elapsed = static_cast<double>(now - stats.sampledAtNs);
+        stats.cpuPercent = cpuNs >= stats.cpuTimeNs
+            ? static_cast<float>(100.0 * (cpuNs - stats.cpuTimeNs) / elapsed) : 0.0f;
+        stats.waitPercent = delayNs >= stats.runDelayNs
+            ? static_cast<float>(100.0 * (delayNs - stats.runDelayNs) / elapsed) : 0.0f;
+    }
+    stats.cpuTimeNs = cpuNs;
+    stats.runDelayNs = delayNs;
+    stats.rssBytes = fields.rssPages > 0 ? static_cast<uint64_t>(fields.rssPages) * pageSize : 0;
+    stats.numThreads = static_cast<uint32_t>(fields.numThreads);
+    stats.sampledAtNs = now;
+
+    char path[64];
+    snprintf(path, sizeof(path), "%d/status", pid);
+    if (readFile(path) > 0) {
+        stats.voluntaryCtxSwitches = static_cast<uint32_t>(find_value(buffer.data(), "\nvoluntary_ctxt_switches"));
+        stats.involuntaryCtxSwitches = static_cast<uint32_t>(find_value(buffer.data(), "nonvoluntary_ctxt_switches"));
+    }
+
+    snprintf(path, sizeof(path), "%d/io", pid);
+    if (readFile(path) > 0) {
+        stats.readBytes = find_value(buffer.data(), "\nread_bytes");
+        stats.writeBytes = find_value(buffer.data(), "\nwrite_bytes");
+    }
+}
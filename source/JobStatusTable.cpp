@@ -0,0 +1,208 @@
+#include "JobStatusTable.h"
+#include "Logger.h"
+#include <fstream>
+#include <cstring>     // For memcpy(), strerror()
+#include <errno.h>
+#include <fcntl.h>     // For O_* constants
+#include <unistd.h>    // For close(), ftruncate(), getpid()
+#include <sched.h>     // For sched_yield()
+#include <sys/mman.h>  // For shm_open(), shm_unlink(), mmap(), munmap()
+#include <sys/stat.h>  // For fstat()
+#include <nlohmann/json.hpp>
+
+// A reader gives up on a slot after this many torn copies (e.g. the manager died mid-update)
+static const int JOB_TABLE_READ_RETRIES = 1000;
+
+bool load_status_table_settings(const std::string& path, std::string& name, uint32_t& capacity)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("StatusTable");
+        if (section == config.end() || !section->is_object()) return true; // Keep the defaults
+        name = section->value("Name", name);
+        capacity = section->value("Capacity", capacity);
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid status table settings in " << path << ": " << e.what();
+        return false;
+    }
+    return true;
+}
+
+JobStatusTable::~JobStatusTable()
+{
+    close();
+}
+
+bool JobStatusTable::create(const std::string& tableName, uint32_t capacity)
+{
+    close();
+    if (capacity == 0) return false;
+
+    // Readers still mapping a segment from an earlier run keep it; new readers get this one
+    shm_unlink(tableName.c_str());
+    int fd = shm_open(tableName.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        CCM_ERROR << "[ERROR] Cannot create status table " << tableName << ": " << strerror(errno);
+        return false;
+    }
+    size_t bytes = sizeof(JobTableHeader) + static_cast<size_t>(capacity) * sizeof(JobTableSlot);
+    void* mapped = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        CCM_ERROR << "[ERROR] Cannot map status table " << tableName << ": " << strerror(error);
+        shm_unlink(tableName.c_str());
+        return false;
+    }
+
+    // ftruncate() zero-fills: every slot starts free with an even sequence
+    header = static_cast<JobTableHeader*>(mapped);
+    slots = reinterpret_cast<JobTableSlot*>(static_cast<char*>(mapped) + sizeof(JobTableHeader));
+    mappedBytes = bytes;
+    name = tableName;
+    {
+        std::lock_guard<std::mutex> lock(freeMutex);
+        freeSlots.clear();
+    }
+
+    header->version = JOB_TABLE_VERSION;
+    header->capacity = capacity;
+    header->slotSize = sizeof(JobTableSlot);
+    header->slotOffset = sizeof(JobTableHeader);
+    header->managerPid = getpid();
+    header->magic.store(JOB_TABLE_MAGIC, std::memory_order_release);
+    return true;
+}
+
+void JobStatusTable::close()
+{
+    if (!header) return;
+    munmap(header, mappedBytes);
+    shm_unlink(name.c_str());
+    header = nullptr;
+    slots = nullptr;
+    mappedBytes = 0;
+}
+
+int JobStatusTable::claim()
+{
+    if (!header) return -1;
+
+    std::lock_guard<std::mutex> lock(freeMutex);
+    uint32_t slot = header->highWater.load(std::memory_order_relaxed);
+    bool fresh = slot < header->capacity &&
+                 (freeSlots.empty() || freeSlots.size() < header->capacity / JOB_TABLE_RETAIN_DIVISOR);
+    if (fresh) {
+        header->highWater.store(slot + 1, std::memory_order_release);
+    } else if (!freeSlots.empty()) {
+        slot = freeSlots.front();
+        freeSlots.pop_front();
+    } else {
+        return -1;
+    }
+    header->liveJobs.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<int>(slot);
+}
+
+void JobStatusTable::publish(int slot, const JobTableEntry& entry)
+{
+    if (!header || slot < 0) return;
+
+    JobTableSlot& s = slots[slot];
+    uint32_t seq = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(seq + 1, std::memory_order_relaxed); // Odd: readers retry
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&s.entry, &entry, sizeof(entry));
+    s.sequence.store(seq + 2, std::memory_order_release);
+}
+
+void JobStatusTable::release(int slot)
+{
+    if (!header || slot < 0) return;
+
+    JobTableSlot& s = slots[slot];
+    uint32_t seq = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.entry.flags &= static_cast<uint8_t>(~JOB_ENTRY_IN_USE);
+    s.sequence.store(seq + 2, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(freeMutex);
+    header->liveJobs.fetch_sub(1, std::memory_order_relaxed);
+    freeSlots.push_back(static_cast<uint32_t>(slot));
+}
+
+JobStatusReader::~JobStatusReader()
+{
+    if (header) munmap(const_cast<JobTableHeader*>(header), mappedBytes);
+}
+
+bool JobStatusReader::open(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1) return false;
+
+    struct stat st;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(JobTableHeader)) {
+        mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    const JobTableHeader* h = static_cast<const JobTableHeader*>(mapped);
+    size_t size = static_cast<size_t>(st.st_size);
+    if (h->magic.load(std::memory_order_acquire) != JOB_TABLE_MAGIC || h->version != JOB_TABLE_VERSION ||
+        h->slotSize != sizeof(JobTableSlot) || h->slotOffset != sizeof(JobTableHeader) ||
+        size < h->slotOffset + static_cast<size_t>(h->capacity) * h->slotSize) {
+        munmap(mapped, size);
+        return false;
+    }
+
+    if (header) munmap(const_cast<JobTableHeader*>(header), mappedBytes);
+    header = h;
+    slots = reinterpret_cast<const JobTableSlot*>(static_cast<const char*>(mapped) + h->slotOffset);
+    mappedBytes = size;
+    return true;
+}
+
+bool JobStatusReader::readAny(uint32_t slot, JobTableEntry& out) const
+{
+    if (!header || slot >= header->capacity) return false;
+
+    const JobTableSlot& s = slots[slot];
+    for (int attempt = 0; attempt < JOB_TABLE_READ_RETRIES; ++attempt) {
+        uint32_t before = s.sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            sched_yield(); // The writer is mid-update
+            continue;
+        }
+        memcpy(&out, &s.entry, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+bool JobStatusReader::read(uint32_t slot, JobTableEntry& out) const
+{
+    return readAny(slot, out) && (out.flags & JOB_ENTRY_IN_USE);
+}
+
+void JobStatusReader::snapshot(std::vector<JobTableEntry>& out) const
+{
+    out.clear();
+    if (!header) return;
+
+    uint32_t used = usedSlots();
+    JobTableEntry entry;
+    for (uint32_t i = 0; i < used && i < header->capacity; ++i) {
+        if (read(i, entry)) out.push_back(entry);
+    }
+}
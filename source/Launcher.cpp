@@ -0,0 +1,149 @@
+#include "Launcher.h"
+
+#include <unistd.h>      // For execve(), _exit()
+#include <signal.h>      // For sigprocmask()
+#include <pthread.h>     // For pthread_sigmask()
+#include <sys/wait.h>    // For waitpid()
+#include <sys/syscall.h> // For SYS_set_mempolicy
+#include <sys/resource.h> // For setpriority()
+#include <dirent.h>      // For opendir(), readdir()
+#include <cstdio>        // For snprintf()
+#include <cstdlib>       // For atoi()
+#include <errno.h>
+
+extern char** environ;
+
+// Stack for the cloned child. It only runs until execve, so a small one is enough.
+// CLONE_VFORK keeps the launching thread suspended while the child uses it, so one
+// stack per launching thread can be reused for every spawn.
+static const size_t LAUNCH_STACK_SIZE = 64 * 1024;
+
+namespace {
+
+// Shared with the child through CLONE_VM; the child writes its results here.
+struct ChildContext {
+    const LaunchRequest* req;
+    sigset_t parentMask;
+    int execError;
+    int affinityError;
+    int cgroupError;
+    int memPolicyError;
+    int schedError;
+};
+
+// Runs in the child on the borrowed stack. Only async-signal-safe calls are allowed:
+// no CCM_* logging either, it would append to the suspended parent thread's log ring.
+int launch_child(void* arg)
+{
+    ChildContext* ctx = static_cast<ChildContext*>(arg);
+    const LaunchRequest* req = ctx->req;
+
+    if (req->cgroupProcsFd != -1) {
+        // Writing "0" moves the writing process into the cgroup
+        if (write(req->cgroupProcsFd, "0", 1) == -1) ctx->cgroupError = errno;
+    }
+    if (req->cpuMask && sched_setaffinity(0, req->cpuMaskSize, req->cpuMask) == -1) {
+        ctx->affinityError = errno;
+    }
+    // Raw syscall: the child is a separate task, so this only affects the new program
+    if (req->memPolicyMode != -1 &&
+        syscall(SYS_set_mempolicy, req->memPolicyMode, req->nodeMask, req->maxNode) == -1) {
+        ctx->memPolicyError = errno;
+    }
+    // After joining the cgroup: a FIFO task may not be allowed into a non-root group
+    if (req->schedPolicy != -1) {
+        struct sched_param param{};
+        param.sched_priority = req->schedPriority;
+        if (sched_setscheduler(0, req->schedPolicy, &param) == -1) ctx->schedError = errno;
+    }
+    if (req->nice != 0 && setpriority(PRIO_PROCESS, 0, req->nice) == -1 && ctx->schedError == 0) {
+        ctx->schedError = errno;
+    }
+
+    sigprocmask(SIG_SETMASK, &ctx->parentMask, nullptr);
+    execve(req->path, req->argv, req->envp ? req->envp : environ);
+
+    ctx->execError = errno;
+    _exit(127);
+}
+
+} // namespace
+
+LaunchResult launch_process(const LaunchRequest& req)
+{
+    alignas(16) thread_local char stack[LAUNCH_STACK_SIZE];
+    LaunchResult result;
+
+    ChildContext ctx{};
+    ctx.req = &req;
+
+    // Keep signals blocked in the child until exec so none of the manager's
+    // handlers can run on the shared address space.
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &ctx.parentMask);
+
+    int pidfd = -1;
+    int flags = CLONE_VM | CLONE_VFORK | SIGCHLD;
+    if (req.reparent) flags |= CLONE_PARENT;
+    pid_t pid = clone(launch_child, stack + sizeof(stack), flags | CLONE_PIDFD, &ctx, &pidfd);
+    if (pid == -1 && errno == EINVAL) {
+        // Kernel older than 5.2: no CLONE_PIDFD
+        pidfd = -1;
+        pid = clone(launch_child, stack + sizeof(stack), flags, &ctx);
+    }
+    int cloneError = errno;
+
+    pthread_sigmask(SIG_SETMASK, &ctx.parentMask, nullptr);
+
+    if (pid == -1) {
+        result.error = cloneError;
+        return result;
+    }
+
+    result.affinityError = ctx.affinityError;
+    result.cgroupError = ctx.cgroupError;
+    result.memPolicyError = ctx.memPolicyError;
+    result.schedError = ctx.schedError;
+
+    if (ctx.execError != 0) {
+        // The child has already exited; collect it so it is never reported as a job
+        if (pidfd != -1) close(pidfd);
+        if (req.reparent) {
+            result.strayPid = pid; // Not our child: only the new parent can collect it
+        } else {
+            waitpid(pid, nullptr, 0);
+        }
+        result.error = ctx.execError;
+        return result;
+    }
+
+    result.pid = pid;
+    result.pidfd = pidfd;
+    return result;
+}
+
+int set_process_affinity(pid_t pid, const cpu_set_t* mask, size_t maskSize)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+
+    DIR* dir = opendir(path);
+    if (!dir) {
+        // No procfs view: at least move the main thread
+        return sched_setaffinity(pid, maskSize, mask) == -1 ? errno : 0;
+    }
+
+    int error = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != nullptr) {
+        if (ent->d_name[0] < '0' || ent->d_name[0] > '9') continue;
+        pid_t tid = static_cast<pid_t>(atoi(ent->d_name));
+        // Threads may exit while we walk the list; ESRCH is not a failure
+        if (sched_setaffinity(tid, maskSize, mask) == -1 && errno != ESRCH && error == 0) {
+            error = errno;
+        }
+    }
+    closedir(dir);
+    return error;
+}
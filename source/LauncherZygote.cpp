@@ -0,0 +1,386 @@
+#include "LauncherZygote.h"
+#include "Logger.h"
+#include <fstream>
+#include <cstring>       // For memcpy(), strlen(), strerror()
+#include <errno.h>
+#include <signal.h>      // For kill()
+#include <unistd.h>      // For fork(), close(), getppid(), sysconf()
+#include <sys/prctl.h>   // For prctl(PR_SET_PDEATHSIG)
+#include <sys/socket.h>  // For socketpair(), sendmsg(), recvmsg()
+#include <sys/syscall.h> // For SYS_close_range
+#include <sys/wait.h>    // For waitpid()
+#include <nlohmann/json.hpp>
+
+namespace {
+
+// Fixed part of a spawn request. The variable part follows in this order:
+// node mask words, cpu mask bytes, path (NUL-terminated), argv strings (each NUL-terminated).
+struct ZygoteRequest {
+    uint32_t nodeMaskWords;
+    uint32_t cpuMaskSize;
+    uint32_t pathBytes;
+    uint32_t argc;
+    uint32_t argBytes;
+    int32_t memPolicyMode;
+    int32_t schedPolicy;
+    int32_t schedPriority;
+    int32_t nice;
+    uint32_t pad;
+    uint64_t maxNode;
+};
+
+// Outcome of a spawn; the job's pidfd, if any, is attached with SCM_RIGHTS.
+// The zygote also sends one with pid 0 once it is ready (error = pinning errno).
+struct ZygoteReply {
+    int32_t pid;
+    int32_t error;
+    int32_t affinityError;
+    int32_t cgroupError;
+    int32_t memPolicyError;
+    int32_t schedError;
+    int32_t strayPid;
+    int32_t pad;
+};
+
+ssize_t send_with_fd(int sock, const void* data, size_t len, int fd)
+{
+    iovec iov{const_cast<void*>(data), len};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if (fd != -1) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+    return n;
+}
+
+// Returns the message length, 0 when the peer has closed its end, -1 on error
+ssize_t receive_with_fd(int sock, void* data, size_t len, int& fd)
+{
+    fd = -1;
+    iovec iov{data, len};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n == -1 && errno == EINTR);
+    if (n <= 0) return n;
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    return n;
+}
+
+// Points 'req' into the received buffer. Checks every length against 'size'.
+bool decode_request(char* buf, size_t size, int cgroupFd, char** argv, LaunchRequest& req)
+{
+    if (size < sizeof(ZygoteRequest)) return false;
+    ZygoteRequest head;
+    memcpy(&head, buf, sizeof(head));
+    size_t nodeBytes = static_cast<size_t>(head.nodeMaskWords) * sizeof(unsigned long);
+    if (sizeof(head) + nodeBytes + head.cpuMaskSize + head.pathBytes + head.argBytes != size) return false;
+    if (head.pathBytes == 0 || head.argc == 0 || head.argc > ZYGOTE_MAX_ARGS) return false;
+
+    char* p = buf + sizeof(head);
+    if (nodeBytes > 0) {
+        req.nodeMask = reinterpret_cast<const unsigned long*>(p);
+        req.maxNode = head.maxNode;
+        p += nodeBytes;
+    }
+    if (head.cpuMaskSize > 0) {
+        req.cpuMask = reinterpret_cast<const cpu_set_t*>(p);
+        req.cpuMaskSize = head.cpuMaskSize;
+        p += head.cpuMaskSize;
+    }
+    req.path = p;
+    if (p[head.pathBytes - 1] != '\0') return false;
+    p += head.pathBytes;
+
+    char* end = p + head.argBytes;
+    uint32_t argc = 0;
+    while (p < end && argc < head.argc) {
+        argv[argc++] = p;
+        char* nul = static_cast<char*>(memchr(p, '\0', static_cast<size_t>(end - p)));
+        if (!nul) return false;
+        p = nul + 1;
+    }
+    if (argc != head.argc || p != end) return false;
+    argv[argc] = nullptr;
+    req.argv = argv;
+
+    req.memPolicyMode = head.memPolicyMode;
+    req.schedPolicy = head.schedPolicy;
+    req.schedPriority = head.schedPriority;
+    req.nice = head.nice;
+    req.cgroupProcsFd = cgroupFd;
+    req.reparent = true;
+    return true;
+}
+
+void close_inherited_fds(int keep)
+{
+    // stdio stays: jobs inherit it, as they do from the manager
+#ifdef SYS_close_range
+    bool below = keep <= 3 || syscall(SYS_close_range, 3u, static_cast<unsigned>(keep - 1), 0u) == 0;
+    if (below && syscall(SYS_close_range, static_cast<unsigned>(keep + 1), ~0u, 0u) == 0) return;
+#endif
+    long maxFd = sysconf(_SC_OPEN_MAX);
+    if (maxFd < 0 || maxFd > 65536) maxFd = 65536;
+    for (int fd = 3; fd < maxFd; ++fd) {
+        if (fd != keep) close(fd);
+    }
+}
+
+// The zygote process. It is forked from a multi-threaded manager, so it sticks to
+// system calls and static buffers: another thread may have held a lock at fork time.
+[[noreturn]] void zygote_main(int sock, const CpuMask& pin, pid_t manager)
+{
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != manager) _exit(0);
+    close_inherited_fds(sock);
+
+    ZygoteReply ready{};
+    if (sched_setaffinity(0, pin.byteSize(), pin.data()) == -1) ready.error = errno;
+    if (send_with_fd(sock, &ready, sizeof(ready), -1) == -1 || ready.error != 0) _exit(1);
+
+    alignas(unsigned long) static char request[ZYGOTE_MAX_REQUEST];
+    static char* argv[ZYGOTE_MAX_ARGS + 1];
+    while (true) {
+        int cgroupFd = -1;
+        ssize_t n = receive_with_fd(sock, request, sizeof(request), cgroupFd);
+        if (n <= 0) _exit(0); // The manager closed its end (or is gone)
+
+        ZygoteReply reply{};
+        reply.pid = -1;
+        reply.strayPid = -1;
+        int pidfd = -1;
+        LaunchRequest req;
+        if (!decode_request(request, static_cast<size_t>(n), cgroupFd, argv, req)) {
+            reply.error = EINVAL;
+        } else {
+            LaunchResult launched = launch_process(req);
+            reply.pid = launched.pid;
+            reply.error = launched.error;
+            reply.affinityError = launched.affinityError;
+            reply.cgroupError = launched.cgroupError;
+            reply.memPolicyError = launched.memPolicyError;
+            reply.schedError = launched.schedError;
+            reply.strayPid = launched.strayPid;
+            pidfd = launched.pidfd;
+        }
+        if (cgroupFd != -1) close(cgroupFd);
+        if (send_with_fd(sock, &reply, sizeof(reply), pidfd) == -1) _exit(1);
+        if (pidfd != -1) close(pidfd);
+    }
+}
+
+} // namespace
+
+bool load_zygote_mode(const std::string& path, ZygoteMode& mode)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("Launcher");
+        if (section == config.end() || !section->is_object()) return true; // Keep the default
+        std::string value = section->value("Zygotes", "off");
+        if (value == "off") {
+            mode = ZYGOTE_OFF;
+        } else if (value == "core") {
+            mode = ZYGOTE_PER_CORE;
+        } else if (value == "node") {
+            mode = ZYGOTE_PER_NODE;
+        } else {
+            CCM_ERROR << "[ERROR] Unknown Launcher.Zygotes value '" << value << "' in " << path
+                      << " (expected off, core or node)";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid launcher settings in " << path << ": " << e.what();
+        return false;
+    }
+    return true;
+}
+
+ZygotePool::~ZygotePool()
+{
+    stop();
+}
+
+bool ZygotePool::start(ZygoteMode mode, const CpuTopology& topology)
+{
+    stop();
+    if (mode == ZYGOTE_OFF) return false;
+
+    std::vector<std::vector<int>> groups;
+    if (mode == ZYGOTE_PER_NODE) {
+        for (int node = 0; node < topology.numaNodeCount(); ++node) {
+            if (!topology.cpusOfNode(node).empty()) groups.push_back(topology.cpusOfNode(node));
+        }
+    } else {
+        for (int cpu = 0; cpu < topology.cpuCount(); ++cpu) {
+            if (topology.present(cpu)) groups.push_back({cpu});
+        }
+    }
+
+    zygoteOfCpu.assign(static_cast<size_t>(topology.cpuCount()), -1);
+    pid_t manager = getpid();
+    for (const auto& cpus : groups) {
+        CpuMask pin(topology.cpuCount());
+        for (int cpu : cpus) pin.set(cpu);
+
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+            CCM_ERROR << "[LAUNCHER] socketpair failed: " << strerror(errno);
+            break;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(sv[0]);
+            zygote_main(sv[1], pin, manager);
+        }
+        close(sv[1]);
+        if (pid == -1) {
+            CCM_ERROR << "[LAUNCHER] Cannot fork zygote for cores " << pin.toString() << ": " << strerror(errno);
+            close(sv[0]);
+            break;
+        }
+
+        auto zygote = std::make_unique<Zygote>();
+        zygote->pid = pid;
+        zygote->socket = sv[0];
+        zygote->cpus = cpus;
+        ZygoteReply ready{};
+        int unused;
+        if (receive_with_fd(sv[0], &ready, sizeof(ready), unused) != static_cast<ssize_t>(sizeof(ready)) ||
+            ready.error != 0) {
+            CCM_WARN << "[LAUNCHER] Zygote for cores " << pin.toString() << " failed to start"
+                     << (ready.error ? std::string(": ") + strerror(ready.error) : std::string()) << ".";
+            retire(*zygote, nullptr);
+            continue;
+        }
+        for (int cpu : cpus) zygoteOfCpu[static_cast<size_t>(cpu)] = static_cast<int>(zygotes.size());
+        zygotes.push_back(std::move(zygote));
+    }
+
+    if (zygotes.empty()) return false;
+    CCM_INFO << "[LAUNCHER] Started " << zygotes.size() << " launcher zygote(s), one per "
+             << (mode == ZYGOTE_PER_NODE ? "NUMA node." : "core.");
+    return true;
+}
+
+void ZygotePool::stop()
+{
+    for (auto& zygote : zygotes) {
+        if (zygote->socket == -1) continue;
+        // EOF on its socket makes the zygote exit
+        close(zygote->socket);
+        zygote->socket = -1;
+        waitpid(zygote->pid, nullptr, 0);
+    }
+    zygotes.clear();
+    zygoteOfCpu.clear();
+}
+
+void ZygotePool::retire(Zygote& zygote, const char* reason)
+{
+    if (reason) {
+        CCM_WARN << "[LAUNCHER] Zygote PID " << zygote.pid << " " << reason << ", launching in-process from now on.";
+    }
+    close(zygote.socket);
+    zygote.socket = -1;
+    kill(zygote.pid, SIGKILL);
+    waitpid(zygote.pid, nullptr, 0);
+}
+
+bool ZygotePool::launch(const LaunchRequest& req, const CpuMask& cpus, LaunchResult& result)
+{
+    if (zygotes.empty() || cpus.empty() || req.envp) return false;
+    size_t cpu = static_cast<size_t>(cpus.cpus().front());
+    if (cpu >= zygoteOfCpu.size() || zygoteOfCpu[cpu] == -1) return false;
+    Zygote& zygote = *zygotes[static_cast<size_t>(zygoteOfCpu[cpu])];
+
+    // The child inherits the zygote's pinning; only a different mask is sent along
+    bool inherited = cpus.cpus() == zygote.cpus;
+    ZygoteRequest head{};
+    head.nodeMaskWords = req.nodeMask
+        ? static_cast<uint32_t>((req.maxNode - 1 + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))) : 0;
+    head.cpuMaskSize = inherited || !req.cpuMask ? 0 : static_cast<uint32_t>(req.cpuMaskSize);
+    head.pathBytes = static_cast<uint32_t>(strlen(req.path) + 1);
+    for (char* const* arg = req.argv; *arg; ++arg) {
+        head.argc++;
+        head.argBytes += static_cast<uint32_t>(strlen(*arg) + 1);
+    }
+    head.memPolicyMode = req.memPolicyMode;
+    head.schedPolicy = req.schedPolicy;
+    head.schedPriority = req.schedPriority;
+    head.nice = req.nice;
+    head.maxNode = req.maxNode;
+    size_t nodeBytes = static_cast<size_t>(head.nodeMaskWords) * sizeof(unsigned long);
+    size_t total = sizeof(head) + nodeBytes + head.cpuMaskSize + head.pathBytes + head.argBytes;
+    if (total > ZYGOTE_MAX_REQUEST || head.argc == 0 || head.argc > ZYGOTE_MAX_ARGS) return false;
+
+    std::lock_guard<std::mutex> lock(zygote.mutex);
+    if (zygote.socket == -1) return false;
+
+    std::vector<char>& buf = zygote.buffer;
+    buf.resize(total);
+    char* p = buf.data();
+    memcpy(p, &head, sizeof(head));
+    p += sizeof(head);
+    if (nodeBytes > 0) memcpy(p, req.nodeMask, nodeBytes);
+    p += nodeBytes;
+    if (head.cpuMaskSize > 0) memcpy(p, req.cpuMask, head.cpuMaskSize);
+    p += head.cpuMaskSize;
+    memcpy(p, req.path, head.pathBytes);
+    p += head.pathBytes;
+    for (char* const* arg = req.argv; *arg; ++arg) {
+        size_t len = strlen(*arg) + 1;
+        memcpy(p, *arg, len);
+        p += len;
+    }
+
+    if (send_with_fd(zygote.socket, buf.data(), total, req.cgroupProcsFd) != static_cast<ssize_t>(total)) {
+        retire(zygote, "stopped accepting requests");
+        return false;
+    }
+    ZygoteReply reply{};
+    int pidfd = -1;
+    if (receive_with_fd(zygote.socket, &reply, sizeof(reply), pidfd) != static_cast<ssize_t>(sizeof(reply))) {
+        // If it died after the clone, the job is our child but runs untracked
+        retire(zygote, "died during a launch");
+        if (pidfd != -1) close(pidfd);
+        return false;
+    }
+
+    // An exec failure leaves the child to us, the new parent
+    if (reply.strayPid > 0) waitpid(reply.strayPid, nullptr, 0);
+    result.pid = reply.pid;
+    result.pidfd = reply.pid > 0 ? pidfd : -1;
+    if (reply.pid <= 0 && pidfd != -1) close(pidfd);
+    result.error = reply.error;
+    result.affinityError = reply.affinityError;
+    result.cgroupError = reply.cgroupError;
+    result.memPolicyError = reply.memPolicyError;
+    result.schedError = reply.schedError;
+    return true;
+}
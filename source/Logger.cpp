@@ -0,0 +1,305 @@
+#include "Logger.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <charconv>    // For std::to_chars()
+#include <cstdio>      // For snprintf()
+#include <cstdlib>     // For atexit()
+#include <cstring>     // For memcpy(), strlen()
+#include <ctime>       // For clock_gettime(), localtime_r()
+#include <errno.h>
+#include <unistd.h>    // For write()
+#include <nlohmann/json.hpp>
+
+/*
+ * Ring layout: records are 16-byte aligned so the space left before the end
+ * of the buffer always fits a header. A record that does not fit there is
+ * preceded by a wrap marker covering the rest of the buffer.
+ */
+namespace {
+
+struct RecordHeader {
+    uint32_t size;  // Text bytes, or bytes to skip for a wrap marker
+    uint8_t level;  // LogLevel, or WRAP_MARKER
+    uint8_t reserved[3];
+    uint64_t timeNs;
+};
+static_assert(sizeof(RecordHeader) == 16, "record headers must keep 16-byte alignment");
+
+const uint8_t WRAP_MARKER = 0xff;
+
+size_t align16(size_t n) { return (n + 15) & ~static_cast<size_t>(15); }
+
+uint64_t clock_ns(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void write_all(int fd, const std::string& data)
+{
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return; // Nowhere left to report it
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+void flush_at_exit()
+{
+    Logger::instance().flush();
+}
+
+} // namespace
+
+// Single-producer (the owning thread), single-consumer (whoever holds drainMutex)
+struct Logger::Ring {
+    std::unique_ptr<char[]> data{new char[LOG_RING_BYTES]};
+    std::atomic<uint64_t> head{0};    // Consumer position, in bytes since creation
+    std::atomic<uint64_t> tail{0};    // Producer position
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> orphaned{false}; // Owner thread exited; removed once drained
+};
+
+namespace {
+
+// Marks the thread's ring for removal when the thread exits
+struct RingOwner {
+    std::shared_ptr<void> ring;
+    std::atomic<bool>* orphaned = nullptr;
+    ~RingOwner()
+    {
+        if (orphaned) orphaned->store(true, std::memory_order_release);
+    }
+};
+
+} // namespace
+
+LogLevel log_level_from_string(const std::string& name)
+{
+    if (name == "debug") return LEVEL_DEBUG;
+    if (name == "warn" || name == "warning") return LEVEL_WARN;
+    if (name == "error") return LEVEL_ERROR;
+    if (name == "off") return LEVEL_OFF;
+    return LEVEL_INFO;
+}
+
+bool load_log_settings(const std::string& path, LogSettings& settings)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("Logging");
+        if (section == config.end() || !section->is_object()) return true; // Keep the defaults
+        if (section->contains("Level")) settings.level = log_level_from_string((*section)["Level"].get<std::string>());
+        settings.timestamps = section->value("Timestamps", settings.timestamps);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Invalid logging settings in " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Logger& Logger::instance()
+{
+    // Never destroyed: threads may still log while static destructors run
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger()
+    : realtimeOffsetNs(static_cast<int64_t>(clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC)))
+{
+    writer = std::thread(&Logger::run, this);
+    writer.detach();
+    atexit(flush_at_exit);
+}
+
+void Logger::configure(const LogSettings& settings)
+{
+    minLevel.store(settings.level, std::memory_order_relaxed);
+    timestamps.store(settings.timestamps, std::memory_order_relaxed);
+}
+
+Logger::Ring* Logger::registerThread()
+{
+    thread_local RingOwner owner;
+    if (!owner.ring) {
+        auto ring = std::make_shared<Ring>();
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(ring);
+        }
+        owner.orphaned = &ring->orphaned;
+        owner.ring = ring;
+    }
+    return static_cast<Ring*>(owner.ring.get());
+}
+
+void Logger::append(LogLevel level, const char* text, size_t len)
+{
+    Ring* ring = registerThread();
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+
+    size_t need = align16(sizeof(RecordHeader) + len);
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    size_t offset = static_cast<size_t>(tail % LOG_RING_BYTES);
+    size_t contiguous = LOG_RING_BYTES - offset;
+    size_t total = need <= contiguous ? need : contiguous + need;
+    if (tail + total - head > LOG_RING_BYTES) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    char* data = ring->data.get();
+    if (need > contiguous) {
+        RecordHeader wrap{};
+        wrap.size = static_cast<uint32_t>(contiguous);
+        wrap.level = WRAP_MARKER;
+        memcpy(data + offset, &wrap, sizeof(wrap));
+        tail += contiguous;
+        offset = 0;
+    }
+    RecordHeader header{};
+    header.size = static_cast<uint32_t>(len);
+    header.level = level;
+    header.timeNs = now;
+    memcpy(data + offset, &header, sizeof(header));
+    memcpy(data + offset + sizeof(header), text, len);
+    ring->tail.store(tail + need, std::memory_order_release);
+}
+
+void Logger::flush()
+{
+    std::lock_guard<std::mutex> lock(drainMutex);
+    drainLocked();
+}
+
+void Logger::run()
+{
+    for (;;) {
+        // Polling keeps producers free of any wakeup call
+        std::this_thread::sleep_for(std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+        std::lock_guard<std::mutex> lock(drainMutex);
+        drainLocked();
+    }
+}
+
+void Logger::drainLocked()
+{
+    std::vector<std::shared_ptr<Ring>> current;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        current = rings;
+    }
+
+    batch.clear();
+    uint64_t drops = retiredDrops;
+    for (size_t r = 0; r < current.size(); ++r) {
+        Ring& ring = *current[r];
+        // Read 'orphaned' first: everything the thread appended before exiting is then visible
+        bool orphaned = ring.orphaned.load(std::memory_order_acquire);
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        uint64_t tail = ring.tail.load(std::memory_order_acquire);
+        const char* data = ring.data.get();
+        while (head < tail) {
+            RecordHeader header;
+            memcpy(&header, data + head % LOG_RING_BYTES, sizeof(header));
+            if (header.level == WRAP_MARKER) {
+                head += header.size;
+                continue;
+            }
+            const char* text = data + head % LOG_RING_BYTES + sizeof(header);
+            batch.push_back(Record{header.timeNs, static_cast<LogLevel>(header.level), std::string(text, header.size)});
+            head += align16(sizeof(header) + header.size);
+        }
+        ring.head.store(head, std::memory_order_release);
+        drops += ring.dropped.load(std::memory_order_relaxed);
+
+        if (orphaned) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.erase(std::remove(rings.begin(), rings.end(), current[r]), rings.end());
+            retiredDrops += ring.dropped.load(std::memory_order_relaxed);
+        }
+    }
+    if (batch.empty() && drops == reportedDrops) return;
+
+    // Each ring is already in order; the stable sort interleaves the threads by time
+    std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) {
+        return a.timeNs < b.timeNs;
+    });
+
+    bool stamp = timestamps.load(std::memory_order_relaxed);
+    out[0].clear();
+    out[1].clear();
+    for (const Record& record : batch) {
+        std::string& stream = out[record.level >= LEVEL_WARN ? 1 : 0];
+        if (stamp) {
+            uint64_t wallNs = record.timeNs + static_cast<uint64_t>(realtimeOffsetNs);
+            time_t seconds = static_cast<time_t>(wallNs / 1000000000ull);
+            struct tm local;
+            localtime_r(&seconds, &local);
+            char prefix[32];
+            size_t n = strftime(prefix, sizeof(prefix), "%H:%M:%S", &local);
+            snprintf(prefix + n, sizeof(prefix) - n, ".%06llu ",
+                     static_cast<unsigned long long>(wallNs / 1000 % 1000000));
+            stream += prefix;
+        }
+        stream += record.text;
+        stream += '\n';
+    }
+    if (drops > reportedDrops) {
+        out[1] += "[LOG] " + std::to_string(drops - reportedDrops) + " message(s) dropped, log ring full.\n";
+    }
+    reportedDrops = drops;
+
+    // std::cout users (start-up banners) flush before the batch, so lines keep their order
+    std::cout.flush();
+    write_all(STDOUT_FILENO, out[0]);
+    write_all(STDERR_FILENO, out[1]);
+}
+
+LogLine& LogLine::write(const char* s, size_t n)
+{
+    size_t room = LOG_LINE_MAX - len;
+    if (n > room) n = room;
+    memcpy(buf + len, s, n);
+    len += n;
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const char* s)
+{
+    if (!s) s = "(null)";
+    return write(s, strlen(s));
+}
+
+LogLine& LogLine::operator<<(long long v)
+{
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    return write(tmp, static_cast<size_t>(res.ptr - tmp));
+}
+
+LogLine& LogLine::operator<<(unsigned long long v)
+{
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    return write(tmp, static_cast<size_t>(res.ptr - tmp));
+}
+
+LogLine& LogLine::operator<<(double v)
+{
+    // Same output as an ostream with default precision
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%g", v);
+    return write(tmp, n > 0 ? static_cast<size_t>(n) : 0);
+}
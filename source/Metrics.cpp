@@ -0,0 +1,364 @@
+#include "Metrics.h"
+#include "Logger.h"
+#include <fstream>
+#include <cmath>       // For NAN
+#include <cstdio>      // For snprintf(), rename()
+#include <cstring>     // For strerror(), strncmp()
+#include <ctime>       // For clock_gettime()
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>     // For open()
+#include <poll.h>      // For poll()
+#include <unistd.h>    // For write(), read(), close(), unlink()
+#include <sys/socket.h>
+#include <sys/stat.h>  // For lstat()
+#include <sys/time.h>  // For timeval
+#include <sys/un.h>    // For sockaddr_un
+#include <nlohmann/json.hpp>
+
+// Longest wait for a stop request while serving the socket
+static const int METRICS_POLL_MS = 100;
+// Time a socket client gets to send an HTTP request line before it is sent plain text
+static const int METRICS_REQUEST_WAIT_MS = 50;
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "decode", "dispatch_wait", "lock_wait", "placement", "spawn", "reap", "admission_wait", "load_sample"};
+
+static const struct {
+    const char* name;
+    const char* help;
+} COUNTER_INFO[COUNTER_COUNT] = {
+    {"ccm_messages_received_total", "Queue messages received."},
+    {"ccm_commands_total", "Commands dispatched to a handler."},
+    {"ccm_jobs_started_total", "Jobs launched."},
+    {"ccm_job_start_failures_total", "StartJobs that failed to launch."},
+    {"ccm_jobs_queued_total", "StartJobs that had to wait for admission."},
+    {"ccm_jobs_exited_total", "Job exits handled by the monitor."},
+    {"ccm_kills_escalated_total", "Terminations that needed SIGKILL."},
+    {"ccm_migrations_total", "Jobs moved by the rebalancer."},
+    {"ccm_replies_dropped_total", "Command replies that could not be delivered."},
+};
+
+static const double EXPORT_QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+const char* metric_stage_name(MetricStage stage)
+{
+    return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
+
+uint64_t metrics_now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void append_seconds(std::string& out, double ns)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.12g", ns / 1e9); // Whole nanoseconds up to 1000 s
+    out += buf;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t ns)
+{
+    const uint64_t subBuckets = 1ull << HISTOGRAM_SUB_BITS;
+    if (ns < subBuckets) return static_cast<size_t>(ns);
+    if (ns >> HISTOGRAM_MAX_BITS) return HISTOGRAM_BUCKETS - 1;
+
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - HISTOGRAM_SUB_BITS;
+    return (static_cast<size_t>(shift + 1) << HISTOGRAM_SUB_BITS) + static_cast<size_t>((ns >> shift) - subBuckets);
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t bucket)
+{
+    const uint64_t subBuckets = 1ull << HISTOGRAM_SUB_BITS;
+    if (bucket < subBuckets) return bucket;
+    int shift = static_cast<int>(bucket >> HISTOGRAM_SUB_BITS) - 1;
+    return (subBuckets + (bucket & (subBuckets - 1))) << shift;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket)
+{
+    const uint64_t subBuckets = 1ull << HISTOGRAM_SUB_BITS;
+    if (bucket < subBuckets) return bucket + 1;
+    int shift = static_cast<int>(bucket >> HISTOGRAM_SUB_BITS) - 1;
+    return (subBuckets + (bucket & (subBuckets - 1)) + 1) << shift;
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+    counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::snapshot(HistogramSnapshot& out) const
+{
+    out.counts.resize(HISTOGRAM_BUCKETS);
+    out.count = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        out.counts[i] = counts[i].load(std::memory_order_relaxed);
+        out.count += out.counts[i];
+    }
+    out.sum = sum.load(std::memory_order_relaxed);
+}
+
+uint64_t HistogramSnapshot::valueAt(double q) const
+{
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count)));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t lo = LatencyHistogram::bucketLowerBound(i);
+            return lo + (LatencyHistogram::bucketUpperBound(i) - lo) / 2;
+        }
+    }
+    return LatencyHistogram::bucketLowerBound(counts.size() - 1);
+}
+
+uint64_t HistogramSnapshot::countBelow(uint64_t bound) const
+{
+    uint64_t below = 0;
+    for (size_t i = 0; i < counts.size() && LatencyHistogram::bucketUpperBound(i) <= bound; ++i) below += counts[i];
+    return below;
+}
+
+Metrics& Metrics::instance()
+{
+    // Never destroyed: threads may still record while static destructors run
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+void Metrics::writePrometheus(std::string& out) const
+{
+    HistogramSnapshot snap;
+    std::string label;
+
+    out += "# HELP ccm_stage_duration_seconds Time spent in each manager stage.\n"
+           "# TYPE ccm_stage_duration_seconds histogram\n";
+    std::string quantiles;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        stages[s].snapshot(snap);
+        label = std::string("stage=\"") + STAGE_NAMES[s] + "\"";
+        // Bucket edges are powers of two, where the histogram's counts are exact. The count
+        // below 2^bit ns is the count at or under 2^bit - 1 ns, the inclusive bound "le" means.
+        for (int bit = METRICS_EXPORT_MIN_BIT; bit <= METRICS_EXPORT_MAX_BIT; ++bit) {
+            uint64_t edge = 1ull << bit;
+            out += "ccm_stage_duration_seconds_bucket{" + label + ",le=\"";
+            append_seconds(out, static_cast<double>(edge - 1));
+            out += "\"} " + std::to_string(snap.countBelow(edge)) + "\n";
+        }
+        out += "ccm_stage_duration_seconds_bucket{" + label + ",le=\"+Inf\"} " + std::to_string(snap.count) + "\n";
+        out += "ccm_stage_duration_seconds_sum{" + label + "} ";
+        append_seconds(out, static_cast<double>(snap.sum));
+        out += "\nccm_stage_duration_seconds_count{" + label + "} " + std::to_string(snap.count) + "\n";
+
+        for (double q : EXPORT_QUANTILES) {
+            char qs[16];
+            snprintf(qs, sizeof(qs), "%g", q);
+            quantiles += "ccm_stage_duration_quantile_seconds{" + label + ",quantile=\"" + qs + "\"} ";
+            if (snap.count == 0) {
+                quantiles += "NaN";
+            } else {
+                append_seconds(quantiles, static_cast<double>(snap.valueAt(q)));
+            }
+            quantiles += "\n";
+        }
+    }
+    out += "# HELP ccm_stage_duration_quantile_seconds Stage latency quantiles since start (within 6.25%).\n"
+           "# TYPE ccm_stage_duration_quantile_seconds gauge\n";
+    out += quantiles;
+
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        out += std::string("# HELP ") + COUNTER_INFO[c].name + " " + COUNTER_INFO[c].help + "\n";
+        out += std::string("# TYPE ") + COUNTER_INFO[c].name + " counter\n";
+        out += std::string(COUNTER_INFO[c].name) + " " +
+               std::to_string(counters[c].load(std::memory_order_relaxed)) + "\n";
+    }
+}
+
+bool load_metrics_settings(const std::string& path, MetricsSettings& settings)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        nlohmann::json config = nlohmann::json::parse(file);
+        auto section = config.find("Metrics");
+        if (section == config.end() || !section->is_object()) return true; // Keep the defaults
+        settings.file = section->value("File", settings.file);
+        settings.socket = section->value("Socket", settings.socket);
+        settings.intervalMs = section->value("IntervalMs", settings.intervalMs);
+        if (settings.intervalMs <= 0) settings.intervalMs = METRICS_DEFAULT_INTERVAL_MS;
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid metrics settings in " << path << ": " << e.what();
+        return false;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// For the socket: MSG_NOSIGNAL, so a client that hangs up early cannot raise SIGPIPE in the manager
+static bool send_all(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+bool MetricsExporter::start(const MetricsSettings& newSettings, Renderer renderer)
+{
+    stop();
+    settings = newSettings;
+    render = std::move(renderer);
+
+    if (!settings.socket.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        struct stat st;
+        if (settings.socket.size() >= sizeof(addr.sun_path)) {
+            CCM_ERROR << "[ERROR] Metrics socket path too long: " << settings.socket;
+        } else if (lstat(settings.socket.c_str(), &st) == 0 && !S_ISSOCK(st.st_mode)) {
+            CCM_ERROR << "[ERROR] Metrics socket path " << settings.socket << " exists and is not a socket.";
+        } else {
+            // A socket left behind by an earlier instance
+            unlink(settings.socket.c_str());
+            memcpy(addr.sun_path, settings.socket.c_str(), settings.socket.size() + 1);
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (listenFd == -1 || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+                listen(listenFd, 16) == -1) {
+                CCM_ERROR << "[ERROR] Cannot listen on metrics socket " << settings.socket << ": " << strerror(errno);
+                if (listenFd != -1) close(listenFd);
+                listenFd = -1;
+            }
+        }
+    }
+    if (listenFd == -1 && settings.file.empty()) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = false;
+    }
+    thread = std::thread(&MetricsExporter::run, this);
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopCv.notify_all();
+    if (thread.joinable()) thread.join();
+    if (listenFd != -1) {
+        close(listenFd);
+        unlink(settings.socket.c_str());
+        listenFd = -1;
+    }
+}
+
+void MetricsExporter::run()
+{
+    std::string text;
+    uint64_t nextWrite = 0;
+    const uint64_t interval = static_cast<uint64_t>(settings.intervalMs) * 1000000ull;
+
+    while (true) {
+        uint64_t now = metrics_now_ns();
+        if (!settings.file.empty() && now >= nextWrite) {
+            text.clear();
+            render(text);
+            writeFile(text);
+            nextWrite = now + interval;
+        }
+
+        int timeoutMs = settings.file.empty() ? -1 : static_cast<int>((nextWrite - now + 999999) / 1000000);
+        if (listenFd == -1) {
+            std::unique_lock<std::mutex> lock(stopMutex);
+            if (stopCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return stopping; })) break;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stopMutex);
+            if (stopping) break;
+        }
+        if (timeoutMs < 0 || timeoutMs > METRICS_POLL_MS) timeoutMs = METRICS_POLL_MS;
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, timeoutMs) <= 0) continue;
+
+        int client = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client == -1) continue;
+        text.clear();
+        render(text);
+        serveClient(client, text);
+        close(client);
+    }
+}
+
+void MetricsExporter::writeFile(const std::string& text)
+{
+    // Scrapers never see a half-written file
+    std::string tmp = settings.file + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd != -1 && write_all(fd, text.data(), text.size());
+    if (fd != -1) close(fd);
+    ok = ok && rename(tmp.c_str(), settings.file.c_str()) == 0;
+    if (!ok) {
+        CCM_WARN << "[WARN] Cannot write metrics file " << settings.file << ": " << strerror(errno);
+    }
+}
+
+void MetricsExporter::serveClient(int fd, const std::string& text)
+{
+    timeval sendTimeout{1, 0}; // A stalled reader must not hold up the exporter
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+    // HTTP clients (curl --unix-socket) send a request first; plain readers (socat) do not
+    char request[512];
+    ssize_t n = 0;
+    pollfd pfd{fd, POLLIN, 0};
+    if (poll(&pfd, 1, METRICS_REQUEST_WAIT_MS) > 0) n = read(fd, request, sizeof(request));
+    if (n >= 4 && strncmp(request, "GET ", 4) == 0) {
+        std::string header = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                             std::to_string(text.size()) + "\r\nConnection: close\r\n\r\n";
+        if (!send_all(fd, header.data(), header.size())) return;
+    }
+    send_all(fd, text.data(), text.size());
+}
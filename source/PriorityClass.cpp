@@ -0,0 +1,53 @@
+#include "PriorityClass.h"
+#include <sched.h>     // For SCHED_FIFO, SCHED_BATCH, SCHED_IDLE
+
+#ifndef SCHED_RESET_ON_FORK
+#define SCHED_RESET_ON_FORK 0x40000000
+#endif
+
+static const char* const CLASS_NAMES[PRIORITY_CLASS_COUNT] = {"normal", "realtime", "latency", "batch", "idle"};
+
+PriorityClass priority_class_from_string(const std::string& name)
+{
+    for (int i = 0; i < PRIORITY_CLASS_COUNT; ++i) {
+        if (name == CLASS_NAMES[i]) return static_cast<PriorityClass>(i);
+    }
+    return PRIO_NORMAL;
+}
+
+const char* priority_class_name(PriorityClass cls)
+{
+    return cls < PRIORITY_CLASS_COUNT ? CLASS_NAMES[cls] : CLASS_NAMES[PRIO_NORMAL];
+}
+
+SchedulingParams scheduling_params_for(PriorityClass cls)
+{
+    SchedulingParams params;
+    switch (cls) {
+    case PRIO_REALTIME:
+        // Low FIFO priority so kernel threads and watchdogs still preempt it.
+        // Children the job forks drop back to SCHED_OTHER.
+        params.policy = SCHED_FIFO | SCHED_RESET_ON_FORK;
+        params.rtPriority = 10;
+        break;
+    case PRIO_LATENCY:
+        params.nice = -5;
+        params.cgroupWeight = 500;
+        break;
+    case PRIO_BATCH:
+        params.policy = SCHED_BATCH;
+        params.nice = 10;
+        params.cgroupWeight = 25;
+        break;
+    case PRIO_IDLE:
+        params.policy = SCHED_IDLE;
+        params.nice = 19;
+        params.cgroupWeight = 1;
+        break;
+    case PRIO_NORMAL:
+    default:
+        params.cgroupWeight = 100; // Kernel default
+        break;
+    }
+    return params;
+}
@@ -0,0 +1,233 @@
+#include "ProcScanner.h"
+
+#include <fcntl.h>       // For open(), openat()
+#include <unistd.h>      // For pread(), lseek(), close()
+#include <sys/syscall.h> // For SYS_getdents64
+#include <errno.h>
+#include <cstring>       // For memrchr()
+#include <cstdint>
+
+namespace {
+
+// Layout returned by getdents64 (not exported by every libc)
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+const size_t PROC_DIR_BUFFER = 64 * 1024;
+const size_t PROC_STAT_BUFFER = 4096;
+
+// Parses a decimal number, advancing 'p'. Handles a leading '-'.
+long long parse_number(const char*& p, const char* end)
+{
+    bool negative = false;
+    if (p < end && *p == '-') { negative = true; ++p; }
+    long long value = 0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+    return negative ? -value : value;
+}
+
+// Writes "<pid>/stat" into 'path' without allocating
+void format_stat_path(pid_t pid, char* path)
+{
+    char digits[16];
+    int n = 0;
+    unsigned value = static_cast<unsigned>(pid);
+    do { digits[n++] = static_cast<char>('0' + value % 10); value /= 10; } while (value);
+    while (n) *path++ = digits[--n];
+    memcpy(path, "/stat", 6);
+}
+
+} // namespace
+
+bool read_proc_stat(pid_t pid, ProcStatFields& out)
+{
+    char path[32] = "/proc/";
+    format_stat_path(pid, path + 6);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+
+    char buf[PROC_STAT_BUFFER];
+    ssize_t len = read(fd, buf, sizeof(buf));
+    close(fd);
+    return len > 0 && parse_proc_stat(buf, static_cast<size_t>(len), out);
+}
+
+bool parse_proc_stat(const char* buf, size_t len, ProcStatFields& out)
+{
+    const char* close = static_cast<const char*>(memrchr(buf, ')', len));
+    if (!close) return false;
+
+    const char* p = close + 1;
+    const char* end = buf + len;
+
+    // Field 3 (state) is the first token after the command name
+    while (p < end && *p == ' ') ++p;
+    if (p >= end) return false;
+    out.state = *p++;
+
+    int field = 4;
+    while (p < end && field <= 39) {
+        while (p < end && *p == ' ') ++p;
+        if (p >= end || *p == '\n') break;
+
+        long long value = parse_number(p, end);
+        switch (field) {
+        case 10: out.minorFaults = value; break;
+        case 12: out.majorFaults = value; break;
+        case 14: out.utime = value; break;
+        case 15: out.stime = value; break;
+        case 20: out.numThreads = value; break;
+        case 22: out.startTime = value; break;
+        case 23: out.vsize = value; break;
+        case 24: out.rssPages = value; break;
+        case 39: out.processor = static_cast<int>(value); break;
+        default: break;
+        }
+        // Skip anything unexpected up to the next separator
+        while (p < end && *p != ' ' && *p != '\n') ++p;
+        ++field;
+    }
+
+    return field > 39;
+}
+
+ProcScanner::ProcScanner(const char* procRoot, size_t maxCachedFds)
+    : procFd(open(procRoot, O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      maxFds(maxCachedFds), dirBuffer(PROC_DIR_BUFFER), statBuffer(PROC_STAT_BUFFER)
+{}
+
+ProcScanner::~ProcScanner()
+{
+    for (auto& pair : cache) {
+        if (pair.second.fd != -1) close(pair.second.fd);
+    }
+    if (procFd != -1) close(procFd);
+}
+
+void ProcScanner::dropEntry(pid_t pid)
+{
+    auto it = cache.find(pid);
+    if (it == cache.end()) return;
+    if (it->second.fd != -1) {
+        close(it->second.fd);
+        openFds--;
+    }
+    cache.erase(it);
+}
+
+bool ProcScanner::readStat(pid_t pid, CachedStat& entry, ProcStatFields& fields)
+{
+    int fd = entry.fd;
+    bool temporary = false;
+    if (fd == -1) {
+        char path[32];
+        format_stat_path(pid, path);
+        fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return false;
+
+        if (openFds < maxFds) {
+            entry.fd = fd;
+            openFds++;
+        } else {
+            temporary = true;
+        }
+    }
+
+    // A cached fd keeps referring to the original task, so a dead (or reused)
+    // pid shows up as a read error here rather than as someone else's data.
+    ssize_t len = pread(fd, statBuffer.data(), statBuffer.size(), 0);
+    if (temporary) close(fd);
+    if (len <= 0) return false;
+
+    fields = ProcStatFields();
+    return parse_proc_stat(statBuffer.data(), static_cast<size_t>(len), fields);
+}
+
+bool ProcScanner::read(pid_t pid, ProcStatFields& fields)
+{
+    if (procFd == -1) return false;
+
+    CachedStat& entry = cache[pid];
+    if (readStat(pid, entry, fields)) return true;
+    dropEntry(pid);
+    return false;
+}
+
+bool ProcScanner::scanAll(Result& out)
+{
+    out.clear();
+    if (procFd == -1) return false;
+
+    generation++;
+    if (lseek(procFd, 0, SEEK_SET) == -1) return false;
+
+    while (true) {
+        long n = syscall(SYS_getdents64, procFd, dirBuffer.data(), dirBuffer.size());
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) break;
+
+        for (long offset = 0; offset < n; ) {
+            const linux_dirent64* ent = reinterpret_cast<const linux_dirent64*>(dirBuffer.data() + offset);
+            offset += ent->d_reclen;
+
+            // Only all-digit names are pids
+            const char* name = ent->d_name;
+            if (*name < '0' || *name > '9') continue;
+            pid_t pid = 0;
+            while (*name >= '0' && *name <= '9') pid = pid * 10 + (*name++ - '0');
+            if (*name != '\0') continue;
+
+            CachedStat& entry = cache[pid];
+            entry.generation = generation;
+
+            ProcStatFields fields;
+            if (readStat(pid, entry, fields)) {
+                out.emplace_back(pid, fields);
+            } else {
+                dropEntry(pid); // Exited between getdents64 and the read
+            }
+        }
+    }
+
+    // Close the stat files of pids that are gone
+    dropStale();
+    return true;
+}
+
+void ProcScanner::dropStale()
+{
+    stale.clear();
+    for (const auto& pair : cache) {
+        if (pair.second.generation != generation) stale.push_back(pair.first);
+    }
+    for (pid_t pid : stale) dropEntry(pid);
+}
+
+bool ProcScanner::scanPids(const std::vector<pid_t>& pids, Result& out)
+{
+    out.clear();
+    if (procFd == -1) return false;
+
+    generation++;
+    ProcStatFields fields;
+    for (pid_t pid : pids) {
+        CachedStat& entry = cache[pid];
+        entry.generation = generation;
+        if (readStat(pid, entry, fields)) {
+            out.emplace_back(pid, fields);
+        } else {
+            dropEntry(pid);
+        }
+    }
+
+    dropStale();
+    return true;
+}
@@ -1,21 +1,70 @@
 #include "ProcessManager.h"
-#include <iostream>
 #include <sstream>
 #include <chrono>
 
 // OS-specific headers for implementation details
-#include <unistd.h>      // For fork() and execv()
+#include <unistd.h>      // For close(), read(), write(), usleep()
 #include <sys/wait.h>    // For waitpid()
 #include <cstring>       // For strdup(), strerror(), strsignal()
+#include <cstdlib>       // For strtoull()
+#include <cmath>         // For std::isfinite()
 #include <algorithm>     // For std::vector manipulation
 #include <errno.h>       // For errno
+#include <sched.h>       // For sched_setaffinity(), CPU_SET
+#include <sys/epoll.h>   // For epoll_create1(), epoll_ctl(), epoll_wait()
+#include <sys/eventfd.h> // For eventfd()
+#include <sys/syscall.h> // For SYS_pidfd_open
+#include <linux/mempolicy.h> // For MPOL_BIND
+#include "Launcher.h"
+#include "Logger.h"
 
 #include "MessageQueue.h"
 #include "Config.h"
 #include "MqMessage.h"
 
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+// CLOCK_MONOTONIC in nanoseconds, the time base used by JobStats
+static uint64_t monotonic_now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Terminates and reaps a child nothing tracks: SIGTERM, then SIGKILL after TERMINATE_GRACE_MS
+static void reap_untracked(pid_t pid)
+{
+    kill(pid, SIG_TERMINATE);
+    uint64_t deadline = monotonic_now_ns() + static_cast<uint64_t>(TERMINATE_GRACE_MS) * 1000000;
+    while (monotonic_now_ns() < deadline) {
+        if (waitpid(pid, nullptr, WNOHANG) != 0) return; // Reaped, or no longer our child
+        usleep(UNTRACKED_REAP_POLL_MS * 1000);
+    }
+    kill(pid, SIGKILL);
+    while (waitpid(pid, nullptr, 0) == -1 && errno == EINTR) {
+    }
+}
+
 ProcessManager::ProcessManager(MessageQueue* mq) : queue(mq) 
-    {}
+{
+    spareTasks.reserve(SPARE_TASKS_MAX);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd == -1 || wakeFd == -1) {
+        CCM_ERROR << "[ERROR] Failed to set up monitor epoll: " << strerror(errno);
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0; // pid 0 is never tracked, so it identifies the wake eventfd
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+}
 
 // Helper to convert std::vector<std::string> to char* const* required by execv
 char** ProcessManager::createArgv(const std::string& path, const std::vector<std::string>& args) 
@@ -44,270 +93,1605 @@ void ProcessManager::freeArgv(char** argv) {
     delete[] argv;
 }
 
-void ProcessManager::startProgram(const Command& cmd) {
+// Translates the placement fields of a StartJob for the allocator
+static PlacementRequest placement_request_for(const Command& cmd)
+{
+    PlacementRequest placement;
+    placement.weight = cmd.cpuWeight;
+    placement.policy = placement_policy_from_string(cmd.placement);
+    placement.numaNode = cmd.numaNode;
+    placement.coreCount = cmd.coreCount;
+    placement.cpuList = cmd.cpuList;
+    placement.priorityClass = priority_class_from_string(cmd.priorityClass);
+    return placement;
+}
+
+void ProcessManager::publishJob(const std::string& id, TrackedProcess& proc) {
+    if (!statusTable.isOpen()) return;
+    if (proc.tableSlot == -1) {
+        proc.tableSlot = statusTable.claim();
+        if (proc.tableSlot == -1) return; // Table full: the job is only visible to "status"
+    }
+
+    JobTableEntry entry{};
+    size_t idLen = std::min(id.size(), JOB_TABLE_ID_SIZE - 1);
+    memcpy(entry.id, id.data(), idLen);
+    entry.pid = proc.pid;
+    entry.state = proc.state;
+    entry.priorityClass = proc.priorityClass;
+    entry.flags = JOB_ENTRY_IN_USE;
+    if (!proc.cgroup.empty()) entry.flags |= JOB_ENTRY_CGROUP;
+    if (proc.migratable) entry.flags |= JOB_ENTRY_MIGRATABLE;
+    entry.numaNode = static_cast<int8_t>(proc.numaNode);
+    entry.exitCode = proc.exitCode;
+    entry.termSignal = proc.termSignal;
+    entry.migrations = proc.migrations;
+    entry.startTime = proc.startTime;
+    entry.queuedAtNs = proc.queuedAtNs;
+    entry.updatedAtNs = monotonic_now_ns();
+    for (int cpu : proc.cpuMask.cpus()) {
+        if (cpu < static_cast<int>(JOB_TABLE_CPU_WORDS * 64)) entry.cpus[cpu / 64] |= 1ull << (cpu % 64);
+    }
+
+    const JobStats& st = proc.stats;
+    entry.numThreads = st.numThreads;
+    entry.cpuTimeNs = st.cpuTimeNs;
+    entry.runDelayNs = st.runDelayNs;
+    entry.rssBytes = st.rssBytes;
+    entry.readBytes = st.readBytes;
+    entry.writeBytes = st.writeBytes;
+    entry.voluntaryCtxSwitches = st.voluntaryCtxSwitches;
+    entry.involuntaryCtxSwitches = st.involuntaryCtxSwitches;
+    entry.sampledAtNs = st.sampledAtNs;
+    entry.cgroupCpuUsageUsec = st.cgroup.cpuUsageUsec;
+    entry.cgroupThrottledUsec = st.cgroup.throttledUsec;
+    entry.cgroupMemoryBytes = st.cgroup.memoryCurrent;
+    entry.cpuPercent = st.cpuPercent;
+    entry.waitPercent = st.waitPercent;
+    statusTable.publish(proc.tableSlot, entry);
+}
+
+CommandResult ProcessManager::startProgram(const Command& cmd, CpuMask* reservation) {
+    CommandResult result;
+    result.jobId = cmd.id;
+    result.action = cmd.action;
+
     if (cmd.programPath.empty()) 
     {
-        std::cerr << "[ERROR] 'programPath' missing for START command ID " << cmd.id << std::endl;
-        return;
+        CCM_ERROR << "[ERROR] 'programPath' missing for START command ID " << cmd.id;
+        result.fail("ProgramPath missing");
+        return result;
+    }
+    if (!cmd.cpuList.empty() && !reservation && !coreAllocator.anyUsable(cmd.cpuList))
+    {
+        // Would otherwise run unpinned, or wait in the admission queue for cores that never appear
+        CCM_ERROR << "[ERROR] CpuList of START command ID " << cmd.id << " names no usable CPU";
+        result.fail("CpuList names no usable CPU");
+        return result;
     }
 
-    std::lock_guard<std::mutex> lock(trackerMutex);
-    if (runningProcesses.count(cmd.id)) 
+    ShardedProcessTracker::Shard& shard = runningProcesses.shardOf(cmd.id);
     {
-        std::cout << "[INFO] Process ID " << cmd.id << " is already running." << std::endl;
-        return;
+        TimedLockGuard lock(shard.mutex);
+        TrackedProcess* existing = shard.jobs.find(cmd.id);
+        if (reservation) {
+            // Released from the admission queue: the "queued" entry is ours
+            if (!existing || existing->state != JOB_QUEUED) {
+                coreAllocator.release(*reservation, cmd.cpuWeight, false,
+                                      priority_class_from_string(cmd.priorityClass));
+                result.fail("Job was cancelled while queued");
+                return result;
+            }
+            existing->state = JOB_STARTING;
+            publishJob(cmd.id, *existing);
+        } else {
+            if (existing) 
+            {
+                CCM_INFO << "[INFO] Process ID " << cmd.id << " is already running.";
+                result.fail("Job id already in use");
+                return result;
+            }
+
+            // Claim the id while the spawn runs without the lock
+            TrackedProcess placeholder;
+            placeholder.state = JOB_STARTING;
+            placeholder.path = cmd.programPath;
+            publishJob(cmd.id, runningProcesses.insert(shard, cmd.id, std::move(placeholder)));
+        }
+    }
+
+    // Reserve the cores before spawning so concurrent launches see this job in the ledger
+    PlacementRequest placement = placement_request_for(cmd);
+    CpuMask cpuMask;
+    if (reservation) {
+        cpuMask = std::move(*reservation);
+    } else {
+        std::lock_guard<std::mutex> admissionLock(admissionMutex);
+        // Without admission limits only batch/idle jobs wait: for a core that runs no realtime job,
+        // rather than being launched unpinned next to one
+        bool canWait = coreAllocator.limits().enabled() ||
+                       (placement.cpuList.empty() && is_background_class(placement.priorityClass) &&
+                        coreAllocator.topology().cpuCount() > 0);
+        // Queued jobs of the same or higher priority go first
+        bool mustWait = canWait && pendingJobs.ahead(cmd);
+        if (!mustWait) {
+            StageTimer timer(STAGE_PLACEMENT);
+            cpuMask = coreAllocator.admit(placement);
+        }
+
+        if (canWait && (mustWait || cpuMask.empty())) {
+            uint64_t now = monotonic_now_ns();
+            {
+                // Marked before it becomes visible to admitPending()
+                TimedLockGuard lock(shard.mutex);
+                if (TrackedProcess* proc = shard.jobs.find(cmd.id)) {
+                    proc->state = JOB_QUEUED;
+                    proc->queuedAtNs = now;
+                    publishJob(cmd.id, *proc);
+                }
+            }
+            pendingJobs.push(cmd, now);
+            Metrics::instance().count(COUNTER_JOBS_QUEUED);
+            CCM_INFO << "[ADMISSION] Queued job ID " << cmd.id << " (priority " << cmd.priority << "), "
+                     << pendingJobs.size() << " waiting.";
+            result.status = "queued";
+            result.waitMs = 0;
+            return result;
+        }
+    }
+
+    // NUMA placement also binds the job's memory to the node of its cores. Cores from several
+    // nodes (no single node had room) keep the default policy rather than bind to one of them.
+    int numaNode = -1;
+    if (placement.policy == PLACE_NUMA && !cpuMask.empty()) {
+        const CpuTopology& topo = coreAllocator.topology();
+        std::vector<int> cpus = cpuMask.cpus();
+        numaNode = topo.nodeOf(cpus.front());
+        for (int cpu : cpus) {
+            if (topo.nodeOf(cpu) != numaNode) {
+                numaNode = -1;
+                break;
+            }
+        }
+    }
+    unsigned long nodeMask[NUMA_NODEMASK_WORDS] = {};
+    if (numaNode >= 0 && numaNode < NUMA_NODEMASK_WORDS * NUMA_BITS_PER_WORD) {
+        nodeMask[numaNode / NUMA_BITS_PER_WORD] |= 1UL << (numaNode % NUMA_BITS_PER_WORD);
+    } else {
+        numaNode = -1;
+    }
+
+    // The job's own cgroup pins it with cpuset.cpus and lets pause and terminate reach every process it forks
+    JobCgroup cgroup;
+    int procsFd = -1;
+    if (cgroups.available()) {
+        CgroupLimits limits;
+        limits.cpuMax = cmd.cpuMax;
+        limits.memoryMax = cmd.memoryMax;
+        if (cgroups.create(cmd.id, placement.priorityClass, cpuMask, limits, cgroup)) procsFd = cgroups.openProcs(cgroup);
+    } else if (cmd.cpuMax > 0.0 || cmd.memoryMax > 0) {
+        CCM_WARN << "[WARN] CpuMax/MemoryMax for ID " << cmd.id << " ignored: cgroups are not enabled.";
     }
 
     char** argv = createArgv(cmd.programPath, cmd.args);
-    pid_t pid = fork();
+    LaunchRequest req;
+    req.path = cmd.programPath.c_str();
+    req.argv = argv;
+    if (!cpuMask.empty()) {
+        req.cpuMask = cpuMask.data();
+        req.cpuMaskSize = cpuMask.byteSize();
+    }
+    if (numaNode != -1) {
+        req.memPolicyMode = MPOL_BIND;
+        req.nodeMask = nodeMask;
+        req.maxNode = sizeof(nodeMask) * 8 + 1;
+    }
+    SchedulingParams sched = scheduling_params_for(placement.priorityClass);
+    req.schedPolicy = sched.policy;
+    req.schedPriority = sched.rtPriority;
+    req.nice = sched.nice;
+    req.cgroupProcsFd = procsFd;
 
-    if (pid == -1) 
+    LaunchResult launched;
     {
-        std::cerr << "[ERROR] Failed to fork process for ID " << cmd.id << std::endl;
-        freeArgv(argv);
-        return;
-    } 
-    else if (pid == 0) 
+        StageTimer timer(STAGE_SPAWN);
+        if (!zygotes.launch(req, cpuMask, launched)) launched = launch_process(req);
+    }
+    freeArgv(argv); // Child has exec'd or failed, the arguments are no longer shared
+    if (procsFd != -1) close(procsFd);
+
+    if (launched.pid == -1) 
     {
-         std::cout << "[DEBUG] In child process before execv for ID " << cmd.id << std::endl;
-        // Child process: Execute the new program
-        if (execv(cmd.programPath.c_str(), argv) == -1)
-        {
-            perror("execv failed"); 
-            freeArgv(argv);
-            _exit(EXIT_FAILURE); // Use _exit to skip cleanup, especially flush buffers
-        }
-    } 
-    else 
+        CCM_ERROR << "[ERROR] Failed to launch '" << cmd.programPath << "' for ID " << cmd.id
+                  << ": " << strerror(launched.error);
+        coreAllocator.release(cpuMask, cmd.cpuWeight, false, placement.priorityClass);
+        cgroups.remove(cgroup);
+        TimedLockGuard lock(shard.mutex);
+        if (TrackedProcess* proc = shard.jobs.find(cmd.id)) statusTable.release(proc->tableSlot);
+        runningProcesses.erase(shard, cmd.id);
+        Metrics::instance().count(COUNTER_START_FAILURES);
+        result.fail(std::string("Launch failed: ") + strerror(launched.error));
+        return result;
+    }
+    if (launched.affinityError != 0) {
+        // Not fatal: the program still runs, just without the pinning
+        CCM_WARN << "[WARN] Failed to set affinity to cores " << cpuMask.toString() << " for ID " << cmd.id
+                 << ": " << strerror(launched.affinityError);
+    }
+    if (launched.memPolicyError != 0) {
+        CCM_WARN << "[WARN] Failed to bind memory to NUMA node " << numaNode << " for ID " << cmd.id
+                 << ": " << strerror(launched.memPolicyError);
+        numaNode = -1;
+    }
+    if (launched.schedError != 0) {
+        // Usually EPERM: SCHED_FIFO and negative nice values need CAP_SYS_NICE
+        CCM_WARN << "[WARN] Failed to apply priority class '" << priority_class_name(placement.priorityClass)
+                 << "' for ID " << cmd.id << ": " << strerror(launched.schedError);
+    }
+    if (launched.cgroupError != 0) {
+        // Still pinned by sched_setaffinity; pause and terminate fall back to signals
+        CCM_WARN << "[WARN] Failed to join cgroup " << cgroup.path << " for ID " << cmd.id
+                 << ": " << strerror(launched.cgroupError);
+        cgroups.remove(cgroup);
+        cgroup = JobCgroup();
+    }
+    coreAllocator.activate(cpuMask);
+    // Recorded so a restarted manager can tell this process from a later one with the same pid
+    ProcStatFields launchedStat;
+    uint64_t procStartTicks = read_proc_stat(launched.pid, launchedStat) ? launchedStat.startTime : 0;
+
+    bool dropped;
     {
-        // Parent process: Track the new process
-        freeArgv(argv); // Free arguments in the parent process memory
+        TimedLockGuard lock(shard.mutex);
+        TrackedProcess* proc = shard.jobs.find(cmd.id);
+        dropped = proc == nullptr;
+        if (proc) {
+            runningProcesses.assignPid(shard, cmd.id, launched.pid);
+            proc->state = JOB_RUNNING;
+            proc->cpuMask = cpuMask;
+            proc->migratable = cmd.cpuList.empty();
+            proc->cpuWeight = cmd.cpuWeight;
+            proc->numaNode = numaNode;
+            proc->priorityClass = placement.priorityClass;
+            proc->cgroup = cgroup;
+            proc->pidfd = launched.pidfd;
+            proc->procStartTicks = procStartTicks;
+            proc->startTime = std::chrono::time_point_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now()).time_since_epoch().count();
+            watchProcess(*proc);
+            journal.recordStart(cmd.id, *proc);
+            publishJob(cmd.id, *proc);
+            result.status = job_state_name(proc->state);
+        }
+    }
+    if (dropped) {
+        // Dropped by cleanup while the spawn was in flight. Nothing watches the child, so it is
+        // reaped here, outside the shard lock since that can take up to TERMINATE_GRACE_MS.
+        if (launched.pidfd != -1) close(launched.pidfd);
+        if (!cgroup.empty()) cgroups.kill(cgroup);
+        reap_untracked(launched.pid);
+        if (!cgroup.empty()) cgroups.remove(cgroup);
+        coreAllocator.release(cpuMask, cmd.cpuWeight, true, placement.priorityClass);
+        result.fail("Job removed while starting");
+        return result;
+    }
 
-        TrackedProcess newProc;
-        newProc.pid = pid;
-        newProc.status = "running";
-        newProc.path = cmd.programPath;
-        newProc.startTime = std::chrono::time_point_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now()).time_since_epoch().count();
+    CCM_INFO << "[SUCCESS] Started program '" << cmd.programPath << "'.\n"
+             << "          -> Assigned ID: " << cmd.id << ", OS PID: " << launched.pid
+             << ", Cores: " << cpuMask.toString();
 
-        runningProcesses[cmd.id] = newProc;
+    Metrics::instance().count(COUNTER_JOBS_STARTED);
+    result.pid = launched.pid;
+    result.cores = cpuMask.toString();
+    return result;
+}
 
-        std::cout << "[SUCCESS] Started program '" << cmd.programPath << "'.\n";
-        std::cout << "          -> Assigned ID: " << cmd.id << ", OS PID: " << pid << std::endl;
+bool ProcessManager::cancelQueued(const std::string& id, CommandResult& result) {
+    {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shardOf(id);
+        TimedLockGuard lock(shard.mutex);
+        TrackedProcess* proc = shard.jobs.find(id);
+        if (!proc || proc->state != JOB_QUEUED) return false;
+        proc->state = JOB_TERMINATED;
+        publishJob(id, *proc);
+        statusTable.release(proc->tableSlot);
+        runningProcesses.erase(shard, id);
     }
+
+    // If admitPending() popped it meanwhile, startProgram() finds the entry gone and backs out
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    pendingJobs.remove(id);
+    CCM_INFO << "[ADMISSION] Cancelled queued job ID " << id << ".";
+    result.status = "terminated";
+    return true;
 }
 
-void ProcessManager::controlProcess(const std::string& processId, int signalVal, const std::string& newStatus) {
-    std::lock_guard<std::mutex> lock(trackerMutex);
+CommandResult ProcessManager::controlProcess(const std::string& processId, int signalVal, JobState newState) {
+    CommandResult result;
+    result.jobId = processId;
+    if (newState == JOB_TERMINATED && cancelQueued(processId, result)) return result;
 
-    if (!runningProcesses.count(processId)) {
-        std::cerr << "[ERROR] Process ID " << processId << " not found in tracker." << std::endl;
-        return;
+    ShardedProcessTracker::Shard& shard = runningProcesses.shardOf(processId);
+    TimedLockGuard lock(shard.mutex);
+
+    TrackedProcess* found = shard.jobs.find(processId);
+    if (!found) {
+        CCM_ERROR << "[ERROR] Process ID " << processId << " not found in tracker.";
+        result.fail("Job not found");
+        return result;
     }
 
-    TrackedProcess& proc = runningProcesses.at(processId);
+    TrackedProcess& proc = *found;
     pid_t pid = proc.pid;
+    result.pid = pid;
+    result.cores = proc.cpuMask.toString();
+    if (pid <= 0) {
+        // Never signal pid 0: that would hit the manager's whole process group
+        CCM_INFO << "[INFO] Process ID " << processId << " is still " << job_state_name(proc.state) << ".";
+        result.status = job_state_name(proc.state);
+        result.fail(std::string("Job is still ") + job_state_name(proc.state));
+        return result;
+    }
 
     // Fast check if process has already finished (WNOHANG ensures non-blocking check)
     int status;
-    if (waitpid(pid, &status, WNOHANG) != 0 && (WIFEXITED(status) || WIFSIGNALED(status))) {
-        std::cout << "[INFO] Process " << processId << " (PID " << pid << ") already exited. Updating status." << std::endl;
-        proc.status = "finished";
-        return;
+    if (waitpid(pid, &status, WNOHANG) == pid && (WIFEXITED(status) || WIFSIGNALED(status))) {
+        CCM_INFO << "[INFO] Process " << processId << " (PID " << pid << ") already exited. Updating status.";
+        handleExit(shard, pid, status);
+        result.status = "finished";
+        result.fail("Job already exited");
+        return result;
     }
     
-    // Send the signal
-    if (kill(pid, signalVal) == -1) {
-        std::cerr << "[ERROR] Failed to send signal (" << strsignal(signalVal) 
-                  << ") to PID " << pid << ": " << strerror(errno) << std::endl;
+    // Pause and resume freeze the job's cgroup when it has one, so processes it forked stop too
+    bool terminate = (newState == JOB_TERMINATED);
+    bool froze = !terminate && !proc.cgroup.empty() && cgroups.freeze(proc.cgroup, signalVal == SIG_PAUSE) == 0;
+    if (!froze && kill(pid, signalVal) == -1) {
+        CCM_ERROR << "[ERROR] Failed to send signal (" << strsignal(signalVal) 
+                  << ") to PID " << pid << ": " << strerror(errno);
+        result.status = job_state_name(proc.state);
+        result.fail(std::string("Signal failed: ") + strerror(errno));
     } 
+    else if (froze) {
+        proc.state = newState;
+        journal.record(signalVal == SIG_PAUSE ? JOURNAL_PAUSE : JOURNAL_RESUME, processId);
+        result.status = job_state_name(proc.state);
+        CCM_INFO << "[SUCCESS] " << (signalVal == SIG_PAUSE ? "Froze" : "Thawed") << " cgroup " << proc.cgroup.path
+                 << " of process ID " << processId << " (PID " << pid << ").\n"
+                 << "          -> New Status: " << job_state_name(proc.state);
+    }
     else 
     {
-        proc.status = newStatus;
-        std::cout << "[SUCCESS] Sent " << strsignal(signalVal) << " to process ID " 
-                  << processId << " (PID " << pid << ").\n";
-        std::cout << "          -> New Status: " << newStatus << std::endl;
-        
-        if (newStatus == "terminated") 
-        {
-            // Use a blocking wait to ensure the zombie is reaped immediately after termination signal
-            waitpid(pid, nullptr, 0); 
-            runningProcesses.erase(processId);
-            std::cout << "[SUCCESS] Process ID " << processId << " reaped and removed from tracker." << std::endl;
+        if (terminate) {
+            // A stopped process only acts on SIGTERM once it runs again
+            if (proc.state == JOB_PAUSED) {
+                if (!proc.cgroup.empty()) cgroups.freeze(proc.cgroup, false);
+                kill(pid, SIG_RESUME);
+            }
+            // The reaper removes the job when it exits; escalate if it ignores the signal
+            if (proc.state != JOB_TERMINATING) scheduleKill(processId, pid);
+            proc.state = JOB_TERMINATING;
+            journal.record(JOURNAL_TERMINATE, processId);
+        } else {
+            proc.state = newState;
+            journal.record(signalVal == SIG_PAUSE ? JOURNAL_PAUSE : JOURNAL_RESUME, processId);
         }
+        result.status = job_state_name(proc.state);
+        CCM_INFO << "[SUCCESS] Sent " << strsignal(signalVal) << " to process ID " 
+                 << processId << " (PID " << pid << ").\n"
+                 << "          -> New Status: " << job_state_name(proc.state);
+    }
+    publishJob(processId, proc);
+    return result;
+}
+
+void ProcessManager::snapshotJobs(const std::string& commandId, JobSnapshot& out) {
+    out.clear();
+    if (!commandId.empty()) {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shardOf(commandId);
+        TimedLockGuard lock(shard.mutex);
+        if (const TrackedProcess* proc = shard.jobs.find(commandId)) out.emplace_back(commandId, *proc);
+        return;
+    }
+    // One shard at a time: the report is not an atomic cut, but never stalls launches
+    for (size_t i = 0; i < runningProcesses.shardCount(); ++i) {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shard(i);
+        TimedLockGuard lock(shard.mutex);
+        for (const auto& pair : shard.jobs) out.emplace_back(pair.first, pair.second);
     }
 }
 
 void ProcessManager::printStatus(const std::string& commandId) {
-    std::lock_guard<std::mutex> lock(trackerMutex);
-    std::cout << "\n" << std::string(50, '-') << std::endl;
+    if (!Logger::instance().enabled(LEVEL_INFO)) return;
 
-    if (runningProcesses.empty() && commandId.empty()) {
-        std::cout << "No processes currently being tracked." << std::endl;
-        std::cout << std::string(50, '-') << std::endl;
+    // Console output happens on a copy, without holding any tracker lock
+    JobSnapshot jobs;
+    snapshotJobs(commandId, jobs);
+    const std::string rule(50, '-');
+
+    if (jobs.empty() && commandId.empty()) {
+        CCM_INFO << "\n" << rule << "\nNo processes currently being tracked.\n" << rule;
         return;
     }
 
-    std::cout << "--- Process Status Report (Total: " << runningProcesses.size() << ") ---" << std::endl;
+    size_t queued;
+    uint64_t monoNow = monotonic_now_ns();
+    uint64_t oldestWaitNs;
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        queued = pendingJobs.size();
+        oldestWaitNs = pendingJobs.oldestWaitNs(monoNow);
+    }
+    {
+        LogLine header(LEVEL_INFO);
+        header << "\n" << rule << "\n--- Process Status Report (Total: " << runningProcesses.size() << ") ---";
+        if (queued != 0) {
+            header << "\nAdmission queue: " << queued << " job(s), longest wait " << oldestWaitNs / 1000000 << "ms";
+        }
+    }
     
-    std::vector<std::string> keys;
-    if (commandId.empty()) {
-        for (const auto& pair : runningProcesses) keys.push_back(pair.first);
-    } else {
-        if (runningProcesses.count(commandId)) keys.push_back(commandId);
-        else {
-            std::cout << "Process ID " << commandId << " not found." << std::endl;
-            std::cout << std::string(50, '-') << std::endl;
+    long long now = std::chrono::time_point_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now()).time_since_epoch().count();
+    // One record per job, so a long report never exceeds LOG_LINE_MAX
+    auto printOne = [now, monoNow](const std::string& c_id, const TrackedProcess& p_info) {
+        long long runningTime = now - p_info.startTime;
+
+        LogLine line(LEVEL_INFO);
+        line << "\n[ID: " << c_id << "] (PID: " << p_info.pid << ") - Status: " 
+             << job_state_name(p_info.state) << "\n";
+        if (p_info.state == JOB_QUEUED) {
+            line << "  > Path: " << p_info.path << " | Waiting for: "
+                 << (monoNow - p_info.queuedAtNs) / 1000000 << "ms";
             return;
         }
+        line << "  > Path: " << p_info.path << " | Cores: " << p_info.cpuMask.toString();
+        if (p_info.numaNode != -1) line << " | NUMA node: " << p_info.numaNode;
+        if (p_info.priorityClass != PRIO_NORMAL) line << " | Class: " << priority_class_name(p_info.priorityClass);
+        if (p_info.migrations != 0) line << " | Migrations: " << p_info.migrations;
+        line << " | Running for: " << runningTime << "s";
+
+        const JobStats& st = p_info.stats;
+        if (st.sampledAtNs != 0) {
+            line << "\n  > CPU: " << st.cpuTimeNs / 1000000 << "ms (" << st.cpuPercent << "%)"
+                 << " | Run-queue wait: " << st.runDelayNs / 1000000 << "ms (" << st.waitPercent << "%)"
+                 << " | RSS: " << st.rssBytes / 1024 << "KiB"
+                 << " | Threads: " << st.numThreads << "\n";
+            line << "  > I/O: " << st.readBytes << "B read, " << st.writeBytes << "B written"
+                 << " | Ctx switches: " << st.voluntaryCtxSwitches << " voluntary, "
+                 << st.involuntaryCtxSwitches << " involuntary";
+        }
+        if (!p_info.cgroup.empty()) {
+            const CgroupUsage& cg = st.cgroup;
+            line << "\n  > Cgroup: " << p_info.cgroup.path << " | CPU: " << cg.cpuUsageUsec / 1000 << "ms"
+                 << " | Throttled: " << cg.throttledUsec / 1000 << "ms (" << cg.nrThrottled << "x)";
+            if (cg.memoryCurrent != 0) line << " | Memory: " << cg.memoryCurrent / 1024 << "KiB";
+        }
+    };
+
+    if (jobs.empty()) {
+        CCM_INFO << "Process ID " << commandId << " not found.\n" << rule;
+        return;
     }
-    
-    for (const auto& c_id : keys) {
-        const TrackedProcess& p_info = runningProcesses.at(c_id);
-        long long runningTime = std::chrono::time_point_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now()).time_since_epoch().count() - p_info.startTime;
+    for (const auto& pair : jobs) printOne(pair.first, pair.second);
+
+    CCM_INFO << rule;
+}
 
-        std::cout << "\n[ID: " << c_id << "] (PID: " << p_info.pid << ") - Status: " 
-                  << p_info.status << "\n";
-        std::cout << "  > Path: " << p_info.path << " | Running for: " << runningTime << "s" << std::endl;
+void ProcessManager::reportStatus(const std::string& commandId, std::vector<CommandResult>& results)
+{
+    JobSnapshot jobs;
+    snapshotJobs(commandId, jobs);
+    if (jobs.empty() && !commandId.empty()) {
+        results.emplace_back();
+        results.back().jobId = commandId;
+        results.back().action = "status";
+        results.back().fail("Job not found");
+        return;
     }
 
-    std::cout << std::string(50, '-') << std::endl;
+    for (const auto& pair : jobs) {
+        results.emplace_back();
+        CommandResult& r = results.back();
+        r.jobId = pair.first;
+        r.action = "status";
+        r.pid = pair.second.pid;
+        r.cores = pair.second.cpuMask.toString();
+        r.status = job_state_name(pair.second.state);
+        if (pair.second.state == JOB_QUEUED) {
+            r.waitMs = static_cast<long long>((monotonic_now_ns() - pair.second.queuedAtNs) / 1000000);
+        }
+    }
 }
 
-void ProcessManager::processCommands() 
+// A weight is a share of one core: anything else would corrupt the reservation ledger.
+// Returns the reason a weight is refused, or an empty string.
+static std::string check_cpu_weight(double weight)
+{
+    if (std::isfinite(weight) && weight > 0.0 && weight <= 1.0) return "";
+    std::ostringstream reason;
+    reason << "CpuWeight " << weight << " is not in (0, 1]";
+    return reason.str();
+}
+
+// A job needs at least one core and cannot get more than the machine has.
+// Returns the reason a core count is refused, or an empty string.
+static std::string check_core_count(int count, int cpuCount)
+{
+    if (count >= 1 && count <= cpuCount) return "";
+    return "CoreCount " + std::to_string(count) + " is not in [1, " + std::to_string(cpuCount) + "]";
+}
+
+// A NumaNode must name a node with CPUs, and a NUMA job must fit on it since it never leaves it.
+// Returns the reason the node is refused, or an empty string.
+static std::string check_numa_node(const Command& cmd, const CpuTopology& topo)
+{
+    if (cmd.numaNode == -1) return "";
+    size_t nodeCpus = topo.cpusOfNode(cmd.numaNode).size();
+    if (nodeCpus == 0) return "NumaNode " + std::to_string(cmd.numaNode) + " does not exist";
+    if (cmd.cpuList.empty() && placement_policy_from_string(cmd.placement) == PLACE_NUMA &&
+        static_cast<size_t>(cmd.coreCount) > nodeCpus) {
+        return "CoreCount " + std::to_string(cmd.coreCount) + " exceeds the " + std::to_string(nodeCpus) +
+               " CPUs of NumaNode " + std::to_string(cmd.numaNode);
+    }
+    return "";
+}
+
+// Builds a Command from the parameters of a single job description
+static Command decodeCommand(const std::string& action, const nlohmann::json& params, const CoreAllocator& allocator)
 {
     Command cmd;
- //   usleep (2000000); // Sleep for 2 seconds to allow setup
+    cmd.action = action;
+    cmd.id = params.value("JobId", "");
+    cmd.processId = params.value("ProcessId", "");
+    cmd.programPath = params.value("ProgramPath", "");
+    cmd.args = params.value("Args", std::vector<std::string>{});
+    cmd.cpuWeight = params.value("CpuWeight", 1.0);
+    std::string weightError = check_cpu_weight(cmd.cpuWeight);
+    if (!weightError.empty()) throw std::invalid_argument(weightError);
+    cmd.placement = params.value("Placement", "");
+    cmd.numaNode = params.value("NumaNode", -1);
+    cmd.coreCount = params.value("CoreCount", 1);
+    std::string coreCountError = check_core_count(cmd.coreCount, allocator.cpuCount());
+    if (!coreCountError.empty()) throw std::invalid_argument(coreCountError);
+    cmd.priority = params.value("Priority", 0);
+    cmd.priorityClass = params.value("PriorityClass", "");
+    cmd.cpuMax = params.value("CpuMax", 0.0);
+    cmd.memoryMax = params.value("MemoryMax", static_cast<uint64_t>(0));
+    cmd.replyQueue = params.value("ReplyQueue", "");
+    cmd.correlationId = params.value("CorrelationId", "");
+    // "CpuList" is either an array of ids or a kernel-style list such as "0-3,8"
+    auto cpuList = params.find("CpuList");
+    if (cpuList != params.end()) {
+        if (!cpuList->is_string()) {
+            cmd.cpuList = cpuList->get<std::vector<int>>();
+        } else {
+            const std::string& list = cpuList->get_ref<const std::string&>();
+            // Ids past CPU_LIST_MAX_CPUS are dropped, so "99999" parses to nothing: also an error
+            if (!parse_cpu_list(list, cmd.cpuList) ||
+                (cmd.cpuList.empty() && list.find_first_not_of(" ,") != std::string::npos)) {
+                throw std::invalid_argument("CpuList '" + list + "' is not a cpu list");
+            }
+        }
+    }
+    std::string numaError = check_numa_node(cmd, allocator.topology());
+    if (!numaError.empty()) throw std::invalid_argument(numaError);
+    return cmd;
+}
+
+void ProcessManager::dispatchCommand(CommandTask& task, std::vector<CommandResult>& results)
+{
+    Command& cmd = task.cmd;
+    const std::string& target = cmd.id.empty() ? cmd.processId : cmd.id;
+
+    if (cmd.action == "StartJob") 
+    {
+        results.push_back(startProgram(cmd, task.admitted ? &task.reservation : nullptr));
+    } 
+    else if (cmd.action == "pause") {
+        results.push_back(controlProcess(target, SIG_PAUSE, JOB_PAUSED));
+    } else if (cmd.action == "resume") {
+        results.push_back(controlProcess(target, SIG_RESUME, JOB_RUNNING));
+    } else if (cmd.action == "terminate") {
+        results.push_back(controlProcess(target, SIG_TERMINATE, JOB_TERMINATED));
+    } else if (cmd.action == "status") {
+        printStatus(target);
+        if (!cmd.replyQueue.empty()) reportStatus(target, results);
+        return;
+    } else {
+        CCM_ERROR << "[ERROR] Unknown action '" << cmd.action << "' for ID " << cmd.id;
+        results.emplace_back();
+        results.back().jobId = cmd.id;
+        results.back().fail("Unknown action '" + cmd.action + "'");
+    }
+    results.back().action = cmd.action;
+}
+
+void ProcessManager::routeTask(CommandTask&& task)
+{
+    Command& cmd = task.cmd;
+    if (cmd.action == "StartJob" && cmd.id.empty()) {
+        // Jobs started without an id get one the client learns from the reply
+        cmd.id = "job-" + std::to_string(nextJobId++);
+    }
+    const std::string& target = cmd.id.empty() ? cmd.processId : cmd.id;
+    routedTasks.emplace_back(workerFor(target), std::move(task));
+}
+
+void ProcessManager::submitRouted(const std::string& replyQueue, const std::string& correlationId)
+{
+    if (routedTasks.empty()) return;
+
+    // The group must be complete before any worker can finish its part of it
+    std::shared_ptr<ReplyGroup> group;
+    if (!replyQueue.empty()) {
+        group = std::make_shared<ReplyGroup>();
+        group->replyQueue = replyQueue;
+        group->correlationId = correlationId;
+        group->slots.resize(routedTasks.size());
+        group->remaining = routedTasks.size();
+    }
+
+    for (size_t i = 0; i < routedTasks.size(); ++i) {
+        CommandTask& task = routedTasks[i].second;
+        task.group = group;
+        task.slot = i;
+        if (group) {
+            // Kept with the command so a job that has to queue can reply again once it starts
+            task.cmd.replyQueue = replyQueue;
+            task.cmd.correlationId = correlationId;
+        }
+        enqueueTask(routedTasks[i].first, std::move(task));
+    }
+    routedTasks.clear();
+}
+
+size_t ProcessManager::workerFor(const std::string& jobId) const
+{
+    return std::hash<std::string>{}(jobId) % workers.size();
+}
+
+void ProcessManager::enqueueTask(size_t workerIndex, CommandTask&& task)
+{
+    CommandWorker& worker = *workers[workerIndex];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        task.enqueuedNs = metrics_now_ns();
+        worker.tasks.push_back(std::move(task));
+    }
+    worker.cv.notify_one();
+}
 
+void ProcessManager::admitPending()
+{
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    if (workers.empty()) return;
+
+    uint64_t now = monotonic_now_ns();
+    while (!pendingJobs.empty()) {
+        CpuMask mask;
+        {
+            StageTimer timer(STAGE_PLACEMENT);
+            mask = coreAllocator.admit(placement_request_for(pendingJobs.front().cmd));
+        }
+        if (mask.empty()) break; // Still no room for the head of the queue
+
+        PendingJob job = pendingJobs.popFront();
+        Metrics::instance().record(STAGE_ADMISSION_WAIT, now - job.enqueuedNs);
+        CCM_INFO << "[ADMISSION] Admitting job ID " << job.cmd.id << " after "
+                 << (now - job.enqueuedNs) / 1000000 << "ms on cores " << mask.toString() << ".";
+
+        CommandTask task;
+        task.admitted = true;
+        task.reservation = std::move(mask);
+        if (!job.cmd.replyQueue.empty()) {
+            // Second reply for the same correlation id, now with the pid and cores
+            task.group = std::make_shared<ReplyGroup>();
+            task.group->replyQueue = job.cmd.replyQueue;
+            task.group->correlationId = job.cmd.correlationId;
+            task.group->slots.resize(1);
+            task.group->remaining = 1;
+        }
+        size_t worker = workerFor(job.cmd.id);
+        task.cmd = std::move(job.cmd);
+        enqueueTask(worker, std::move(task));
+    }
+}
+
+void ProcessManager::handleMessage(const std::string& raw)
+{
+    StageTimer timer(STAGE_DECODE);
+    Metrics::instance().count(COUNTER_MESSAGES);
+    if (is_binary_message(raw.data(), raw.size())) {
+        handleBinaryMessage(raw);
+        return;
+    }
+
+    MQMessage msg;
+    try {
+        msg = MQMessage::deserialize(raw);
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Dropping malformed message: " << e.what();
+        return;
+    }
+    CCM_DEBUG << "\n-- Received Message --\nCommand: " << msg.command;
+
+    std::string replyQueue, correlationId;
+    try {
+        replyQueue = msg.parameters.value("ReplyQueue", "");
+        correlationId = msg.parameters.value("CorrelationId", "");
+    } catch (const std::exception& e) {
+        // Non-string reply fields: there is nowhere to reply to. The command itself is still
+        // decoded below; a single command fails there too, a StartJobs batch runs unanswered.
+        CCM_ERROR << "[ERROR] Malformed ReplyQueue/CorrelationId in '" << msg.command
+                  << "' message, no reply will be sent: " << e.what();
+        replyQueue.clear();
+        correlationId.clear();
+    }
+
+    if (msg.command == "StartJobs") 
+    {
+        // Batch launch: one message carries N job descriptions and gets one combined reply
+        auto jobs = msg.parameters.find("Jobs");
+        if (jobs == msg.parameters.end() || !jobs->is_array()) {
+            CCM_ERROR << "[ERROR] 'Jobs' array missing for StartJobs command";
+            CommandTask task;
+            task.cmd.action = msg.command;
+            task.error = "'Jobs' array missing";
+            routeTask(std::move(task));
+            submitRouted(replyQueue, correlationId);
+            return;
+        }
+        for (size_t index = 0; index < jobs->size(); ++index) {
+            const nlohmann::json& job = (*jobs)[index];
+            CommandTask task;
+            if (!job.is_object()) {
+                // Answered like any other failed entry so results still line up with the batch
+                CCM_ERROR << "[ERROR] Invalid job entry at index " << index << " in StartJobs";
+                task.cmd.action = "StartJob";
+                task.error = "Invalid job entry at index " + std::to_string(index);
+                routeTask(std::move(task));
+                continue;
+            }
+            try {
+                task.cmd = decodeCommand("StartJob", job, coreAllocator);
+            } catch (const std::exception& e) {
+                CCM_ERROR << "[ERROR] Invalid job in StartJobs: " << e.what();
+                task.cmd.action = "StartJob";
+                task.error = std::string("Invalid parameters: ") + e.what();
+            }
+            routeTask(std::move(task));
+        }
+        submitRouted(replyQueue, correlationId);
+        return;
+    }
+
+    CommandTask task;
+    try {
+        task.cmd = decodeCommand(msg.command, msg.parameters, coreAllocator);
+    } catch (const std::exception& e) {
+        CCM_ERROR << "[ERROR] Invalid parameters for command '" << msg.command << "': " << e.what();
+        task.cmd.action = msg.command;
+        task.error = std::string("Invalid parameters: ") + e.what();
+    }
+    routeTask(std::move(task));
+    submitRouted(replyQueue, correlationId);
+}
+
+void ProcessManager::handleBinaryMessage(const std::string& raw)
+{
+    // Frames are decoded in place; each one becomes a command of its own.
+    // Consecutive frames with the same reply queue and correlation id share one reply.
+    const char* p = raw.data();
+    size_t left = raw.size();
+    CommandView view;
+    std::string replyQueue, correlationId;
+    while (left > 0) {
+        size_t consumed = 0;
+        if (!decode_command(p, left, view, consumed)) {
+            CCM_ERROR << "[ERROR] Dropping malformed binary frame (" << left << " bytes left)";
+            break;
+        }
+        if (view.replyQueue != replyQueue || view.correlationId != correlationId) {
+            submitRouted(replyQueue, correlationId);
+            replyQueue.assign(view.replyQueue.data(), view.replyQueue.size());
+            correlationId.assign(view.correlationId.data(), view.correlationId.size());
+        }
+
+        // A finished task's Command keeps its string and vector capacity for to_command()
+        CommandTask task = takeSpareTask();
+        if (view.action == ACTION_UNKNOWN) {
+            CCM_ERROR << "[ERROR] Unknown action in binary frame";
+            task.cmd = Command();
+            task.cmd.id.assign(view.id.data(), view.id.size());
+            task.error = "Unknown action";
+        } else {
+            to_command(view, task.cmd);
+            std::string paramError = check_cpu_weight(task.cmd.cpuWeight);
+            if (paramError.empty()) paramError = check_core_count(task.cmd.coreCount, coreAllocator.cpuCount());
+            if (paramError.empty()) paramError = check_numa_node(task.cmd, coreAllocator.topology());
+            if (!paramError.empty()) {
+                CCM_ERROR << "[ERROR] Invalid binary frame for ID " << task.cmd.id << ": " << paramError;
+                task.error = "Invalid parameters: " + paramError;
+            }
+        }
+        routeTask(std::move(task));
+
+        p += consumed;
+        left -= consumed;
+    }
+    submitRouted(replyQueue, correlationId);
+}
+
+void ProcessManager::receiveMessages()
+{
     while (running) 
     {
         std::string raw = queue->receive();
-        MQMessage msg = MQMessage::deserialize(raw);
-        std::cout << "\n-- Received Message --\n";
-        std::cout << "Command: " << msg.command << "\n";    
-        // Here you would convert msg to Command struct
-        // For demonstration, let's assume msg.command is the action and msg.parameters contains other fields
-        cmd.action = msg.command;
-        cmd.programPath = msg.parameters.value("ProgramPath", "");
-        cmd.args = msg.parameters.value("Args", std::vector<std::string>{});
-      //  std::cout << "\n[PROCESSOR] Received command: ID=" << cmd.id << ", Action=" << cmd.action << std::endl;
-
-        if (cmd.action == "StartJob") 
+        if (!running) break; // Most likely the wake-up posted by stop()
         {
-         startProgram(cmd);
-        } 
-        else if (cmd.action == "pause") {
-            controlProcess(cmd.id, SIG_PAUSE, "paused");
-        } else if (cmd.action == "resume") {
-            controlProcess(cmd.id, SIG_RESUME, "running");
-        } else if (cmd.action == "terminate") {
-            controlProcess(cmd.id, SIG_TERMINATE, "terminated");
-        } else if (cmd.action == "status") {
-            printStatus(cmd.id.empty() ? cmd.processId : cmd.id);
-        } else {
-            std::cerr << "[ERROR] Unknown action '" << cmd.action << "' for ID " << cmd.id << std::endl;
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            pendingMessages.push_back(std::move(raw));
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(500)); 
+        pendingCv.notify_one();
+    }
+
+    CCM_INFO << "[WORKER] Receiver thread stopped.";
+}
+
+void ProcessManager::processCommands() 
+{
+    std::deque<std::string> batch;
+
+    while (running) 
+    {
+        {
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            pendingCv.wait(lock, [this] { return !pendingMessages.empty() || !running; });
+            // Take everything that is pending in one go so the receiver is never held up
+            batch.swap(pendingMessages);
+        }
+
+        // Decoding and routing only; the commands themselves run on the workers
+        for (const auto& raw : batch) {
+            handleMessage(raw);
+        }
+        batch.clear();
      }
      
-    std::cout << "[WORKER] Command Processor thread stopped." << std::endl;
+    CCM_INFO << "[WORKER] Command Processor thread stopped.";
+}
+
+CommandTask ProcessManager::takeSpareTask()
+{
+    std::lock_guard<std::mutex> lock(spareTasksMutex);
+    if (spareTasks.empty()) return CommandTask();
+    CommandTask task = std::move(spareTasks.back());
+    spareTasks.pop_back();
+    return task;
+}
+
+void ProcessManager::recycleTask(CommandTask&& task)
+{
+    // Only the Command's buffers are worth keeping; every other field starts over
+    task.error.clear();
+    task.group.reset();
+    task.admitted = false;
+    task.reservation = CpuMask();
+    task.slot = 0;
+    std::lock_guard<std::mutex> lock(spareTasksMutex);
+    if (spareTasks.size() < SPARE_TASKS_MAX) spareTasks.push_back(std::move(task));
+}
+
+void ProcessManager::runCommandWorker(size_t index)
+{
+    CommandWorker& worker = *workers[index];
+    std::vector<CommandResult> results;
+
+    while (true) 
+    {
+        CommandTask task;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [this, &worker] { return !worker.tasks.empty() || !running; });
+            if (!running) break;
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        Metrics::instance().record(STAGE_DISPATCH_WAIT, metrics_now_ns() - task.enqueuedNs);
+        Metrics::instance().count(COUNTER_COMMANDS);
+
+        results.clear();
+        if (task.error.empty()) {
+            dispatchCommand(task, results);
+        } else {
+            results.emplace_back();
+            results.back().jobId = task.cmd.id;
+            results.back().action = task.cmd.action;
+            results.back().fail(task.error);
+        }
+        if (task.group) {
+            ReplyGroup& group = *task.group;
+            group.slots[task.slot].swap(results);
+            if (group.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                // Last command of the message: send the combined reply in message order
+                std::vector<CommandResult> combined;
+                for (auto& slot : group.slots) {
+                    for (auto& r : slot) combined.push_back(std::move(r));
+                }
+                if (!replies.send(group.replyQueue, group.correlationId, combined)) {
+                    Metrics::instance().count(COUNTER_REPLIES_DROPPED);
+                }
+            }
+        }
+        recycleTask(std::move(task));
+    }
+
+    CCM_INFO << "[WORKER] Command worker " << index << " stopped.";
+}
+
+void ProcessManager::scheduleKill(const std::string& id, pid_t pid)
+{
+    uint64_t deadline = monotonic_now_ns() + static_cast<uint64_t>(TERMINATE_GRACE_MS) * 1000000ull;
+    {
+        std::lock_guard<std::mutex> lock(killMutex);
+        killDeadlines.emplace(deadline, std::make_pair(id, pid));
+    }
+    wakeMonitor(); // So it can shorten its epoll timeout
+}
+
+int ProcessManager::nextKillTimeoutMs()
+{
+    std::lock_guard<std::mutex> lock(killMutex);
+    if (killDeadlines.empty()) return -1;
+
+    uint64_t now = monotonic_now_ns();
+    uint64_t deadline = killDeadlines.begin()->first;
+    if (deadline <= now) return 0;
+    return static_cast<int>((deadline - now + 999999) / 1000000);
+}
+
+void ProcessManager::escalateTerminations()
+{
+    std::vector<std::pair<std::string, pid_t>> due;
+    {
+        std::lock_guard<std::mutex> lock(killMutex);
+        uint64_t now = monotonic_now_ns();
+        while (!killDeadlines.empty() && killDeadlines.begin()->first <= now) {
+            due.push_back(std::move(killDeadlines.begin()->second));
+            killDeadlines.erase(killDeadlines.begin());
+        }
+    }
+    if (due.empty()) return;
+
+    for (const auto& job : due) {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shardOf(job.first);
+        TimedLockGuard lock(shard.mutex);
+        // A tracked pid is never reused: it stays a zombie until the reaper removes the entry
+        const TrackedProcess* proc = shard.jobs.find(job.first);
+        if (!proc || proc->pid != job.second || proc->state != JOB_TERMINATING) continue;
+
+        // cgroup.kill also reaches the processes the job forked
+        bool groupKilled = !proc->cgroup.empty() && cgroups.kill(proc->cgroup) == 0;
+        CCM_WARN << "[WARN] Process ID " << job.first << " (PID " << job.second << ") ignored "
+                 << strsignal(SIG_TERMINATE) << " for " << TERMINATE_GRACE_MS << "ms, "
+                 << (groupKilled ? "killing cgroup " + proc->cgroup.path : std::string("sending SIGKILL")) << ".";
+        if (!groupKilled) kill(job.second, SIGKILL);
+        Metrics::instance().count(COUNTER_KILLS_ESCALATED);
+    }
+}
+
+void ProcessManager::watchProcess(TrackedProcess& proc) {
+    if (epollFd == -1) return;
+
+    if (proc.pidfd != -1 && !pidfdSupported) {
+        // From launch_process(); without waitid(P_PIDFD) it cannot be reaped through
+        close(proc.pidfd);
+        proc.pidfd = -1;
+    }
+    if (proc.pidfd == -1 && pidfdSupported) {
+        proc.pidfd = static_cast<int>(syscall(SYS_pidfd_open, proc.pid, 0));
+        if (proc.pidfd == -1 && errno == ENOSYS) {
+            // Old kernel: the monitor falls back to a periodic waitpid sweep
+            pidfdSupported = false;
+            CCM_WARN << "[MONITOR] pidfd_open not supported, falling back to polling.";
+        }
+    }
+    if (proc.pidfd == -1) {
+        unwatchedProcesses++;
+        wakeMonitor(); // It may be blocked in epoll_wait without a timeout
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = static_cast<uint64_t>(proc.pid);
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, proc.pidfd, &ev) == -1) {
+        CCM_ERROR << "[MONITOR ERROR] epoll_ctl failed for PID " << proc.pid << ": " << strerror(errno);
+        close(proc.pidfd);
+        proc.pidfd = -1;
+        unwatchedProcesses++;
+        wakeMonitor();
+    }
+}
+
+void ProcessManager::handleExit(ShardedProcessTracker::Shard& shard, pid_t pid, int status) {
+    ProcessTracker::Entry* entry = shard.jobs.findByPid(pid);
+    if (!entry) return; // Not one of ours (or already removed)
+
+    const std::string id = entry->first;
+    TrackedProcess& proc = entry->second;
+    if (WIFEXITED(status)) 
+    {
+        proc.exitCode = WEXITSTATUS(status);
+        proc.state = JOB_FINISHED;
+        CCM_INFO << "\n[MONITOR] Child process ID " << id << " (PID " << pid << ") finished.\n"
+                 << "          Exit Code: " << proc.exitCode;
+    } 
+    else if (WIFSIGNALED(status)) {
+        proc.termSignal = WTERMSIG(status);
+        proc.state = JOB_TERMINATED;
+        CCM_INFO << "\n[MONITOR] Child process ID " << id << " (PID " << pid << ") finished.\n"
+                 << "          Terminated by Signal: " << proc.termSignal << " (" << strsignal(proc.termSignal) << ")";
+    }
+    // Processes the job left behind in its cgroup end with it
+    if (!proc.cgroup.empty()) cgroups.kill(proc.cgroup);
+    publishJob(id, proc); // The slot keeps the exit code until it is reused
+    Metrics::instance().count(COUNTER_JOBS_EXITED);
+
+    removeProcess(shard, id); // Remove finished process
+}
+
+void ProcessManager::removeProcess(ShardedProcessTracker::Shard& shard, const std::string& id) {
+    TrackedProcess* proc = shard.jobs.find(id);
+    if (!proc) return;
+
+    if (proc->pidfd != -1) {
+        // close() alone is not enough: a launch in flight on another worker holds a copy
+        // of the fd until its exec, and the stale (ready) registration would spin the monitor
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, proc->pidfd, nullptr);
+        close(proc->pidfd);
+    } else if (proc->pid > 0) {
+        unwatchedProcesses--;
+    }
+    if (!proc->cpuMask.empty()) {
+        coreAllocator.release(proc->cpuMask, proc->cpuWeight, true, proc->priorityClass);
+        capacityFreed = true;
+    }
+    cgroups.remove(proc->cgroup);
+    if (proc->pid > 0) journal.record(JOURNAL_EXIT, id);
+    statusTable.release(proc->tableSlot);
+    runningProcesses.erase(shard, id);
+}
+
+void ProcessManager::reapProcess(pid_t pid) {
+    ShardedProcessTracker::Shard* shard = runningProcesses.shardOfPid(pid);
+    if (!shard) return;
+    TimedLockGuard lock(shard->mutex);
+    ProcessTracker::Entry* entry = shard->jobs.findByPid(pid);
+    if (!entry || entry->second.pidfd == -1) return;
+
+    siginfo_t info{};
+    if (waitid(static_cast<idtype_t>(P_PIDFD), static_cast<id_t>(entry->second.pidfd), &info, WEXITED | WNOHANG) == -1) {
+        if (errno == ECHILD) {
+            // Adopted from the journal (not our child), or already collected elsewhere
+            CCM_INFO << "\n[MONITOR] Process ID " << entry->first << " (PID " << pid << ") is gone, exit status unknown.";
+            if (!entry->second.cgroup.empty()) cgroups.kill(entry->second.cgroup);
+            removeProcess(*shard, entry->first);
+        } else if (errno == EINVAL) {
+            // Linux 5.3 has pidfd_open() but not waitid(P_PIDFD): hand the process to the sweep
+            if (pidfdSupported.exchange(false)) {
+                CCM_WARN << "[MONITOR] waitid(P_PIDFD) not supported, falling back to polling.";
+            }
+            TrackedProcess& proc = entry->second;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, proc.pidfd, nullptr);
+            close(proc.pidfd);
+            proc.pidfd = -1;
+            unwatchedProcesses++; // The monitor sweeps in this same pass
+        } else {
+            CCM_ERROR << "[MONITOR ERROR] waitid failed for PID " << pid << ": " << strerror(errno);
+        }
+        return;
+    }
+    if (info.si_pid == 0) return; // Spurious wakeup, still running
+
+    // Rebuild the wait status so handleExit() can decode it with the W* macros
+    int status = (info.si_code == CLD_EXITED) ? (info.si_status & 0xff) << 8 : info.si_status;
+    handleExit(*shard, pid, status);
+}
+
+void ProcessManager::reapUnwatched() {
+    // Degraded path for processes without a pidfd: poll each one individually so
+    // children that are still being launched are never reaped behind our back.
+    std::vector<std::pair<pid_t, int>> exited;
+    std::vector<std::string> gone;
+    for (size_t i = 0; i < runningProcesses.shardCount(); ++i) {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shard(i);
+        TimedLockGuard lock(shard.mutex);
+        exited.clear();
+        gone.clear();
+        for (const auto& pair : shard.jobs) {
+            const TrackedProcess& proc = pair.second;
+            if (proc.pidfd != -1 || proc.pid <= 0) continue;
+
+            int status;
+            pid_t r = waitpid(proc.pid, &status, WNOHANG);
+            if (r == proc.pid && (WIFEXITED(status) || WIFSIGNALED(status))) {
+                exited.emplace_back(proc.pid, status);
+            } else if (r == -1 && errno == ECHILD && kill(proc.pid, 0) == -1) {
+                // Adopted from the journal: not our child, so all we learn is that it is gone
+                gone.push_back(pair.first);
+            }
+        }
+        for (const auto& e : exited) {
+            handleExit(shard, e.first, e.second);
+        }
+        for (const auto& id : gone) {
+            if (const TrackedProcess* proc = shard.jobs.find(id)) {
+                CCM_INFO << "\n[MONITOR] Adopted process ID " << id << " (PID " << proc->pid << ") is gone, exit status unknown.";
+                if (!proc->cgroup.empty()) cgroups.kill(proc->cgroup);
+            }
+            removeProcess(shard, id);
+        }
+    }
 }
 
 void ProcessManager::monitorProcesses() {
+    epoll_event events[MONITOR_MAX_EVENTS];
+
     while (running) {
-        int status;
-        // WNOHANG: returns immediately if no child has exited
-        pid_t pid = waitpid(-1, &status, WNOHANG); 
+        int timeout = unwatchedProcesses > 0 ? MONITOR_FALLBACK_SWEEP_MS : -1;
+        int killTimeout = nextKillTimeoutMs();
+        if (killTimeout >= 0 && (timeout < 0 || killTimeout < timeout)) timeout = killTimeout;
+        int n = epoll_wait(epollFd, events, MONITOR_MAX_EVENTS, timeout);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            CCM_ERROR << "[MONITOR ERROR] epoll_wait failed: " << strerror(errno);
+            break;
+        }
+
+        // Every ready pidfd is reaped in this pass, so a burst of exits needs one wakeup
+        uint64_t wokeNs = metrics_now_ns();
+        for (int i = 0; i < n; ++i) {
+            pid_t pid = static_cast<pid_t>(events[i].data.u64);
+            if (pid == 0) {
+                uint64_t value;
+                while (read(wakeFd, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            reapProcess(pid);
+            Metrics::instance().record(STAGE_REAP, metrics_now_ns() - wokeNs);
+        }
+
+        if (unwatchedProcesses > 0) reapUnwatched();
+        escalateTerminations();
+        // Reaped jobs free their cores for whatever is waiting
+        if (capacityFreed.exchange(false)) admitPending();
+    }
+    CCM_INFO << "[MONITOR] Process Monitor thread stopped.";
+}
 
-        if (pid > 0) 
+void ProcessManager::sampleJobStats() {
+    statsBatch.clear();
+    statsShardEnds.clear();
+    statsCgroups.clear();
+    for (size_t i = 0; i < runningProcesses.shardCount(); ++i) {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shard(i);
         {
-            // A child process has exited
-            std::lock_guard<std::mutex> lock(trackerMutex);
-            for (auto it = runningProcesses.begin(); it != runningProcesses.end(); ) {
-                if (it->second.pid == pid) 
-                {
-                    std::cout << "\n[MONITOR] Child process ID " << it->first << " (PID " << pid << ") finished.\n";
-                    
-                    if (WIFEXITED(status)) 
-                    {
-                        std::cout << "          Exit Code: " << WEXITSTATUS(status) << std::endl;
-                    } 
-                    else if (WIFSIGNALED(status)) {
-                         std::cout << "          Terminated by Signal: " << WTERMSIG(status) << " (" << strsignal(WTERMSIG(status)) << ")" << std::endl;
-                    }
-                    
-                    it = runningProcesses.erase(it); // Remove finished process
-                } 
-                else 
-                {
-                    ++it;
-                }
+            TimedLockGuard lock(shard.mutex);
+            for (const auto& pair : shard.jobs) {
+                if (pair.second.pid <= 0) continue;
+                statsBatch.emplace_back(pair.second.pid, pair.second.stats);
+                statsCgroups.push_back(pair.second.cgroup);
             }
-        } 
-        else if (pid == -1 && errno != ECHILD) 
+        }
+        statsShardEnds.push_back(statsBatch.size());
+    }
+    if (statsBatch.empty()) return;
+
+    statsReader.sample(statsBatch);
+    for (size_t j = 0; j < statsBatch.size(); ++j) {
+        // A group removed in the meantime just fails to open
+        if (!statsCgroups[j].empty()) cgroups.readUsage(statsCgroups[j], statsBatch[j].second.cgroup);
+    }
+
+    // Write back shard by shard; the batch is grouped in shard order
+    size_t begin = 0;
+    for (size_t i = 0; i < statsShardEnds.size(); ++i) {
+        size_t end = statsShardEnds[i];
+        if (begin == end) continue;
+        ShardedProcessTracker::Shard& shard = runningProcesses.shard(i);
+        TimedLockGuard lock(shard.mutex);
+        for (size_t j = begin; j < end; ++j) {
+            // The job may have been reaped while we were reading
+            if (ProcessTracker::Entry* entry = shard.jobs.findByPid(statsBatch[j].first)) {
+                entry->second.stats = statsBatch[j].second;
+                publishJob(entry->first, entry->second);
+            }
+        }
+        begin = end;
+    }
+}
+
+void ProcessManager::rebalanceJobs() {
+    std::vector<double> load;
+    if (!loadSampler.snapshot(load)) return;
+
+    uint64_t now = monotonic_now_ns();
+    const uint64_t cooldownNs = static_cast<uint64_t>(REBALANCE_COOLDOWN_MS) * 1000000ull;
+
+    auto eligible = [&](const TrackedProcess& proc) {
+        if (!proc.migratable || proc.pid <= 0 || proc.state != JOB_RUNNING) return false;
+        if (proc.cpuMask.count() != 1) return false; // Multi-core sets are left where they are
+        if (proc.lastMigratedNs != 0 && now - proc.lastMigratedNs < cooldownNs) return false;
+
+        size_t core = static_cast<size_t>(proc.cpuMask.cpus().front());
+        if (core >= load.size() || load[core] < REBALANCE_HOT_LOAD_PCT) return false;
+        return proc.stats.waitPercent >= REBALANCE_MIN_WAIT_PCT;
+    };
+
+    // Collect candidates one shard at a time: (wait %, job id)
+    std::vector<std::pair<float, std::string>> candidates;
+    for (size_t i = 0; i < runningProcesses.shardCount(); ++i) {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shard(i);
+        TimedLockGuard lock(shard.mutex);
+        for (const auto& pair : shard.jobs) {
+            if (eligible(pair.second)) candidates.emplace_back(pair.second.stats.waitPercent, pair.first);
+        }
+    }
+
+    // Most starved first
+    std::sort(candidates.begin(), candidates.end(), [](const std::pair<float, std::string>& a, const std::pair<float, std::string>& b) {
+        return a.first > b.first;
+    });
+
+    int moved = 0;
+    for (const auto& candidate : candidates) {
+        if (moved >= REBALANCE_MAX_MIGRATIONS) break;
+
+        // The ledger update and the tracker update must not be separated, otherwise
+        // the reaper could release the old mask after the allocator moved it.
+        ShardedProcessTracker::Shard& shard = runningProcesses.shardOf(candidate.second);
+        TimedLockGuard lock(shard.mutex);
+        TrackedProcess* found = shard.jobs.find(candidate.second);
+        if (!found || !eligible(*found)) continue; // Changed since it was picked
+
+        TrackedProcess& proc = *found;
+        int from = proc.cpuMask.cpus().front();
+        // A NUMA-bound job only moves within its node, where its memory is
+        CpuMask target = coreAllocator.migrate(proc.cpuMask, proc.cpuWeight, load[from] - REBALANCE_HYSTERESIS_PCT,
+                                               proc.priorityClass, proc.numaNode);
+        if (target.empty()) continue; // Nothing cool enough
+
+        // cpuset.cpus moves every thread and child in the group at once
+        int error = proc.cgroup.pinned ? cgroups.setCpus(proc.cgroup, target)
+                                       : set_process_affinity(proc.pid, target.data(), target.byteSize());
+        if (error != 0) {
+            coreAllocator.transfer(target, proc.cpuMask, proc.cpuWeight, proc.priorityClass);
+            CCM_WARN << "[REBALANCE] Failed to move process ID " << candidate.second << " (PID " << proc.pid
+                     << "): " << strerror(error);
+            continue;
+        }
+
+        int to = target.cpus().front();
+        CCM_INFO << "[REBALANCE] Moved process ID " << candidate.second << " (PID " << proc.pid << ")"
+                 << " from core " << from << " (" << load[from] << "% load)"
+                 << " to core " << to << " (" << (static_cast<size_t>(to) < load.size() ? load[to] : 0.0) << "% load)"
+                 << ", run-queue wait " << proc.stats.waitPercent << "%";
+
+        proc.cpuMask = std::move(target);
+        journal.recordMove(candidate.second, proc.cpuMask);
+        publishJob(candidate.second, proc);
+        proc.lastMigratedNs = now;
+        proc.migrations++;
+        Metrics::instance().count(COUNTER_MIGRATIONS);
+        moved++;
+    }
+}
+
+void ProcessManager::compactJournal() {
+    // Events racing with the snapshot land after 'mark' and are kept on top of it
+    size_t mark = journal.mark();
+    JobSnapshot jobs;
+    snapshotJobs("", jobs);
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const JobSnapshot::value_type& job) {
+        return job.second.pid <= 0; // Queued or starting: journaled once launched
+    }), jobs.end());
+
+    size_t before = journal.bytesUsed();
+    if (journal.compact(jobs, mark)) {
+        CCM_INFO << "[JOURNAL] Compacted " << before << " bytes to " << journal.bytesUsed()
+                 << " (" << jobs.size() << " live jobs).";
+    }
+}
+
+void ProcessManager::collectJobStats() {
+    uint64_t lastRebalance = monotonic_now_ns();
+    const uint64_t rebalanceNs = static_cast<uint64_t>(REBALANCE_INTERVAL_MS) * 1000000ull;
+
+    while (running) {
         {
-            // An error occurred that wasn't "no more children"
-            std::cerr << "[MONITOR ERROR] waitpid failed: " << strerror(errno) << std::endl;
+            std::unique_lock<std::mutex> lock(stopMutex);
+            if (stopCv.wait_for(lock, std::chrono::milliseconds(JOB_STATS_INTERVAL_MS), [this] { return !running; })) {
+                break;
+            }
+        }
+        sampleJobStats();
+        cgroups.retryRemovals();
+        if (journal.wantsCompaction()) compactJournal();
+        // Load-based limits can clear without any job exiting
+        admitPending();
+
+        // Rebalance right after a sample so decisions use fresh wait figures
+        uint64_t now = monotonic_now_ns();
+        if (now - lastRebalance >= rebalanceNs) {
+            rebalanceJobs();
+            lastRebalance = now;
         }
-        
-        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
-    std::cout << "[MONITOR] Process Monitor thread stopped." << std::endl;
+    CCM_INFO << "[STATS] Job stats thread stopped.";
+}
+
+bool ProcessManager::openJournal(const std::string& path) {
+    auto begin = std::chrono::steady_clock::now();
+    JobJournal::JobList jobs;
+    if (!journal.open(path, jobs)) return false;
+
+    size_t adopted = 0, gone = 0;
+    for (auto& job : jobs) {
+        const std::string& id = job.first;
+        TrackedProcess& proc = job.second;
+        // Generated ids must not reuse one a client may still hold, even if that job is gone
+        if (id.compare(0, 4, "job-") == 0) {
+            uint64_t n = strtoull(id.c_str() + 4, nullptr, 10);
+            if (n >= nextJobId) nextJobId = n + 1;
+        }
+
+        // A different start time means the pid now belongs to another process
+        ProcStatFields stat;
+        if (proc.pid <= 0 || !read_proc_stat(proc.pid, stat) || stat.startTime != proc.procStartTicks || stat.state == 'Z') {
+            CCM_INFO << "[JOURNAL] Job ID " << id << " (PID " << proc.pid << ") ended while the manager was down.";
+            if (!proc.cgroup.empty()) cgroups.kill(proc.cgroup);
+            cgroups.remove(proc.cgroup);
+            gone++;
+            continue;
+        }
+
+        proc.pidfd = -1;
+        if (!proc.cpuMask.empty()) coreAllocator.adopt(proc.cpuMask, proc.cpuWeight, proc.priorityClass);
+        ShardedProcessTracker::Shard& shard = runningProcesses.shardOf(id);
+        {
+            TimedLockGuard lock(shard.mutex);
+            TrackedProcess& stored = runningProcesses.insert(shard, id, std::move(proc));
+            watchProcess(stored);
+            publishJob(id, stored);
+            // Its grace period restarts now
+            if (stored.state == JOB_TERMINATING) scheduleKill(id, stored.pid);
+        }
+
+        adopted++;
+    }
+    // Start from a journal that holds exactly the adopted jobs
+    compactJournal();
+
+    auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    CCM_INFO << "[JOURNAL] Recovered " << adopted << " job(s) (" << gone << " gone) from " << path
+             << " in " << elapsedUs / 1000.0 << " ms.";
+    return true;
 }
 
 void ProcessManager::start() {
     running = true;
+    if (!loadSampler.start()) {
+        CCM_WARN << "[MANAGER] Core load sampler unavailable, placing by reservations only.";
+    }
+    size_t workerCount = std::min<size_t>(std::max<size_t>(std::thread::hardware_concurrency(), COMMAND_WORKERS_MIN),
+                                          COMMAND_WORKERS_MAX);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<CommandWorker>());
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers[i]->thread = std::thread(&ProcessManager::runCommandWorker, this, i);
+    }
     commandProcessorThread = std::thread(&ProcessManager::processCommands, this);
+    receiverThread = std::thread(&ProcessManager::receiveMessages, this);
   //  commandProcessorThread.detach();
     monitorThread = std::thread(&ProcessManager::monitorProcesses, this);
-    std::cout << "[MANAGER] Process Manager started." << std::endl;
+    statsThread = std::thread(&ProcessManager::collectJobStats, this);
+    CCM_INFO << "[MANAGER] Process Manager started.";
 }
 
 void ProcessManager::cleanupProcesses() {
-    std::lock_guard<std::mutex> lock(trackerMutex);
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        while (!pendingJobs.empty()) pendingJobs.popFront();
+    }
     if (runningProcesses.empty()) return;
 
-    std::cout << "\n[CLEANUP] Terminating " << runningProcesses.size() << " remaining processes..." << std::endl;
-    
-    // Iterate over a copy of keys to avoid iterator invalidation
+    CCM_INFO << "\n[CLEANUP] Terminating " << runningProcesses.size() << " remaining processes...";
+
+    std::vector<pid_t> signalled;
+    std::vector<JobCgroup> groups;
     std::vector<std::string> ids_to_terminate;
-    for (const auto& pair : runningProcesses) {
-        ids_to_terminate.push_back(pair.first);
-    }
-
-    for (const auto& id : ids_to_terminate) {
-        if (runningProcesses.count(id)) {
-            pid_t pid = runningProcesses.at(id).pid;
-            std::cout << "[CLEANUP] Sending SIGTERM to process ID " << id << " (PID " << pid << ")." << std::endl;
-            if (kill(pid, SIG_TERMINATE) == 0) {
-                // We'll wait for the process to be reaped by the monitor thread
-                // or handle the wait here for immediate cleanup.
-                waitpid(pid, nullptr, 0); 
+    for (size_t i = 0; i < runningProcesses.shardCount(); ++i) {
+        ShardedProcessTracker::Shard& shard = runningProcesses.shard(i);
+        TimedLockGuard lock(shard.mutex);
+
+        // Iterate over a copy of keys to avoid iterator invalidation
+        ids_to_terminate.clear();
+        for (const auto& pair : shard.jobs) {
+            ids_to_terminate.push_back(pair.first);
+        }
+
+        for (const auto& id : ids_to_terminate) {
+            if (const TrackedProcess* proc = shard.jobs.find(id)) {
+                pid_t pid = proc->pid;
+                if (pid <= 0) {
+                    // Still starting: startProgram() terminates it once the spawn returns
+                    removeProcess(shard, id);
+                    continue;
+                }
+                CCM_INFO << "[CLEANUP] Sending SIGTERM to process ID " << id << " (PID " << pid << ").";
+                if (!proc->cgroup.empty()) {
+                    cgroups.freeze(proc->cgroup, false);
+                    groups.push_back(proc->cgroup);
+                }
+                if (kill(pid, SIG_TERMINATE) == 0) {
+                    kill(pid, SIG_RESUME); // Paused jobs must run to see the SIGTERM
+                    signalled.push_back(pid);
+                }
+                removeProcess(shard, id);
             }
         }
     }
-    
-    runningProcesses.clear(); // Clear the map after attempting cleanup
+
+    // Give every job the same grace period as "terminate", then force the rest
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TERMINATE_GRACE_MS);
+    while (!signalled.empty()) {
+        signalled.erase(std::remove_if(signalled.begin(), signalled.end(), [](pid_t pid) {
+            pid_t r = waitpid(pid, nullptr, WNOHANG);
+            // Jobs adopted from the journal are not our children
+            return r == -1 && errno == ECHILD ? kill(pid, 0) == -1 : r != 0;
+        }), signalled.end());
+        if (signalled.empty() || std::chrono::steady_clock::now() >= deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(MONITOR_FALLBACK_SWEEP_MS));
+    }
+    for (pid_t pid : signalled) {
+        CCM_WARN << "[CLEANUP] PID " << pid << " ignored SIGTERM, sending SIGKILL.";
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    // Whatever the jobs forked goes too; empty groups are removed now, the rest on the next start
+    for (const JobCgroup& group : groups) cgroups.kill(group);
+    cgroups.retryRemovals();
+}
+
+void ProcessManager::writeMetrics(std::string& out) {
+    // Gauges are read the same way status reporting reads them; no lock is held across sections
+    std::vector<CoreReservation> ledger = coreAllocator.ledger();
+    std::vector<double> load;
+    bool haveLoad = loadSampler.snapshot(load);
+    size_t admissionDepth, messageBacklog;
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        admissionDepth = pendingJobs.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        messageBacklog = pendingMessages.size();
+    }
+    std::vector<size_t> workerDepths;
+    for (auto& worker : workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        workerDepths.push_back(worker->tasks.size());
+    }
+
+    std::ostringstream gauges;
+    gauges << "# HELP ccm_tracked_jobs Jobs currently tracked (queued, starting or running).\n"
+           << "# TYPE ccm_tracked_jobs gauge\n"
+           << "ccm_tracked_jobs " << runningProcesses.size() << "\n";
+    gauges << "# HELP ccm_core_reservations Jobs reserved on each core by the allocator.\n"
+           << "# TYPE ccm_core_reservations gauge\n";
+    for (size_t core = 0; core < ledger.size(); ++core) {
+        gauges << "ccm_core_reservations{core=\"" << core << "\",state=\"pending\"} " << ledger[core].pending << "\n"
+               << "ccm_core_reservations{core=\"" << core << "\",state=\"active\"} " << ledger[core].active << "\n";
+    }
+    gauges << "# HELP ccm_core_committed_weight Sum of declared CPU weights reserved on each core.\n"
+           << "# TYPE ccm_core_committed_weight gauge\n";
+    for (size_t core = 0; core < ledger.size(); ++core) {
+        gauges << "ccm_core_committed_weight{core=\"" << core << "\"} " << ledger[core].committed << "\n";
+    }
+    if (haveLoad) {
+        gauges << "# HELP ccm_core_load_percent Measured utilisation of each core.\n"
+               << "# TYPE ccm_core_load_percent gauge\n";
+        for (size_t core = 0; core < load.size(); ++core) {
+            gauges << "ccm_core_load_percent{core=\"" << core << "\"} " << load[core] << "\n";
+        }
+    }
+    gauges << "# HELP ccm_admission_queue_depth StartJobs waiting for capacity.\n"
+           << "# TYPE ccm_admission_queue_depth gauge\n"
+           << "ccm_admission_queue_depth " << admissionDepth << "\n"
+           << "# HELP ccm_pending_messages Messages received but not yet decoded.\n"
+           << "# TYPE ccm_pending_messages gauge\n"
+           << "ccm_pending_messages " << messageBacklog << "\n"
+           << "# HELP ccm_worker_queue_depth Commands waiting for each command worker.\n"
+           << "# TYPE ccm_worker_queue_depth gauge\n";
+    for (size_t i = 0; i < workerDepths.size(); ++i) {
+        gauges << "ccm_worker_queue_depth{worker=\"" << i << "\"} " << workerDepths[i] << "\n";
+    }
+
+    out += gauges.str();
+    Metrics::instance().writePrometheus(out);
+}
+
+bool ProcessManager::startMetrics(const MetricsSettings& settings) {
+    return metricsExporter.start(settings, [this](std::string& out) { writeMetrics(out); });
+}
+
+void ProcessManager::wakeMonitor() {
+    uint64_t one = 1;
+    if (wakeFd != -1 && write(wakeFd, &one, sizeof(one)) == -1) {
+        CCM_WARN << "[MANAGER] Failed to wake monitor thread: " << strerror(errno);
+    }
 }
 
 void ProcessManager::stop() 
 {
+    metricsExporter.stop();
     running = false;
- //   queue.stop(); // Unblock waiting threads
-    
-    // Cleanup must happen before threads join, but after 'running' is false
-    cleanupProcesses();
+
+    // Wake the monitor out of epoll_wait so it can observe 'running'
+    wakeMonitor();
         
-    // Wait for worker threads to finish
+    // Wake the command processor and periodic threads so they can observe 'running'
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+    }
+    pendingCv.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+    }
+    stopCv.notify_all();
+
+    // The receiver is blocked in receive(): post a message of our own so it sees 'running'.
+    // Should the queue be full, the receiver is not blocked and frees a slot for it.
+    if (receiverThread.joinable()) {
+        queue->send(RECEIVER_WAKE_MESSAGE);
+        receiverThread.join();
+    }
+    // These feed the workers (commands, admissions), so they stop first
     if (commandProcessorThread.joinable()) {
         commandProcessorThread.join();
     }
     if (monitorThread.joinable()) {
         monitorThread.join();
     }
+    if (statsThread.joinable()) {
+        statsThread.join();
+    }
+
+    // A worker finishes the command it is running and drops the rest of its queue
+    for (auto& worker : workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->cv.notify_all();
+        if (worker->thread.joinable()) worker->thread.join();
+        worker->tasks.clear();
+    }
+    workers.clear();
+    zygotes.stop(); // No launch can be in flight now
+
+    // Only now is no thread left that could start, pause or resume a job behind our back
+    cleanupProcesses();
+
+    loadSampler.stop();
+
+    if (epollFd != -1) close(epollFd);
+    if (wakeFd != -1) close(wakeFd);
+    epollFd = wakeFd = -1;
     
-    std::cout << "[MANAGER] Process Manager stopped." << std::endl;
+    CCM_INFO << "[MANAGER] Process Manager stopped.";
+    Logger::instance().flush();
 }
 
 
@@ -0,0 +1,136 @@
+#include "ProcessTracker.h"
+
+TrackedProcess& ProcessTracker::insert(const std::string& id, TrackedProcess proc)
+{
+    erase(id);
+
+    auto result = byId.emplace(id, std::move(proc));
+    Entry& entry = *result.first;
+    if (entry.second.pid > 0) {
+        byPid[entry.second.pid] = &entry;
+    }
+    return entry.second;
+}
+
+bool ProcessTracker::assignPid(const std::string& id, pid_t pid)
+{
+    auto it = byId.find(id);
+    if (it == byId.end()) return false;
+
+    TrackedProcess& proc = it->second;
+    auto pidIt = byPid.find(proc.pid);
+    if (pidIt != byPid.end() && pidIt->second == &*it) {
+        byPid.erase(pidIt);
+    }
+    proc.pid = pid;
+    if (pid > 0) {
+        byPid[pid] = &*it;
+    }
+    return true;
+}
+
+TrackedProcess* ProcessTracker::find(const std::string& id)
+{
+    auto it = byId.find(id);
+    return it == byId.end() ? nullptr : &it->second;
+}
+
+ProcessTracker::Entry* ProcessTracker::findByPid(pid_t pid)
+{
+    auto it = byPid.find(pid);
+    return it == byPid.end() ? nullptr : it->second;
+}
+
+bool ProcessTracker::erase(const std::string& id)
+{
+    auto it = byId.find(id);
+    if (it == byId.end()) return false;
+
+    auto pidIt = byPid.find(it->second.pid);
+    // Only drop the pid index if it still points at this entry
+    if (pidIt != byPid.end() && pidIt->second == &*it) {
+        byPid.erase(pidIt);
+    }
+    byId.erase(it);
+    return true;
+}
+
+void ProcessTracker::clear()
+{
+    byPid.clear();
+    byId.clear();
+}
+
+ShardedProcessTracker::ShardedProcessTracker()
+{
+    for (size_t i = 0; i < TRACKER_SHARDS; ++i) {
+        shards[i].reset(new Shard());
+        shards[i]->index = i;
+        pidStripes[i].reset(new PidStripe());
+    }
+}
+
+ShardedProcessTracker::Shard& ShardedProcessTracker::shardOf(const std::string& id)
+{
+    return *shards[std::hash<std::string>{}(id) % TRACKER_SHARDS];
+}
+
+ShardedProcessTracker::Shard* ShardedProcessTracker::shardOfPid(pid_t pid)
+{
+    PidStripe& stripe = *pidStripes[static_cast<size_t>(pid) % TRACKER_SHARDS];
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.shardOf.find(pid);
+    return it == stripe.shardOf.end() ? nullptr : shards[it->second].get();
+}
+
+void ShardedProcessTracker::indexPid(pid_t pid, size_t shardIndex)
+{
+    if (pid <= 0) return;
+    PidStripe& stripe = *pidStripes[static_cast<size_t>(pid) % TRACKER_SHARDS];
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    stripe.shardOf[pid] = shardIndex;
+}
+
+void ShardedProcessTracker::unindexPid(pid_t pid, size_t shardIndex)
+{
+    if (pid <= 0) return;
+    PidStripe& stripe = *pidStripes[static_cast<size_t>(pid) % TRACKER_SHARDS];
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.shardOf.find(pid);
+    // Only drop the entry if no other shard has claimed the pid since
+    if (it != stripe.shardOf.end() && it->second == shardIndex) {
+        stripe.shardOf.erase(it);
+    }
+}
+
+TrackedProcess& ShardedProcessTracker::insert(Shard& shard, const std::string& id, TrackedProcess proc)
+{
+    erase(shard, id);
+    pid_t pid = proc.pid;
+    TrackedProcess& stored = shard.jobs.insert(id, std::move(proc));
+    indexPid(pid, shard.index);
+    total.fetch_add(1, std::memory_order_relaxed);
+    return stored;
+}
+
+bool ShardedProcessTracker::assignPid(Shard& shard, const std::string& id, pid_t pid)
+{
+    TrackedProcess* proc = shard.jobs.find(id);
+    if (!proc) return false;
+
+    unindexPid(proc->pid, shard.index);
+    shard.jobs.assignPid(id, pid);
+    indexPid(pid, shard.index);
+    return true;
+}
+
+bool ShardedProcessTracker::erase(Shard& shard, const std::string& id)
+{
+    TrackedProcess* proc = shard.jobs.find(id);
+    if (!proc) return false;
+
+    unindexPid(proc->pid, shard.index);
+    shard.jobs.erase(id);
+    total.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
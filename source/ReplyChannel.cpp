@@ -0,0 +1,126 @@
+#include "ReplyChannel.h"
+#include "Logger.h"
+#include <cstring>  // For strerror()
+#include <errno.h>  // For errno
+#include <fcntl.h>  // For O_WRONLY, O_NONBLOCK
+#include "MqMessage.h"
+
+static nlohmann::json result_to_json(const CommandResult& r)
+{
+    nlohmann::json j = {{"JobId", r.jobId}, {"Action", r.action}, {"Ok", r.ok}};
+    if (r.pid > 0) j["Pid"] = r.pid;
+    if (!r.cores.empty()) j["Cores"] = r.cores;
+    if (!r.status.empty()) j["Status"] = r.status;
+    if (r.waitMs >= 0) j["WaitMs"] = r.waitMs;
+    if (!r.ok) j["Error"] = r.error;
+    return j;
+}
+
+ReplyChannel::~ReplyChannel()
+{
+    closeAll();
+}
+
+void ReplyChannel::closeAll()
+{
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    closeLocked();
+}
+
+void ReplyChannel::closeLocked()
+{
+    for (auto& entry : queues) mq_close(entry.second.mqd);
+    queues.clear();
+}
+
+ReplyChannel::OpenQueue* ReplyChannel::open(const std::string& name)
+{
+    auto it = queues.find(name);
+    if (it != queues.end()) return &it->second;
+
+    if (name.size() < 2 || name[0] != '/') {
+        CCM_ERROR << "[ERROR] Invalid reply queue name '" << name << "'";
+        return nullptr;
+    }
+
+    mqd_t mqd = mq_open(name.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (mqd == (mqd_t)-1) {
+        CCM_ERROR << "[ERROR] Cannot open reply queue " << name << ": " << strerror(errno);
+        return nullptr;
+    }
+    mq_attr attr{};
+    if (mq_getattr(mqd, &attr) == -1) {
+        mq_close(mqd);
+        return nullptr;
+    }
+
+    if (queues.size() >= REPLY_MAX_OPEN_QUEUES) closeLocked();
+    OpenQueue& q = queues[name];
+    q.mqd = mqd;
+    q.maxMsgSize = static_cast<size_t>(attr.mq_msgsize);
+    return &q;
+}
+
+bool ReplyChannel::serializePart(const std::string& name, size_t maxMsgSize, const std::string& correlationId,
+                                 const std::vector<CommandResult>& results, size_t first, size_t last, bool more,
+                                 std::vector<std::string>& parts)
+{
+    MQMessage reply;
+    reply.command = "Reply";
+    reply.parameters["CorrelationId"] = correlationId;
+    nlohmann::json& list = reply.parameters["Results"] = nlohmann::json::array();
+    for (size_t i = first; i < last; ++i) list.push_back(result_to_json(results[i]));
+    reply.parameters["More"] = more;
+    std::string raw = reply.serialize();
+
+    if (raw.size() > maxMsgSize) {
+        if (last - first > 1) {
+            // Halve the range until each part fits the client's message size
+            size_t mid = first + (last - first) / 2;
+            return serializePart(name, maxMsgSize, correlationId, results, first, mid, true, parts) &&
+                   serializePart(name, maxMsgSize, correlationId, results, mid, last, more, parts);
+        }
+        CCM_ERROR << "[ERROR] Reply for job " << results[first].jobId << " exceeds the message size of "
+                  << name;
+        return false;
+    }
+    parts.push_back(std::move(raw));
+    return true;
+}
+
+bool ReplyChannel::send(const std::string& queueName, const std::string& correlationId,
+                        const std::vector<CommandResult>& results)
+{
+    size_t maxMsgSize;
+    {
+        std::lock_guard<std::mutex> lock(queuesMutex);
+        OpenQueue* q = open(queueName);
+        if (!q) return false;
+        maxMsgSize = q->maxMsgSize;
+    }
+
+    // Built without the lock so other workers keep replying meanwhile
+    std::vector<std::string> parts;
+    if (!serializePart(queueName, maxMsgSize, correlationId, results, 0, results.size(), false, parts)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    OpenQueue* q = open(queueName); // Reopened if the cache was cleared in between
+    if (!q) return false;
+    for (const std::string& raw : parts) {
+        // The descriptor is O_NONBLOCK: a full client queue fails with EAGAIN instead of stalling
+        if (mq_send(q->mqd, raw.data(), raw.size(), 0) == -1) {
+            int err = errno;
+            CCM_WARN << "[WARN] Dropping reply " << correlationId << " to " << queueName << ": "
+                     << strerror(err);
+            if (err == EBADF) {
+                // Stale descriptor, reopen on the next reply
+                mq_close(q->mqd);
+                queues.erase(queueName);
+            }
+            return false;
+        }
+    }
+    return true;
+}
@@ -35,92 +35,48 @@
 #include <string>
 #include <sstream>
 #include <map>
-#include <dirent.h>
 #include <algorithm>
 #include <cctype>
+#include "ProcScanner.h"
+#include "Logger.h"
 
 int find_least_busy_core();
 void execute_on_core(int core_id, const char* path, const char* const args[]);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
-// The 39th field in /proc/[pid]/stat is the processor ID
-const int CORE_FIELD_INDEX = 39;
-
-// --- 1. Core Retrieval Function (C++ style) ---
-// Retrieves the last used core ID for a given PID by parsing /proc/[pid]/stat.
+// --- 1. Core Retrieval Function ---
+// Retrieves the last used core ID (field 39 of /proc/[pid]/stat) for a given PID.
 int get_process_core(int pid) {
-    // Construct the path to the stat file
-    std::string path = "/proc/" + std::to_string(pid) + "/stat";
-    std::ifstream stat_file(path);
+    static ProcScanner scanner;
+    ProcStatFields fields;
 
-    if (!stat_file.is_open()) {
+    if (!scanner.read(pid, fields)) {
         // Process likely terminated or permissions denied
         return -1;
     }
-
-    std::string line;
-    if (!std::getline(stat_file, line)) {
-        return -1;
-    }
-
-    // Use stringstream to easily tokenize the line
-    std::stringstream ss(line);
-    std::string token;
-    int field_count = 0;
-
-    // Iterate through tokens until the 39th field
-    while (ss >> token) {
-        field_count++;
-        if (field_count == CORE_FIELD_INDEX) {
-            try {
-                // Convert the 39th token (the processor ID) to an integer
-                return std::stoi(token);
-            } catch (const std::exception& e) {
-                // Handle conversion error
-                return -1;
-            }
-        }
-    }
-    return -1;
+    return fields.processor;
 }
 
 // --- 2. Main Mapping Function ---
-// Iterates /proc, collects PIDs, and maps them to their core IDs.
+// Lists /proc with getdents64, collects PIDs, and maps them to their core IDs.
+// The scanner keeps the stat files of known PIDs open, so repeated calls only
+// pay for a pread() per process instead of an open/parse/close.
 std::map<int, int> find_all_pids_and_cores() {
+    static ProcScanner scanner;
+    static ProcScanner::Result entries;
     std::map<int, int> pid_core_map;
-    
-    // Use POSIX functions to open and read the directory (still the standard way)
-    DIR *dir = opendir("/proc");
-    if (!dir) {
+
+    if (!scanner.scanAll(entries)) {
         std::cerr << "Error opening /proc: " << strerror(errno) << std::endl;
         return pid_core_map; // Return empty map
     }
 
-    struct dirent *ent;
-    
-    while ((ent = readdir(dir)) != NULL) {
-        std::string name = ent->d_name;
-        
-        // Check if the entry name consists only of digits (a PID)
-        bool is_pid = std::all_of(name.begin(), name.end(), ::isdigit);
-
-        if (is_pid) {
-            try {
-                int pid = std::stoi(name);
-                int core_id = get_process_core(pid);
-
-                // Only add valid entries to the map
-                if (core_id != -1) {
-                    pid_core_map[pid] = core_id;
-                }
-            } catch (const std::exception& e) {
-                // Handle conversion error, skip entry
-                continue;
-            }
+    for (const auto& entry : entries) {
+        // Only add valid entries to the map
+        if (entry.second.processor != -1) {
+            pid_core_map[entry.first] = entry.second.processor;
         }
     }
-
-    closedir(dir);
     return pid_core_map;
 }
 
@@ -252,11 +208,49 @@ int main()
 
     MQConfig cfg;
     loadConfig("mq.json", cfg);
+    LogSettings logSettings;
+    if (load_log_settings("mq.json", logSettings)) Logger::instance().configure(logSettings);
 
     MessageQueue mq (cfg, true);  // create & own queue
     ProcessManager pm(&mq);
+
+    AdmissionLimits limits;
+    if (load_admission_limits("mq.json", limits) && limits.enabled()) {
+        pm.coreAllocator.setLimits(limits);
+        printf("Admission limits: %d job(s) per core, %.0f%% max load.\n", limits.maxJobsPerCore, limits.maxLoadPct);
+    }
+    std::string cgroupRoot;
+    if (load_cgroup_root("mq.json", cgroupRoot) && !cgroupRoot.empty() && pm.cgroups.open(cgroupRoot)) {
+        printf("Job cgroups under %s.\n", cgroupRoot.c_str());
+    }
+    std::string statusTableName = JOB_TABLE_DEFAULT_NAME;
+    uint32_t statusTableCapacity = JOB_TABLE_DEFAULT_CAPACITY;
+    load_status_table_settings("mq.json", statusTableName, statusTableCapacity);
+    if (!statusTableName.empty() && pm.statusTable.create(statusTableName, statusTableCapacity)) {
+        printf("Job status table %s (%u slots).\n", statusTableName.c_str(), statusTableCapacity);
+    }
+    // Jobs left running by a crashed instance are adopted before new commands arrive
+    std::string journalPath = "ccm.journal";
+    load_journal_path("mq.json", journalPath);
+    if (!journalPath.empty() && !pm.openJournal(journalPath)) {
+        fprintf(stderr, "Job journal %s unavailable, running jobs will not survive a restart.\n", journalPath.c_str());
+    }
+    // Forked before the manager starts its threads
+    ZygoteMode zygoteMode = ZYGOTE_OFF;
+    if (load_zygote_mode("mq.json", zygoteMode) && pm.zygotes.start(zygoteMode, pm.coreAllocator.topology())) {
+        printf("Launcher zygotes: %zu.\n", pm.zygotes.size());
+    }
+    // Must be set before start() launches the sampling thread
+    LoadSamplerSettings samplerSettings;
+    if (load_sampler_settings("mq.json", samplerSettings) && pm.loadSampler.configure(samplerSettings)) {
+        printf("Load sampler: every %d ms, smoothing %.2f.\n", samplerSettings.intervalMs, samplerSettings.smoothing);
+    }
   //  pm.processCommands();
     pm.start();
+    MetricsSettings metricsSettings;
+    if (load_metrics_settings("mq.json", metricsSettings) && metricsSettings.enabled() && pm.startMetrics(metricsSettings)) {
+        printf("Metrics: file '%s', socket '%s'.\n", metricsSettings.file.c_str(), metricsSettings.socket.c_str());
+    }
    pm.commandProcessorThread.join();
     // while (true) {
     //     std::string raw = mq.receive();
@@ -0,0 +1,227 @@
+/*
+ * ccm_bench_decode: decode throughput of the command wire formats.
+ *
+ * Encodes one StartJob (with --args arguments of --arg-len bytes each, plus
+ * the usual placement, reply and limit fields) in both formats and decodes it
+ * --iterations times per path:
+ *   - json: nlohmann::json::parse() of the MQMessage text, then the fields
+ *     pulled out with value() as ProcessManager's decodeCommand() does
+ *   - binary view: decode_command() into a CommandView over the buffer
+ *   - binary copy: decode_command() + to_command() into a reused Command,
+ *     which is what the manager dispatches
+ * Reports messages per second, ns per message and heap allocations per
+ * message (counted by replacing the global operator new in this tool).
+ *
+ * Build from the repository root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/ccm_bench_decode.cpp source/CommandCodec.cpp \
+ *       source/PriorityClass.cpp -o ccm_bench_decode
+ *
+ * Example:
+ *   ./ccm_bench_decode --iterations 1000000 --args 8 --arg-len 24
+ */
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Command.h"
+#include "CommandCodec.h"
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+struct Options {
+    int iterations = 500000;
+    int args = 4;
+    int argLen = 16;
+};
+
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+Command sample_command(const Options& opt)
+{
+    Command cmd;
+    cmd.action = "StartJob";
+    cmd.id = "job-000123";
+    cmd.programPath = "/usr/local/bin/worker";
+    for (int i = 0; i < opt.args; ++i) cmd.args.push_back(std::string(static_cast<size_t>(opt.argLen), 'a' + i % 26));
+    cmd.cpuWeight = 0.5;
+    cmd.coreCount = 2;
+    cmd.placement = "numa";
+    cmd.numaNode = 0;
+    cmd.priority = 3;
+    cmd.priorityClass = "batch";
+    cmd.cpuMax = 1.5;
+    cmd.memoryMax = 512ull << 20;
+    cmd.replyQueue = "/ccm_reply_4242";
+    cmd.correlationId = "c-000123";
+    return cmd;
+}
+
+std::string to_json(const Command& cmd)
+{
+    nlohmann::json params;
+    params["JobId"] = cmd.id;
+    params["ProgramPath"] = cmd.programPath;
+    params["Args"] = cmd.args;
+    params["CpuWeight"] = cmd.cpuWeight;
+    params["CoreCount"] = cmd.coreCount;
+    params["Placement"] = cmd.placement;
+    params["NumaNode"] = cmd.numaNode;
+    params["Priority"] = cmd.priority;
+    params["PriorityClass"] = cmd.priorityClass;
+    params["CpuMax"] = cmd.cpuMax;
+    params["MemoryMax"] = cmd.memoryMax;
+    params["ReplyQueue"] = cmd.replyQueue;
+    params["CorrelationId"] = cmd.correlationId;
+    return nlohmann::json{{"command", cmd.action}, {"parameters", params}}.dump();
+}
+
+// The JSON path of ProcessManager::handleMessage() + decodeCommand()
+void decode_json(const std::string& raw, Command& cmd)
+{
+    nlohmann::json msg = nlohmann::json::parse(raw);
+    const nlohmann::json& params = msg["parameters"];
+    cmd.action = msg.value("command", "");
+    cmd.id = params.value("JobId", "");
+    cmd.processId = params.value("ProcessId", "");
+    cmd.programPath = params.value("ProgramPath", "");
+    cmd.args = params.value("Args", std::vector<std::string>{});
+    cmd.cpuWeight = params.value("CpuWeight", 1.0);
+    if (!std::isfinite(cmd.cpuWeight) || cmd.cpuWeight <= 0.0 || cmd.cpuWeight > 1.0) {
+        throw std::invalid_argument("CpuWeight is not in (0, 1]");
+    }
+    cmd.placement = params.value("Placement", "");
+    cmd.numaNode = params.value("NumaNode", -1);
+    cmd.coreCount = params.value("CoreCount", 1);
+    cmd.priority = params.value("Priority", 0);
+    cmd.priorityClass = params.value("PriorityClass", "");
+    cmd.cpuMax = params.value("CpuMax", 0.0);
+    cmd.memoryMax = params.value("MemoryMax", static_cast<uint64_t>(0));
+    cmd.replyQueue = params.value("ReplyQueue", "");
+    cmd.correlationId = params.value("CorrelationId", "");
+}
+
+struct Result {
+    uint64_t ns = 0;
+    uint64_t allocs = 0;
+    bool ok = true;
+};
+
+template <typename Fn>
+Result run(int iterations, Fn decode)
+{
+    Result result;
+    uint64_t allocsBefore = allocations.load(std::memory_order_relaxed);
+    uint64_t begin = now_ns();
+    for (int i = 0; i < iterations; ++i) result.ok = decode() && result.ok;
+    result.ns = now_ns() - begin;
+    result.allocs = allocations.load(std::memory_order_relaxed) - allocsBefore;
+    return result;
+}
+
+void print(const char* name, const Result& result, int iterations, size_t bytes)
+{
+    double perMessage = static_cast<double>(result.ns) / iterations;
+    printf("  %-14s %8zu %14.0f %10.1f %10.2f%s\n", name, bytes, 1e9 / perMessage, perMessage,
+           static_cast<double>(result.allocs) / iterations, result.ok ? "" : "  DECODE FAILED");
+}
+
+void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --iterations N      decodes per path (default 500000)\n"
+            "  --args N            arguments in the StartJob (default 4)\n"
+            "  --arg-len N         bytes per argument (default 16)\n",
+            argv0);
+}
+
+} // namespace
+
+// Counts heap allocations for the report; everything else behaves as usual. Kept out of
+// line so GCC does not pair the inlined malloc()/free() against new/delete expressions.
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--iterations") ok = (opt.iterations = atoi(value.c_str())) > 0;
+        else if (arg == "--args") ok = (opt.args = atoi(value.c_str())) >= 0;
+        else if (arg == "--arg-len") ok = (opt.argLen = atoi(value.c_str())) >= 0;
+        else ok = false;
+        if (!ok) {
+            fprintf(stderr, "Invalid option %s %s\n", arg.c_str(), value.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    Command sample = sample_command(opt);
+    std::string json = to_json(sample);
+    std::string binary;
+    if (!encode_command(sample, binary)) {
+        fprintf(stderr, "[ERROR] The sample command does not fit the binary format\n");
+        return 1;
+    }
+
+    Command jsonCmd, binaryCmd;
+    CommandView view;
+    Result jsonResult = run(opt.iterations, [&] {
+        decode_json(json, jsonCmd);
+        return jsonCmd.args.size() == sample.args.size();
+    });
+    Result viewResult = run(opt.iterations, [&] {
+        size_t consumed;
+        return decode_command(binary.data(), binary.size(), view, consumed) && view.argCount == sample.args.size();
+    });
+    Result copyResult = run(opt.iterations, [&] {
+        size_t consumed;
+        if (!decode_command(binary.data(), binary.size(), view, consumed)) return false;
+        to_command(view, binaryCmd);
+        return binaryCmd.args.size() == sample.args.size();
+    });
+
+    printf("StartJob with %d argument(s) of %d bytes, %d decodes per path\n", opt.args, opt.argLen, opt.iterations);
+    printf("  %-14s %8s %14s %10s %10s\n", "path", "bytes", "messages/s", "ns/msg", "allocs/msg");
+    print("json", jsonResult, opt.iterations, json.size());
+    print("binary view", viewResult, opt.iterations, binary.size());
+    print("binary copy", copyResult, opt.iterations, binary.size());
+    return jsonResult.ok && viewResult.ok && copyResult.ok ? 0 : 1;
+}
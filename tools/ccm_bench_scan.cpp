@@ -0,0 +1,219 @@
+/*
+ * ccm_bench_scan: benchmark of the /proc scanners.
+ *
+ * Compares the original find_all_pids_and_cores() (readdir + an ifstream and
+ * a stringstream per /proc/[pid]/stat, tokenised up to field 39), kept below
+ * as scan_stream(), against ProcScanner:
+ *   - scanAll: getdents64 into a reused buffer, cached stat fds, one pread()
+ *     per pid, parsed from the last ')'
+ *   - scanPids: the same for a tracked subset only (--tracked pids), which is
+ *     what the manager's per-job sampling does
+ * Reports the mean and p50/p99 time per scan in milliseconds. --spawn forks
+ * that many idle children first so a quiet host looks like a busy one; they
+ * are named "ccm bench) x" so the old parser's field counting is exercised
+ * too, and the pids whose processor field the two parsers disagree on are
+ * counted.
+ *
+ * Build from the repository root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/ccm_bench_scan.cpp source/ProcScanner.cpp -o ccm_bench_scan
+ *
+ * Example (may need a higher ulimit -u):
+ *   ./ccm_bench_scan --spawn 20000 --iterations 50 --tracked 64
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/prctl.h>   // For prctl(PR_SET_NAME, PR_SET_PDEATHSIG)
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ProcScanner.h"
+
+namespace {
+
+struct Options {
+    int iterations = 50;
+    int spawn = 0;
+    int tracked = 64;
+};
+
+// The scanner ProcScanner replaced: pid -> processor (field 39)
+int get_process_core(int pid)
+{
+    std::string path = "/proc/" + std::to_string(pid) + "/stat";
+    std::ifstream stat_file(path);
+    if (!stat_file.is_open()) return -1;
+
+    std::string line;
+    if (!std::getline(stat_file, line)) return -1;
+
+    std::stringstream ss(line);
+    std::string token;
+    int field_count = 0;
+    while (ss >> token) {
+        field_count++;
+        if (field_count == 39) {
+            try {
+                return std::stoi(token);
+            } catch (const std::exception&) {
+                return -1;
+            }
+        }
+    }
+    return -1;
+}
+
+std::map<int, int> scan_stream()
+{
+    std::map<int, int> pid_core_map;
+    DIR* dir = opendir("/proc");
+    if (!dir) return pid_core_map;
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        std::string name = ent->d_name;
+        if (std::all_of(name.begin(), name.end(), ::isdigit)) {
+            try {
+                int pid = std::stoi(name);
+                int core_id = get_process_core(pid);
+                if (core_id != -1) pid_core_map[pid] = core_id;
+            } catch (const std::exception&) {
+                continue;
+            }
+        }
+    }
+    closedir(dir);
+    return pid_core_map;
+}
+
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct Timing {
+    std::vector<uint64_t> samples;
+
+    void print(const char* name, size_t pids)
+    {
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for (uint64_t ns : samples) sum += static_cast<double>(ns);
+        auto at = [this](double q) {
+            size_t i = static_cast<size_t>(std::ceil(q * static_cast<double>(samples.size()))) - 1;
+            return static_cast<double>(samples[std::min(i, samples.size() - 1)]) / 1e6;
+        };
+        printf("  %-22s %8zu %10.3f %10.3f %10.3f\n", name, pids, sum / static_cast<double>(samples.size()) / 1e6,
+               at(0.50), at(0.99));
+    }
+};
+
+void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --iterations N      scans per scanner (default 50)\n"
+            "  --spawn N           idle children to fork first (default 0)\n"
+            "  --tracked N         pids in the scanPids subset (default 64)\n",
+            argv0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--iterations") ok = (opt.iterations = atoi(value.c_str())) > 0;
+        else if (arg == "--spawn") ok = (opt.spawn = atoi(value.c_str())) >= 0;
+        else if (arg == "--tracked") ok = (opt.tracked = atoi(value.c_str())) > 0;
+        else ok = false;
+        if (!ok) {
+            fprintf(stderr, "Invalid option %s %s\n", arg.c_str(), value.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < opt.spawn; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            prctl(PR_SET_NAME, "ccm bench) x", 0, 0, 0);
+            while (true) pause();
+        }
+        if (pid == -1) {
+            fprintf(stderr, "[WARN] fork failed after %zu children: %s\n", children.size(), strerror(errno));
+            break;
+        }
+        children.push_back(pid);
+    }
+    if (!children.empty()) usleep(100000); // Let the children rename themselves
+
+    // One scanner per mode: scanPids closes the cached fds of every pid it is not given
+    ProcScanner scanner, trackedScanner;
+    ProcScanner::Result all, subset;
+    std::map<int, int> streamed = scan_stream();
+    scanner.scanAll(all);
+    size_t differ = 0;
+    for (const auto& entry : all) {
+        auto it = streamed.find(entry.first);
+        if (it != streamed.end() && it->second != entry.second.processor) differ++;
+    }
+
+    // Tracked subset: our own children if there are any, otherwise whatever /proc lists first
+    std::vector<pid_t> tracked;
+    for (size_t i = 0; i < children.size() && tracked.size() < static_cast<size_t>(opt.tracked); ++i) {
+        tracked.push_back(children[i]);
+    }
+    for (size_t i = 0; i < all.size() && tracked.size() < static_cast<size_t>(opt.tracked); ++i) {
+        tracked.push_back(all[i].first);
+    }
+
+    Timing stream, scanAll, scanPids;
+    size_t streamPids = 0;
+    for (int i = 0; i < opt.iterations; ++i) {
+        uint64_t begin = now_ns();
+        streamPids = scan_stream().size();
+        uint64_t afterStream = now_ns();
+        scanner.scanAll(all);
+        uint64_t afterAll = now_ns();
+        trackedScanner.scanPids(tracked, subset);
+        uint64_t afterPids = now_ns();
+        stream.samples.push_back(afterStream - begin);
+        scanAll.samples.push_back(afterAll - afterStream);
+        scanPids.samples.push_back(afterPids - afterAll);
+    }
+
+    for (pid_t pid : children) kill(pid, SIGKILL);
+    for (pid_t pid : children) waitpid(pid, nullptr, 0);
+
+    printf("%zu processes (%zu spawned), %d scans per scanner, processor field differs on %zu pid(s)\n", all.size(),
+           children.size(), opt.iterations, differ);
+    printf("  %-22s %8s %10s %10s %10s   (ms per scan)\n", "scanner", "pids", "mean", "p50", "p99");
+    stream.print("readdir/ifstream", streamPids);
+    scanAll.print("ProcScanner::scanAll", all.size());
+    scanPids.print("ProcScanner::scanPids", subset.size());
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * ccm_bench_spawn: spawn latency of the job launch paths.
+ *
+ * Starts --iterations /bin/true children through each path and reports how
+ * long the launching thread is held up, as p50/p99/max in microseconds:
+ *   - fork: the original startProgram path, kept below as fork_launch():
+ *     fork(), sched_setaffinity() in the child, execv(). The parent returns
+ *     right after fork() and never learns whether the exec worked.
+ *   - launch_process: clone(CLONE_VM | CLONE_VFORK) with the affinity set in
+ *     the child; returns once the exec has succeeded or failed.
+ *   - zygote: launch_process() run by a pre-forked ZygotePool helper
+ *     (skipped with --no-zygote).
+ * fork() copies the page tables of the caller, so its cost grows with the
+ * manager's resident memory: --rss-mb touches that much heap first, and
+ * --threads keeps that many other threads busy, as a loaded manager would.
+ * Each child is reaped before the next launch, outside the timed section.
+ *
+ * Build from the repository root:
+ *   g++ -std=c++17 -O2 -pthread -Iinclude tools/ccm_bench_spawn.cpp \
+ *       source/Launcher.cpp source/LauncherZygote.cpp source/CpuMask.cpp source/CpuTopology.cpp \
+ *       source/Logger.cpp -o ccm_bench_spawn
+ *
+ * Example:
+ *   ./ccm_bench_spawn --iterations 2000 --rss-mb 1024 --threads 4
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Launcher.h"
+#include "LauncherZygote.h"
+#include "CpuMask.h"
+#include "CpuTopology.h"
+#include "Logger.h"
+
+namespace {
+
+struct Options {
+    int iterations = 1000;
+    size_t rssMb = 256;
+    int threads = 0;
+    bool zygote = true;
+    std::string program = "/bin/true";
+};
+
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct Timing {
+    std::vector<uint64_t> samples;
+    int failures = 0;
+
+    void print(const char* name)
+    {
+        if (samples.empty()) {
+            printf("  %-16s %8d %8d\n", name, 0, failures);
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto at = [this](double q) {
+            size_t i = static_cast<size_t>(std::ceil(q * static_cast<double>(samples.size()))) - 1;
+            return static_cast<double>(samples[std::min(i, samples.size() - 1)]) / 1000.0;
+        };
+        printf("  %-16s %8zu %8d %10.1f %10.1f %10.1f\n", name, samples.size(), failures, at(0.50), at(0.99),
+               static_cast<double>(samples.back()) / 1000.0);
+    }
+};
+
+// The launch path launch_process() replaced, minus the tracker bookkeeping
+pid_t fork_launch(const char* path, char* const* argv, int core)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (core != -1) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(core, &cpuset);
+            sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
+        }
+        execv(path, argv);
+        _exit(EXIT_FAILURE);
+    }
+    return pid;
+}
+
+void reap(pid_t pid, int pidfd)
+{
+    if (pid > 0) waitpid(pid, nullptr, 0);
+    if (pidfd != -1) close(pidfd);
+}
+
+void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --iterations N      launches per path (default 1000)\n"
+            "  --rss-mb N          heap to touch before measuring (default 256)\n"
+            "  --threads N         busy threads running alongside (default 0)\n"
+            "  --program PATH      program to launch (default /bin/true)\n"
+            "  --no-zygote         skip the zygote path\n",
+            argv0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-zygote") {
+            opt.zygote = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--iterations") ok = (opt.iterations = atoi(value.c_str())) > 0;
+        else if (arg == "--rss-mb") opt.rssMb = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads") ok = (opt.threads = atoi(value.c_str())) >= 0;
+        else if (arg == "--program") opt.program = value;
+        else ok = false;
+        if (!ok) {
+            fprintf(stderr, "Invalid option %s %s\n", arg.c_str(), value.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    LogSettings logSettings;
+    logSettings.level = LEVEL_WARN;
+    Logger::instance().configure(logSettings);
+
+    CpuTopology topology;
+    topology.load();
+    int core = -1;
+    for (int cpu = 0; cpu < topology.cpuCount() && core == -1; ++cpu) {
+        if (topology.present(cpu)) core = cpu;
+    }
+    CpuMask mask(std::max(topology.cpuCount(), 1));
+    if (core != -1) mask.set(core);
+
+    // Zygotes are forked before the heap grows and the threads start, as in the manager
+    ZygotePool zygotes;
+    if (opt.zygote && !zygotes.start(ZYGOTE_PER_CORE, topology)) {
+        fprintf(stderr, "[WARN] No launcher zygote could be started, skipping that path.\n");
+        opt.zygote = false;
+    }
+
+    std::vector<char> heap(opt.rssMb << 20);
+    for (size_t i = 0; i < heap.size(); i += 4096) heap[i] = 1;
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> busy;
+    for (int i = 0; i < opt.threads; ++i) {
+        busy.emplace_back([&stop] {
+            volatile uint64_t x = 0;
+            while (!stop.load(std::memory_order_relaxed)) x = x + 1;
+        });
+    }
+
+    std::vector<char> pathBuf(opt.program.begin(), opt.program.end());
+    pathBuf.push_back('\0');
+    char* childArgv[] = {pathBuf.data(), nullptr};
+    LaunchRequest req;
+    req.path = pathBuf.data();
+    req.argv = childArgv;
+    if (core != -1) {
+        req.cpuMask = mask.data();
+        req.cpuMaskSize = mask.byteSize();
+    }
+
+    Timing forked, cloned, zygote;
+    for (int i = 0; i < opt.iterations; ++i) {
+        uint64_t begin = now_ns();
+        pid_t pid = fork_launch(req.path, childArgv, core);
+        forked.samples.push_back(now_ns() - begin);
+        if (pid == -1) forked.failures++;
+        reap(pid, -1);
+
+        begin = now_ns();
+        LaunchResult result = launch_process(req);
+        cloned.samples.push_back(now_ns() - begin);
+        if (result.pid <= 0) cloned.failures++;
+        reap(result.pid, result.pidfd);
+
+        if (opt.zygote) {
+            LaunchResult viaZygote;
+            begin = now_ns();
+            bool handled = zygotes.launch(req, mask, viaZygote);
+            zygote.samples.push_back(now_ns() - begin);
+            if (!handled || viaZygote.pid <= 0) zygote.failures++;
+            reap(viaZygote.pid, viaZygote.pidfd);
+        }
+    }
+
+    stop = true;
+    for (auto& thread : busy) thread.join();
+    zygotes.stop();
+
+    printf("%s, %zu MB touched, %d busy thread(s), pinned to core %d\n", opt.program.c_str(), opt.rssMb,
+           opt.threads, core);
+    printf("  %-16s %8s %8s %10s %10s %10s   (us the launching thread is held)\n", "path", "count", "failed",
+           "p50", "p99", "max");
+    forked.print("fork");
+    cloned.print("launch_process");
+    if (opt.zygote) zygote.print("zygote");
+    Logger::instance().flush();
+    return 0;
+}
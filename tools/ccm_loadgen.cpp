@@ -0,0 +1,849 @@
+/*
+ * ccm_loadgen: load generator and end-to-end benchmark for a running manager.
+ *
+ * Floods the request queue named in mq.json with StartJob, pause, resume,
+ * terminate and status commands at a fixed rate and mix, then reports:
+ *   - throughput: commands sent per second, replies, failures and exits seen
+ *   - command-to-spawn latency: from the time a StartJob was scheduled to be
+ *     sent until the reply carrying its PID arrives
+ *   - spawn-to-exit-notice latency: from that reply until the manager
+ *     publishes the exit in the job status table, minus the job's own run time
+ *   - reply latency of the control commands
+ *   - placement quality: how evenly running jobs are spread over the cores,
+ *     sampled from the job status table
+ * Latencies are measured from the scheduled send time, so a manager that falls
+ * behind (full request queue) shows up in the numbers instead of slowing the
+ * generator down. A fixed --seed draws the same sequence of actions and job
+ * kinds on every run; which live job a control command hits depends on timing.
+ *
+ * Jobs are /bin/true, /bin/sleep and CPU spinners (this binary re-executed with
+ * --spin MS, so no shell is involved). Control commands target jobs the
+ * generator started itself; when no job qualifies a StartJob is sent instead.
+ *
+ * Build from the repository root, linking the same MessageQueue/Config library
+ * as the manager:
+ *   g++ -std=c++17 -O2 -pthread -Iinclude tools/ccm_loadgen.cpp \
+ *       source/CommandCodec.cpp source/PriorityClass.cpp source/JobStatusTable.cpp \
+ *       source/Logger.cpp <MessageQueue library> -lrt -o ccm_loadgen
+ *
+ * Example (manager already running, same mq.json):
+ *   ./ccm_loadgen --rate 500 --duration 20 --mix start:70,pause:5,resume:5,terminate:10,status:10 \
+ *                 --jobs true:60,sleep:30,spin:10 --binary
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>     // For O_* constants
+#include <mqueue.h>
+#include <sched.h>     // For sched_getaffinity()
+#include <time.h>
+#include <unistd.h>
+
+#include "MessageQueue.h"
+#include "Config.h"
+#include "MqMessage.h"
+#include "Command.h"
+#include "CommandCodec.h"
+#include "JobState.h"
+#include "JobStatusTable.h"
+
+namespace {
+
+enum JobKind { KIND_TRUE = 0, KIND_SLEEP = 1, KIND_SPIN = 2, KIND_COUNT = 3 };
+const char* const KIND_NAMES[KIND_COUNT] = {"true", "sleep", "spin"};
+
+// Indexed by CommandAction; ACTION_UNKNOWN is unused
+const int ACTION_SLOTS = ACTION_STATUS + 1;
+
+struct Options {
+    std::string config = "mq.json";
+    std::string table = JOB_TABLE_DEFAULT_NAME; // Empty: no exit-notice or placement figures
+    double rate = 200.0;      // Commands per second
+    double duration = 10.0;   // Seconds of measured load
+    double warmup = 1.0;      // Seconds of load before measuring
+    double drain = 5.0;       // Seconds to wait for outstanding replies and exits
+    int mix[ACTION_SLOTS] = {0, 70, 5, 5, 10, 10};
+    int jobs[KIND_COUNT] = {70, 20, 10};
+    int sleepMs = 100;
+    int spinMs = 100;
+    int coreCount = 1;
+    std::string placement;    // Manager default when empty
+    bool binary = false;
+    int batch = 1;            // Commands per queue message (binary frames or a StartJobs array)
+    int sampleMs = 2;         // Job table polling period
+    uint64_t seed = 1;        // Command sequence seed
+};
+
+uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts); // Same clock as the manager's updatedAtNs
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void sleep_until_ns(uint64_t deadline)
+{
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadline / 1000000000ull);
+    ts.tv_nsec = static_cast<long>(deadline % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+// Exact percentiles over all samples (runs are short enough to keep them)
+struct LatencySeries {
+    std::vector<uint64_t> samples;
+
+    void add(uint64_t ns) { samples.push_back(ns); }
+
+    void print(const char* name)
+    {
+        if (samples.empty()) {
+            printf("  %-24s %8d\n", name, 0);
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto at = [this](double q) {
+            size_t i = static_cast<size_t>(std::ceil(q * static_cast<double>(samples.size()))) - 1;
+            return static_cast<double>(samples[std::min(i, samples.size() - 1)]) / 1000.0;
+        };
+        printf("  %-24s %8zu %10.1f %10.1f %10.1f %10.1f\n", name, samples.size(), at(0.50), at(0.99), at(0.999),
+               static_cast<double>(samples.back()) / 1000.0);
+    }
+};
+
+struct JobRecord {
+    JobKind kind;
+    uint64_t nominalNs;     // How long the job runs on its own
+    uint64_t spawnNs = 0;   // Reply with the PID received
+    uint64_t exitNs = 0;    // Manager published the exit (its CLOCK_MONOTONIC)
+    bool spawned = false;
+    bool paused = false;
+    bool disturbed = false; // Paused or terminated: its exit says nothing about notice latency
+    bool exited = false;
+    bool measured = false;  // Started after the warm-up
+    size_t liveIndex = SIZE_MAX; // Position in Generator::live while spawned and not exited
+};
+
+struct PendingCommand {
+    CommandAction action;
+    uint64_t scheduledNs;
+    bool measured;
+};
+
+struct FailedControl {
+    std::string jobId;
+    uint64_t repliedNs;
+    std::string error;
+};
+
+struct PlacementStats {
+    uint64_t samples = 0;
+    uint64_t stackedSamples = 0; // Some core ran 2+ jobs while another ran none
+    double sumMeanJobs = 0.0;
+    double sumCv = 0.0;          // Coefficient of variation of jobs per core
+    std::vector<uint64_t> spread; // Max - min jobs per core, one entry per sample
+};
+
+class Generator {
+public:
+    Generator(const Options& options, MessageQueue& requests, const std::string& selfPath)
+        : opt(options), queue(requests), self(selfPath), actionRng(options.seed), kindRng(options.seed + 1),
+          targetRng(options.seed + 2) {}
+
+    bool openReplyQueue();
+    void closeReplyQueue();
+    bool openTable();
+    void run();
+    void report(double measuredSeconds);
+
+private:
+    CommandAction drawAction();
+    JobKind drawKind();
+    // Builds the next command; false if it targets a job and none qualifies.
+    // Jobs already targeted by the current message ('batch') are skipped: the
+    // reply identifies results by job id.
+    bool makeControl(CommandAction action, Command& cmd, const std::vector<Command>& batch);
+    void makeStart(Command& cmd, bool measured);
+    void send(std::vector<Command>& cmds, uint64_t scheduledNs, bool measured);
+    void terminateLeftovers();
+
+    void receiveReplies();
+    void handleReply(const MQMessage& msg, uint64_t at);
+    void pollTable();
+    void samplePlacement(const std::vector<JobTableEntry>& running);
+
+    void addLive(const std::string& id, JobRecord& job);
+    void removeLive(JobRecord& job);
+    // Records the notice latency once both the spawn reply and the exit are known
+    void measureExit(JobRecord& job);
+
+    const Options& opt;
+    MessageQueue& queue;
+    std::string self;
+    // Separate streams so a fallback start or a retried target pick does not shift the other draws
+    std::mt19937_64 actionRng;
+    std::mt19937_64 kindRng;
+    std::mt19937_64 targetRng;
+
+    std::string replyName;
+    mqd_t replyQueue = (mqd_t)-1;
+    JobStatusReader table;
+    bool haveTable = false;
+    std::vector<int> cpus;       // Placement domain: this process's affinity
+    std::vector<int> cpuIndex;   // CPU id -> position in 'cpus', -1 outside the domain
+
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> measuring{false};
+
+    std::mutex mutex; // Everything below
+    uint64_t nextCorrelation = 1;
+    uint64_t nextJob = 1;
+    std::unordered_map<std::string, PendingCommand> pending; // By correlation id
+    std::unordered_map<std::string, JobRecord> jobs;
+    std::vector<std::string> live;
+    uint64_t sent[ACTION_SLOTS] = {};
+    uint64_t started[KIND_COUNT] = {};
+    uint64_t replies = 0;
+    uint64_t queuedReplies = 0;
+    uint64_t failures = 0;
+    std::vector<FailedControl> failedControls;
+    std::string firstFailure;
+    uint64_t fallbackStarts = 0;
+    uint64_t exitNotices = 0;
+    LatencySeries spawnLatency;
+    LatencySeries exitLatency[KIND_COUNT];
+    LatencySeries replyLatency[ACTION_SLOTS];
+    PlacementStats placement;
+};
+
+bool Generator::openReplyQueue()
+{
+    replyName = "/ccm_loadgen_" + std::to_string(getpid());
+    long maxMessages = 10;
+    if (FILE* f = fopen("/proc/sys/fs/mqueue/msg_max", "r")) {
+        if (fscanf(f, "%ld", &maxMessages) != 1) maxMessages = 10;
+        fclose(f);
+    }
+    mq_attr attr{};
+    attr.mq_maxmsg = maxMessages;
+    attr.mq_msgsize = 8192;
+    mq_unlink(replyName.c_str());
+    replyQueue = mq_open(replyName.c_str(), O_RDONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600, &attr);
+    if (replyQueue == (mqd_t)-1) {
+        fprintf(stderr, "[ERROR] Cannot create reply queue %s: %s\n", replyName.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void Generator::closeReplyQueue()
+{
+    if (replyQueue == (mqd_t)-1) return;
+    mq_close(replyQueue);
+    mq_unlink(replyName.c_str());
+    replyQueue = (mqd_t)-1;
+}
+
+bool Generator::openTable()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    cpuIndex.assign(CPU_SETSIZE, -1);
+    for (size_t i = 0; i < cpus.size(); ++i) cpuIndex[cpus[i]] = static_cast<int>(i);
+
+    if (opt.table.empty()) return true;
+    haveTable = table.open(opt.table);
+    if (!haveTable) {
+        fprintf(stderr, "[WARN] Job status table %s unavailable: no exit-notice or placement figures.\n",
+                opt.table.c_str());
+    }
+    return haveTable;
+}
+
+CommandAction Generator::drawAction()
+{
+    int total = 0;
+    for (int a = ACTION_START; a < ACTION_SLOTS; ++a) total += opt.mix[a];
+    int pick = static_cast<int>(actionRng() % static_cast<uint64_t>(total));
+    for (int a = ACTION_START; a < ACTION_SLOTS; ++a) {
+        if (pick < opt.mix[a]) return static_cast<CommandAction>(a);
+        pick -= opt.mix[a];
+    }
+    return ACTION_START;
+}
+
+JobKind Generator::drawKind()
+{
+    int total = opt.jobs[KIND_TRUE] + opt.jobs[KIND_SLEEP] + opt.jobs[KIND_SPIN];
+    int pick = static_cast<int>(kindRng() % static_cast<uint64_t>(total));
+    for (int k = 0; k < KIND_COUNT; ++k) {
+        if (pick < opt.jobs[k]) return static_cast<JobKind>(k);
+        pick -= opt.jobs[k];
+    }
+    return KIND_TRUE;
+}
+
+void Generator::addLive(const std::string& id, JobRecord& job)
+{
+    job.liveIndex = live.size();
+    live.push_back(id);
+}
+
+void Generator::removeLive(JobRecord& job)
+{
+    // Swap-remove; the moved job learns its new position
+    size_t index = job.liveIndex;
+    if (index >= live.size()) return;
+    if (index + 1 != live.size()) {
+        live[index].swap(live.back());
+        jobs[live[index]].liveIndex = index;
+    }
+    live.pop_back();
+    job.liveIndex = SIZE_MAX;
+}
+
+void Generator::measureExit(JobRecord& job)
+{
+    if (!job.measured || job.disturbed || job.exitNs == 0) return;
+    // The reply can trail a short job's exit; that counts as an immediate notice
+    uint64_t elapsed = job.exitNs > job.spawnNs ? job.exitNs - job.spawnNs : 0;
+    exitLatency[job.kind].add(elapsed > job.nominalNs ? elapsed - job.nominalNs : 0);
+}
+
+bool Generator::makeControl(CommandAction action, Command& cmd, const std::vector<Command>& batch)
+{
+    // Caller holds 'mutex'. A few random probes keep this O(1) under any mix.
+    for (int probe = 0; probe < 8 && !live.empty(); ++probe) {
+        std::string id = live[targetRng() % live.size()]; // Copy: removeLive() reorders 'live'
+        JobRecord& job = jobs[id];
+        if (std::any_of(batch.begin(), batch.end(), [&id](const Command& c) { return c.id == id; })) continue;
+        if (action == ACTION_PAUSE && job.paused) continue;
+        if (action == ACTION_RESUME && !job.paused) continue;
+
+        if (action == ACTION_PAUSE) {
+            job.paused = true;
+            job.disturbed = true;
+        } else if (action == ACTION_RESUME) {
+            job.paused = false;
+        } else if (action == ACTION_TERMINATE) {
+            job.disturbed = true;
+            removeLive(job); // Never targeted again
+        }
+        cmd.action = action_name(action);
+        cmd.id = id;
+        return true;
+    }
+    return false;
+}
+
+void Generator::makeStart(Command& cmd, bool measured)
+{
+    JobKind kind = drawKind();
+    cmd.action = "StartJob";
+    cmd.id = "lg" + std::to_string(getpid()) + "-" + std::to_string(nextJob++);
+    cmd.coreCount = opt.coreCount;
+    cmd.placement = opt.placement;
+
+    JobRecord job;
+    job.kind = kind;
+    job.measured = measured;
+    switch (kind) {
+    case KIND_TRUE:
+        cmd.programPath = "/bin/true";
+        job.nominalNs = 0;
+        break;
+    case KIND_SLEEP:
+        cmd.programPath = "/bin/sleep";
+        cmd.args = {std::to_string(opt.sleepMs / 1000) + "." + std::to_string(1000 + opt.sleepMs % 1000).substr(1)};
+        job.nominalNs = static_cast<uint64_t>(opt.sleepMs) * 1000000ull;
+        break;
+    case KIND_SPIN:
+        cmd.programPath = self;
+        cmd.args = {"--spin", std::to_string(opt.spinMs)};
+        job.nominalNs = static_cast<uint64_t>(opt.spinMs) * 1000000ull;
+        break;
+    default:
+        break;
+    }
+    jobs.emplace(cmd.id, job);
+    started[kind]++;
+}
+
+void Generator::send(std::vector<Command>& cmds, uint64_t scheduledNs, bool measured)
+{
+    std::string raw;
+    std::string correlationId;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        correlationId = std::to_string(nextCorrelation++);
+        for (Command& cmd : cmds) {
+            CommandAction action = action_from_name(cmd.action);
+            // One correlation id per message; per-command latency uses the job id in the reply
+            pending.emplace(correlationId + "/" + cmd.id, PendingCommand{action, scheduledNs, measured});
+            sent[action]++;
+        }
+    }
+
+    if (opt.binary) {
+        for (Command& cmd : cmds) {
+            cmd.replyQueue = replyName;
+            cmd.correlationId = correlationId;
+            encode_command(cmd, raw);
+        }
+    } else {
+        auto toJson = [](const Command& cmd) {
+            nlohmann::json p = {{"JobId", cmd.id}};
+            if (!cmd.programPath.empty()) p["ProgramPath"] = cmd.programPath;
+            if (!cmd.args.empty()) p["Args"] = cmd.args;
+            if (cmd.action == "StartJob") p["CoreCount"] = cmd.coreCount;
+            if (!cmd.placement.empty()) p["Placement"] = cmd.placement;
+            return p;
+        };
+        MQMessage msg;
+        bool allStarts = cmds.size() > 1 && std::all_of(cmds.begin(), cmds.end(), [](const Command& c) {
+            return c.action == "StartJob";
+        });
+        if (allStarts) {
+            msg.command = "StartJobs";
+            msg.parameters["Jobs"] = nlohmann::json::array();
+            for (const Command& cmd : cmds) msg.parameters["Jobs"].push_back(toJson(cmd));
+        } else {
+            // JSON carries one command per message; a mixed batch goes out one by one
+            for (size_t i = 0; i + 1 < cmds.size(); ++i) {
+                MQMessage single;
+                single.command = cmds[i].action;
+                single.parameters = toJson(cmds[i]);
+                single.parameters["ReplyQueue"] = replyName;
+                single.parameters["CorrelationId"] = correlationId;
+                queue.send(single.serialize());
+            }
+            msg.command = cmds.back().action;
+            msg.parameters = toJson(cmds.back());
+        }
+        msg.parameters["ReplyQueue"] = replyName;
+        msg.parameters["CorrelationId"] = correlationId;
+        raw = msg.serialize();
+    }
+    queue.send(raw); // Blocks while the request queue is full
+}
+
+void Generator::run()
+{
+    std::thread receiver(&Generator::receiveReplies, this);
+    std::thread poller;
+    if (haveTable) poller = std::thread(&Generator::pollTable, this);
+
+    const uint64_t interval = static_cast<uint64_t>(1e9 / opt.rate * opt.batch);
+    const uint64_t start = now_ns();
+    const uint64_t measureFrom = start + static_cast<uint64_t>(opt.warmup * 1e9);
+    const uint64_t end = measureFrom + static_cast<uint64_t>(opt.duration * 1e9);
+
+    std::vector<Command> cmds;
+    for (uint64_t scheduled = start; scheduled < end; scheduled += interval) {
+        sleep_until_ns(scheduled);
+        bool measured = scheduled >= measureFrom;
+        measuring.store(measured, std::memory_order_relaxed);
+
+        cmds.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < opt.batch; ++i) {
+                cmds.emplace_back();
+                CommandAction action = drawAction();
+                if (action == ACTION_START || !makeControl(action, cmds.back(), cmds)) {
+                    if (action != ACTION_START) fallbackStarts++;
+                    makeStart(cmds.back(), measured);
+                }
+            }
+        }
+        send(cmds, scheduled, measured);
+    }
+    measuring.store(false, std::memory_order_relaxed);
+
+    // Let outstanding replies and exit notices arrive
+    uint64_t drainEnd = now_ns() + static_cast<uint64_t>(opt.drain * 1e9);
+    while (now_ns() < drainEnd) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bool exitsDone = !haveTable || std::none_of(jobs.begin(), jobs.end(), [](const auto& j) {
+                return !j.second.exited && !j.second.disturbed;
+            });
+            if (pending.empty() && exitsDone) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    terminateLeftovers();
+    stopping.store(true);
+    receiver.join();
+    if (poller.joinable()) poller.join();
+}
+
+void Generator::terminateLeftovers()
+{
+    // Paused jobs never finish on their own; nothing of ours is left behind
+    std::vector<std::string> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& j : jobs) {
+            if (!j.second.exited) ids.push_back(j.first);
+        }
+    }
+    for (const auto& id : ids) {
+        MQMessage msg;
+        msg.command = "terminate";
+        msg.parameters["JobId"] = id;
+        queue.send(msg.serialize());
+    }
+}
+
+void Generator::receiveReplies()
+{
+    std::vector<char> buf(8192);
+    while (!stopping.load()) {
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100 * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        ssize_t n = mq_timedreceive(replyQueue, buf.data(), buf.size(), nullptr, &deadline);
+        uint64_t at = now_ns();
+        if (n < 0) continue; // Timeout or EINTR: re-check 'stopping'
+
+        try {
+            handleReply(MQMessage::deserialize(std::string(buf.data(), static_cast<size_t>(n))), at);
+        } catch (const std::exception& e) {
+            fprintf(stderr, "[WARN] Malformed reply: %s\n", e.what());
+        }
+    }
+}
+
+void Generator::handleReply(const MQMessage& msg, uint64_t at)
+{
+    std::string correlationId = msg.parameters.value("CorrelationId", "");
+    auto results = msg.parameters.find("Results");
+    if (results == msg.parameters.end() || !results->is_array()) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& r : *results) {
+        std::string jobId = r.value("JobId", "");
+        auto it = pending.find(correlationId + "/" + jobId);
+        if (it == pending.end()) continue; // Status of another job, or a late duplicate
+        PendingCommand& cmd = it->second;
+        replies++;
+
+        if (!r.value("Ok", false)) {
+            std::string error = jobId + ": " + r.value("Error", std::string("?"));
+            if (cmd.action != ACTION_START) {
+                // Sorted out in report(), once the table poller has caught up with the exits
+                failedControls.push_back(FailedControl{jobId, at, error});
+                removeLive(jobs[jobId]); // Most likely gone: stop targeting it
+                pending.erase(it);
+                continue;
+            }
+            failures++;
+            if (firstFailure.empty()) firstFailure = error;
+            if (cmd.action == ACTION_START) jobs[jobId].exited = true; // Nothing to wait for
+            pending.erase(it);
+            continue;
+        }
+
+        if (cmd.action == ACTION_START) {
+            if (r.value("Pid", 0) <= 0) {
+                queuedReplies++; // Waiting for admission; the PID comes in a second reply
+                continue;
+            }
+            JobRecord& job = jobs[jobId];
+            job.spawned = true;
+            job.spawnNs = at;
+            if (job.exited) measureExit(job);
+            else if (!job.disturbed) addLive(jobId, job);
+            if (cmd.measured) spawnLatency.add(at - cmd.scheduledNs);
+        } else if (cmd.measured) {
+            replyLatency[cmd.action].add(at - cmd.scheduledNs);
+        }
+        pending.erase(it);
+    }
+}
+
+void Generator::pollTable()
+{
+    std::vector<JobTableEntry> running;
+    JobTableEntry entry;
+    std::string prefix = "lg" + std::to_string(getpid()) + "-";
+    while (!stopping.load()) {
+        running.clear();
+        uint32_t used = table.usedSlots();
+        for (uint32_t slot = 0; slot < used; ++slot) {
+            if (!table.readAny(slot, entry)) continue;
+            entry.id[JOB_TABLE_ID_SIZE - 1] = '\0';
+            if ((entry.flags & JOB_ENTRY_IN_USE) && entry.state == JOB_RUNNING) running.push_back(entry);
+            if (entry.state != JOB_FINISHED && entry.state != JOB_TERMINATED) continue;
+            if (strncmp(entry.id, prefix.c_str(), prefix.size()) != 0) continue;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = jobs.find(entry.id);
+            if (it == jobs.end() || it->second.exited) continue;
+            JobRecord& job = it->second;
+            job.exited = true;
+            job.exitNs = entry.updatedAtNs;
+            exitNotices++;
+            if (job.spawned) {
+                removeLive(job);
+                measureExit(job);
+            }
+        }
+        if (measuring.load(std::memory_order_relaxed)) samplePlacement(running);
+        std::this_thread::sleep_for(std::chrono::milliseconds(opt.sampleMs));
+    }
+}
+
+void Generator::samplePlacement(const std::vector<JobTableEntry>& running)
+{
+    if (running.empty() || cpus.empty()) return;
+
+    std::vector<uint64_t> perCore(cpus.size(), 0);
+    for (const JobTableEntry& e : running) {
+        for (size_t w = 0; w < JOB_TABLE_CPU_WORDS; ++w) {
+            for (uint64_t bits = e.cpus[w]; bits; bits &= bits - 1) {
+                int cpu = static_cast<int>(w * 64) + __builtin_ctzll(bits);
+                if (cpu < CPU_SETSIZE && cpuIndex[cpu] >= 0) perCore[cpuIndex[cpu]]++;
+            }
+        }
+    }
+
+    double sum = 0.0, sumSq = 0.0;
+    uint64_t lo = UINT64_MAX, hi = 0;
+    for (uint64_t n : perCore) {
+        sum += static_cast<double>(n);
+        sumSq += static_cast<double>(n) * static_cast<double>(n);
+        lo = std::min(lo, n);
+        hi = std::max(hi, n);
+    }
+    double mean = sum / static_cast<double>(perCore.size());
+    double variance = std::max(0.0, sumSq / static_cast<double>(perCore.size()) - mean * mean);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    placement.samples++;
+    placement.sumMeanJobs += mean;
+    placement.sumCv += mean > 0.0 ? std::sqrt(variance) / mean : 0.0;
+    placement.spread.push_back(hi - lo);
+    if (hi >= 2 && lo == 0) placement.stackedSamples++;
+}
+
+void Generator::report(double measuredSeconds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    // A control command that lost the race with the job's own exit is not a manager failure
+    uint64_t lateControls = 0;
+    for (const FailedControl& f : failedControls) {
+        uint64_t exitNs = jobs[f.jobId].exitNs;
+        if (exitNs != 0 && exitNs <= f.repliedNs) {
+            lateControls++;
+            continue;
+        }
+        failures++;
+        if (firstFailure.empty()) firstFailure = f.error;
+    }
+
+    uint64_t total = 0;
+    for (int a = ACTION_START; a < ACTION_SLOTS; ++a) total += sent[a];
+
+    printf("ccm_loadgen: %.0f cmd/s offered for %.1fs (+%.1fs warm-up), %s, batch %d, seed %llu\n", opt.rate,
+           opt.duration, opt.warmup, opt.binary ? "binary" : "JSON", opt.batch,
+           static_cast<unsigned long long>(opt.seed));
+    printf("  sent %llu commands (%.1f/s):", static_cast<unsigned long long>(total),
+           static_cast<double>(total) / (measuredSeconds + opt.warmup));
+    for (int a = ACTION_START; a < ACTION_SLOTS; ++a) {
+        printf(" %s %llu", action_name(static_cast<CommandAction>(a)), static_cast<unsigned long long>(sent[a]));
+    }
+    printf("\n  jobs:");
+    for (int k = 0; k < KIND_COUNT; ++k) printf(" %s %llu", KIND_NAMES[k], static_cast<unsigned long long>(started[k]));
+    printf(", %llu start(s) instead of a control command without a target\n",
+           static_cast<unsigned long long>(fallbackStarts));
+    printf("  replies %llu (%llu queued for admission), unanswered %zu, exit notices %llu\n",
+           static_cast<unsigned long long>(replies), static_cast<unsigned long long>(queuedReplies), pending.size(),
+           static_cast<unsigned long long>(exitNotices));
+    printf("  failures %llu%s%s, %llu control command(s) reached a job that had already exited\n",
+           static_cast<unsigned long long>(failures), firstFailure.empty() ? "" : ", first: ", firstFailure.c_str(),
+           static_cast<unsigned long long>(lateControls));
+
+    printf("\n  %-24s %8s %10s %10s %10s %10s\n", "latency (us)", "count", "p50", "p99", "p99.9", "max");
+    spawnLatency.print("command-to-spawn");
+    for (int k = 0; k < KIND_COUNT; ++k) {
+        std::string name = std::string("spawn-to-exit-notice ") + KIND_NAMES[k];
+        exitLatency[k].print(name.c_str());
+    }
+    for (int a = ACTION_PAUSE; a < ACTION_SLOTS; ++a) {
+        std::string name = std::string(action_name(static_cast<CommandAction>(a))) + " reply";
+        replyLatency[a].print(name.c_str());
+    }
+
+    if (!haveTable) return;
+    if (placement.samples == 0) {
+        printf("\n  placement: no samples with running jobs\n");
+        return;
+    }
+    std::sort(placement.spread.begin(), placement.spread.end());
+    double n = static_cast<double>(placement.samples);
+    printf("\n  placement over %zu cores, %llu samples: %.2f running jobs/core, CV %.3f, "
+           "max-min p50 %llu p99 %llu, stacked %.2f%%\n",
+           cpus.size(), static_cast<unsigned long long>(placement.samples), placement.sumMeanJobs / n,
+           placement.sumCv / n, static_cast<unsigned long long>(placement.spread[placement.spread.size() / 2]),
+           static_cast<unsigned long long>(placement.spread[static_cast<size_t>(0.99 * (n - 1))]),
+           100.0 * static_cast<double>(placement.stackedSamples) / n);
+}
+
+// Parses "name:weight,..." into 'weights'; false on an unknown name
+template <size_t N>
+bool parse_weights(const std::string& spec, int (&weights)[N], const char* const* names, size_t first)
+{
+    int parsed[N] = {};
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t comma = spec.find(',', pos);
+        std::string item = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? spec.size() : comma + 1;
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+        int weight = colon == std::string::npos ? 1 : atoi(item.c_str() + colon + 1);
+        bool found = false;
+        for (size_t i = first; i < N; ++i) {
+            if (name == names[i]) {
+                parsed[i] = std::max(0, weight);
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    int total = 0;
+    for (size_t i = first; i < N; ++i) total += parsed[i];
+    if (total == 0) return false;
+    std::copy(parsed, parsed + N, weights);
+    return true;
+}
+
+void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --config PATH       mq.json naming the request queue (default mq.json)\n"
+            "  --table NAME        job status table, \"\" to skip exit/placement figures (default %s)\n"
+            "  --rate N            commands per second (default 200)\n"
+            "  --duration S        measured seconds (default 10)\n"
+            "  --warmup S          unmeasured seconds first (default 1)\n"
+            "  --drain S           max wait for outstanding replies and exits (default 5)\n"
+            "  --mix SPEC          action weights, e.g. start:70,pause:5,resume:5,terminate:10,status:10\n"
+            "  --jobs SPEC         job weights, e.g. true:70,sleep:20,spin:10\n"
+            "  --sleep-ms N        sleeper run time (default 100)\n"
+            "  --spin-ms N         spinner run time (default 100)\n"
+            "  --cores N           CoreCount of each job (default 1)\n"
+            "  --placement P       spread, pack or numa (default: manager's)\n"
+            "  --binary            binary wire format instead of JSON\n"
+            "  --batch N           commands per queue message (default 1)\n"
+            "  --sample-ms N       job table polling period (default 2)\n"
+            "  --seed N            command sequence seed (default 1)\n",
+            argv0, JOB_TABLE_DEFAULT_NAME);
+}
+
+// Spinner job body: burns CPU for 'ms' of wall time
+int spin(int ms)
+{
+    uint64_t end = now_ns() + static_cast<uint64_t>(ms) * 1000000ull;
+    volatile uint64_t x = 0;
+    while (now_ns() < end) {
+        for (int i = 0; i < 10000; ++i) x = x + 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc == 3 && strcmp(argv[1], "--spin") == 0) return spin(atoi(argv[2]));
+
+    Options opt;
+    const char* const actionNames[ACTION_SLOTS] = {"", "start", "pause", "resume", "terminate", "status"};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--binary") {
+            opt.binary = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--config") opt.config = value;
+        else if (arg == "--table") opt.table = value;
+        else if (arg == "--rate") ok = (opt.rate = atof(value.c_str())) > 0.0;
+        else if (arg == "--duration") ok = (opt.duration = atof(value.c_str())) > 0.0;
+        else if (arg == "--warmup") ok = (opt.warmup = atof(value.c_str())) >= 0.0;
+        else if (arg == "--drain") ok = (opt.drain = atof(value.c_str())) >= 0.0;
+        else if (arg == "--mix") ok = parse_weights(value, opt.mix, actionNames, ACTION_START);
+        else if (arg == "--jobs") ok = parse_weights(value, opt.jobs, KIND_NAMES, 0);
+        else if (arg == "--sleep-ms") ok = (opt.sleepMs = atoi(value.c_str())) >= 0;
+        else if (arg == "--spin-ms") ok = (opt.spinMs = atoi(value.c_str())) >= 0;
+        else if (arg == "--cores") ok = (opt.coreCount = atoi(value.c_str())) > 0;
+        else if (arg == "--placement") opt.placement = value;
+        else if (arg == "--batch") ok = (opt.batch = atoi(value.c_str())) > 0;
+        else if (arg == "--sample-ms") ok = (opt.sampleMs = atoi(value.c_str())) > 0;
+        else if (arg == "--seed") opt.seed = strtoull(value.c_str(), nullptr, 10);
+        else ok = false;
+        if (!ok) {
+            fprintf(stderr, "Invalid option %s %s\n", arg.c_str(), value.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    char selfPath[4096];
+    ssize_t len = readlink("/proc/self/exe", selfPath, sizeof(selfPath) - 1);
+    if (len <= 0) {
+        fprintf(stderr, "[ERROR] Cannot resolve /proc/self/exe: %s\n", strerror(errno));
+        return 1;
+    }
+    selfPath[len] = '\0';
+
+    MQConfig cfg;
+    if (!loadConfig(opt.config, cfg)) {
+        fprintf(stderr, "[ERROR] Cannot load %s\n", opt.config.c_str());
+        return 1;
+    }
+    MessageQueue requests(cfg, false); // The manager owns the queue
+
+    Generator gen(opt, requests, selfPath);
+    if (!gen.openReplyQueue()) return 1;
+    gen.openTable();
+
+    uint64_t start = now_ns();
+    gen.run();
+    double elapsed = static_cast<double>(now_ns() - start) / 1e9;
+    gen.closeReplyQueue();
+    gen.report(std::min(elapsed - opt.warmup, opt.duration));
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * ccm_stress: in-process stress test of the job tracker.
+ *
+ * Runs a ProcessManager inside this process and calls its command entry
+ * points (startProgram, controlProcess, reportStatus) directly from several
+ * client threads, bypassing the message queue and the worker pool, so the
+ * figures show the cost of the tracker and its locks rather than of IPC.
+ * Every client thread keeps up to --jobs /bin/sleep jobs of its own alive and
+ * draws start, pause, resume, terminate and status operations from --mix;
+ * status reads all jobs, one shard at a time, like a client's "status" does.
+ * The monitor reaps exits as usual, so launches, signals, status reads and the
+ * reaper all run concurrently. Per-operation latency is reported as
+ * p50/p99/p99.9/max in microseconds.
+ *
+ * The tracker's stripe count is a build flag, so the same run can be repeated
+ * against a single-lock tracker to reproduce the effect of sharding:
+ *   g++ -std=c++17 -O2 -pthread -Iinclude [-DCCM_TRACKER_SHARDS=1] tools/ccm_stress.cpp \
+ *       source/[A-Z]*.cpp <MessageQueue library> -lrt -o ccm_stress
+ *
+ * The manager creates the request queue named in --config, so point it at a
+ * config that no running manager uses. Example:
+ *   ./ccm_stress --threads 8 --duration 10 --jobs 16 --mix start:40,pause:15,resume:15,terminate:20,status:10
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ProcessManager.h"
+#include "MessageQueue.h"
+#include "Config.h"
+#include "Logger.h"
+
+namespace {
+
+enum StressOp { OP_START, OP_PAUSE, OP_RESUME, OP_TERMINATE, OP_STATUS, OP_COUNT };
+const char* const OP_NAMES[OP_COUNT] = {"start", "pause", "resume", "terminate", "status"};
+
+struct Options {
+    std::string config = "mq.json";
+    int threads = 4;
+    double duration = 10.0; // Seconds
+    int jobs = 8;           // Live jobs per client thread
+    int mix[OP_COUNT] = {40, 15, 15, 20, 10};
+    uint64_t seed = 1;
+};
+
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Exact percentiles over all samples (runs are short enough to keep them)
+struct LatencySeries {
+    std::vector<uint64_t> samples;
+    uint64_t failures = 0;
+
+    void print(const char* name)
+    {
+        if (samples.empty()) {
+            printf("  %-10s %8d\n", name, 0);
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto at = [this](double q) {
+            size_t i = static_cast<size_t>(std::ceil(q * static_cast<double>(samples.size()))) - 1;
+            return static_cast<double>(samples[std::min(i, samples.size() - 1)]) / 1000.0;
+        };
+        printf("  %-10s %8zu %8llu %10.1f %10.1f %10.1f %10.1f\n", name, samples.size(),
+               static_cast<unsigned long long>(failures), at(0.50), at(0.99), at(0.999),
+               static_cast<double>(samples.back()) / 1000.0);
+    }
+};
+
+class Client {
+public:
+    Client(ProcessManager& manager, const Options& options, int index)
+        : pm(manager), opt(options), prefix("stress-" + std::to_string(index) + "-"),
+          rng(options.seed + static_cast<uint64_t>(index)) {}
+
+    void run(uint64_t deadline)
+    {
+        std::discrete_distribution<int> pick(opt.mix, opt.mix + OP_COUNT);
+        std::vector<CommandResult> statusResults;
+        while (now_ns() < deadline) {
+            int op = pick(rng);
+            // Control operations need a job; keep the pool filled first
+            if (op != OP_STATUS && (live.empty() || (op == OP_START && live.size() >= static_cast<size_t>(opt.jobs)))) {
+                op = live.empty() ? OP_START : OP_STATUS;
+            }
+
+            uint64_t begin = now_ns();
+            bool ok = true;
+            switch (op) {
+            case OP_START: {
+                Command cmd;
+                cmd.id = prefix + std::to_string(nextJob++);
+                cmd.action = "StartJob";
+                cmd.programPath = "/bin/sleep";
+                cmd.args = {"60"};
+                CommandResult result = pm.startProgram(cmd);
+                ok = result.ok;
+                if (ok) live.push_back(cmd.id);
+                break;
+            }
+            case OP_PAUSE:
+            case OP_RESUME: {
+                const std::string& id = live[std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng)];
+                bool pause = op == OP_PAUSE;
+                ok = pm.controlProcess(id, pause ? SIG_PAUSE : SIG_RESUME, pause ? JOB_PAUSED : JOB_RUNNING).ok;
+                break;
+            }
+            case OP_TERMINATE: {
+                size_t i = std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+                ok = pm.controlProcess(live[i], SIG_TERMINATE, JOB_TERMINATED).ok;
+                live[i] = live.back();
+                live.pop_back();
+                break;
+            }
+            default:
+                statusResults.clear();
+                pm.reportStatus("", statusResults);
+                break;
+            }
+            LatencySeries& series = latency[op];
+            series.samples.push_back(now_ns() - begin);
+            if (!ok) series.failures++;
+        }
+    }
+
+    LatencySeries latency[OP_COUNT];
+
+private:
+    ProcessManager& pm;
+    const Options& opt;
+    std::string prefix;
+    std::mt19937_64 rng;
+    std::vector<std::string> live; // Ids of this client's jobs that were not terminated
+    uint64_t nextJob = 0;
+};
+
+// Parses "start:40,pause:15,..." into per-operation weights
+bool parse_mix(const std::string& spec, int* weights)
+{
+    int parsed[OP_COUNT] = {};
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t comma = spec.find(',', pos);
+        std::string item = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? spec.size() : comma + 1;
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) return false;
+        std::string name = item.substr(0, colon);
+        int value = atoi(item.c_str() + colon + 1);
+        int op = 0;
+        while (op < OP_COUNT && name != OP_NAMES[op]) ++op;
+        if (op == OP_COUNT || value < 0) return false;
+        parsed[op] = value;
+    }
+    if (parsed[OP_START] == 0) return false; // Nothing to control otherwise
+    std::copy(parsed, parsed + OP_COUNT, weights);
+    return true;
+}
+
+void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --config PATH       mq.json naming a request queue no manager uses (default mq.json)\n"
+            "  --threads N         concurrent client threads (default 4)\n"
+            "  --duration S        seconds of load (default 10)\n"
+            "  --jobs N            live jobs per client thread (default 8)\n"
+            "  --mix SPEC          operation weights, e.g. start:40,pause:15,resume:15,terminate:20,status:10\n"
+            "  --seed N            operation sequence seed (default 1)\n",
+            argv0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--config") opt.config = value;
+        else if (arg == "--threads") ok = (opt.threads = atoi(value.c_str())) > 0;
+        else if (arg == "--duration") ok = (opt.duration = atof(value.c_str())) > 0.0;
+        else if (arg == "--jobs") ok = (opt.jobs = atoi(value.c_str())) > 0;
+        else if (arg == "--mix") ok = parse_mix(value, opt.mix);
+        else if (arg == "--seed") opt.seed = strtoull(value.c_str(), nullptr, 10);
+        else ok = false;
+        if (!ok) {
+            fprintf(stderr, "Invalid option %s %s\n", arg.c_str(), value.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    LogSettings logSettings;
+    logSettings.level = LEVEL_WARN; // Every operation would log otherwise
+    Logger::instance().configure(logSettings);
+
+    MQConfig cfg;
+    if (!loadConfig(opt.config, cfg)) {
+        fprintf(stderr, "[ERROR] Cannot load %s\n", opt.config.c_str());
+        return 1;
+    }
+    MessageQueue mq(cfg, true);
+    ProcessManager pm(&mq);
+    pm.start();
+
+    std::vector<std::unique_ptr<Client>> clients;
+    for (int i = 0; i < opt.threads; ++i) clients.push_back(std::make_unique<Client>(pm, opt, i));
+
+    uint64_t start = now_ns();
+    uint64_t deadline = start + static_cast<uint64_t>(opt.duration * 1e9);
+    std::vector<std::thread> threads;
+    for (auto& client : clients) threads.emplace_back(&Client::run, client.get(), deadline);
+    for (auto& thread : threads) thread.join();
+    double elapsed = static_cast<double>(now_ns() - start) / 1e9;
+
+    LatencySeries total[OP_COUNT];
+    uint64_t operations = 0;
+    for (auto& client : clients) {
+        for (int op = 0; op < OP_COUNT; ++op) {
+            std::vector<uint64_t>& samples = client->latency[op].samples;
+            total[op].samples.insert(total[op].samples.end(), samples.begin(), samples.end());
+            total[op].failures += client->latency[op].failures;
+            operations += samples.size();
+        }
+    }
+
+    printf("%d client thread(s), %zu tracker shard(s), %.1f s: %llu operations (%.0f/s)\n", opt.threads,
+           pm.runningProcesses.shardCount(), elapsed, static_cast<unsigned long long>(operations),
+           static_cast<double>(operations) / elapsed);
+    printf("  %-10s %8s %8s %10s %10s %10s %10s   (us)\n", "operation", "count", "failed", "p50", "p99", "p99.9", "max");
+    for (int op = 0; op < OP_COUNT; ++op) total[op].print(OP_NAMES[op]);
+
+    pm.stop(); // Terminates the jobs that are still alive
+    return 0;
+}